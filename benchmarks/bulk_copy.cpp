@@ -0,0 +1,67 @@
+// Compares filling and reading a memory window register by register with
+// the bulk copies at different access widths. Runs on host memory, so the
+// numbers show the per access overhead, not the bus.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <vector>
+#include "IRegBackend.hpp"
+#include "RegisterBase.hpp"
+
+using namespace regmap;
+typedef std::chrono::steady_clock Clock_t;
+
+template <class F>
+double measure(std::size_t bytes, F f) {
+
+	// repeat until about 100MB were moved
+	std::size_t rounds = std::max<std::size_t>(1, (100 << 20) / bytes);
+	auto start = Clock_t::now();
+	for (std::size_t i = 0; i < rounds; i++)
+		f();
+	double seconds = std::chrono::duration<double>(Clock_t::now() - start).count();
+
+	return static_cast<double>(bytes) * rounds / seconds / (1 << 20);
+}
+
+int main(int argc, char **argv) {
+
+	const std::size_t windowSize = 1 << 20;
+	BackendMemory_t mem(aligned_alloc(64, windowSize), free);
+	RegBackendMemory backend(mem, windowSize);
+	std::vector<std::uint32_t> host(windowSize / sizeof(std::uint32_t), 0xA5A5A5A5);
+
+	printf("%10s %14s %14s %14s %14s %14s\n", "bytes", "Register32_t", "width 4", "width 8", "width 16", "read width 8");
+	for (std::size_t bytes = 64; bytes <= windowSize; bytes *= 4) {
+
+		// what get<Register32_t>() hands out per word
+		Register32_t word("word", backend, 0, 0, 0, 0xFFFFFFFF, 0, 0, 0);
+		double perRegister = measure(bytes, [&]() {
+			for (std::size_t offset = 0; offset < bytes; offset += 4) {
+				Register32_t reg(word, offset);
+				reg = host[offset / 4];
+			}
+		});
+
+		double widths[3] = {0, 0, 0};
+		unsigned int width[3] = {4, 8, 16};
+		for (int i = 0; i < 3; i++) {
+			try {
+				backend.setAccessWidth(width[i]);
+			} catch (std::exception &e) {
+				continue;
+			}
+			widths[i] = measure(bytes, [&]() { backend.copy_to_device(0, host.data(), bytes); });
+		}
+
+		backend.setAccessWidth(8);
+		double reading = measure(bytes, [&]() { backend.copy_from_device(0, host.data(), bytes); });
+
+		printf("%10zu %9.0f MB/s %9.0f MB/s %9.0f MB/s %9.0f MB/s %9.0f MB/s\n",
+			bytes, perRegister, widths[0], widths[1], widths[2], reading);
+	}
+
+	return 0;
+}
@@ -0,0 +1,124 @@
+// Memory use and iteration speed of the register table of a large map,
+// compared with name ordered storage in a std::map as used before.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <new>
+#include <vector>
+#include <algorithm>
+#include <malloc.h>
+#include <boost/filesystem.hpp>
+#include "RegMapDefinition.hpp"
+
+using namespace regmap;
+typedef std::chrono::steady_clock Clock_t;
+
+// bytes currently allocated with new
+static std::atomic<std::size_t> allocated(0);
+
+void* operator new(std::size_t size) {
+
+	void *p = malloc(size);
+	if (!p)
+		throw std::bad_alloc();
+	allocated += malloc_usable_size(p);
+	return p;
+}
+
+void operator delete(void *p) noexcept {
+	if (p)
+		allocated -= malloc_usable_size(p);
+	free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+	operator delete(p);
+}
+
+template <class F>
+double measure(F f, int rounds = 100) {
+
+	auto start = Clock_t::now();
+	for (int i = 0; i < rounds; i++)
+		f();
+	return std::chrono::duration<double, std::micro>(Clock_t::now() - start).count() / rounds;
+}
+
+int main(int argc, char **argv) {
+
+	const unsigned int count = argc > 1 ? atoi(argv[1]) : 50000;
+
+	// register names don't follow the offsets, like in most real maps
+	std::string file = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("regmap-table-%%%%.json")).string();
+	{
+		std::ofstream f(file);
+		f << "{ \"registers\": {";
+		for (unsigned int i = 0; i < count; i++)
+			f << (i ? "," : "") << "\"reg" << (i * 7919) % count << "\": { \"offset\": \"" << i * 4
+			  << "\", \"size\": \"4\", \"bitmasks\": { \"LOW\": \"0xFF\", \"HIGH\": \"0xFF000000\" } }";
+		f << "} }";
+	}
+
+	std::size_t before = allocated;
+	Definition_t definition = std::make_shared<RegMapDefinition>(file);
+	boost::filesystem::remove(file);
+	std::size_t tableBytes = allocated - before;
+
+	const RegisterBlock &block = definition->registers();
+
+	// the previous storage: one heap node per register, ordered by name
+	before = allocated;
+	std::map<std::string, const RegisterEntry*> byName;
+	for (auto &entry : block.m_oRegisters)
+		byName[entry.m_pName] = &entry;
+	std::size_t mapBytes = allocated - before;
+
+	unsigned long sum = 0;
+	double tableIteration = measure([&]() {
+		for (auto &entry : block.m_oRegisters)
+			sum += entry.m_uOffset;
+	});
+
+	double mapIteration = measure([&]() {
+		std::vector<unsigned int> offsets;
+		offsets.reserve(byName.size());
+		for (auto &reg : byName)
+			offsets.push_back(reg.second->m_uOffset);
+		std::sort(offsets.begin(), offsets.end());
+		for (auto offset : offsets)
+			sum += offset;
+	});
+
+	double tableRange = measure([&]() {
+		for (unsigned int i = 0; i < 1000; i++) {
+			auto range = block.range(i * 64, i * 64 + 64);
+			for (auto it = range.first; it != range.second; ++it)
+				sum += it->m_uOffset;
+		}
+	});
+
+	double tableLookup = measure([&]() {
+		for (unsigned int i = 0; i < 1000; i++)
+			sum += block.find("reg" + std::to_string(i))->m_uOffset;
+	});
+
+	double mapLookup = measure([&]() {
+		for (unsigned int i = 0; i < 1000; i++)
+			sum += byName.find("reg" + std::to_string(i)) != byName.end();
+	});
+
+	printf("%u registers\n", count);
+	printf("definition heap:          %10zu bytes (%zu per register)\n", tableBytes, tableBytes / count);
+	printf("std::map copy heap:       %10zu bytes\n", mapBytes);
+	printf("offset order, table:      %10.1f us\n", tableIteration);
+	printf("offset order, std::map:   %10.1f us\n", mapIteration);
+	printf("1000 range queries:       %10.1f us\n", tableRange);
+	printf("1000 lookups, hash index: %10.1f us\n", tableLookup);
+	printf("1000 lookups, std::map:   %10.1f us\n", mapLookup);
+
+	return sum == 0;
+}
@@ -29,14 +29,22 @@
 #include <unistd.h>
 #include <linux/i2c-dev.h>
 #include <linux/i2c.h>
+#include "streaming.hpp"
+#include "bulk.hpp"
+#include "Result.hpp"
+#include "endian.hpp"
 
 #include <iostream>
 namespace regmap {
 
+// kept out of line, so the hot paths carry no string building
+[[noreturn]] __attribute__((cold)) void throwOutOfRange(const char *backend, unsigned int offset);
+
 class IRegBackend {
 
 public:
-	IRegBackend() : m_addrOffset(std::numeric_limits<std::uint32_t>::max()), m_dataOffset(0) {}
+	IRegBackend() : m_pUnchecked(NULL), m_addrOffset(std::numeric_limits<std::uint32_t>::max()), m_dataOffset(0) {}
+	virtual ~IRegBackend() {}
 
 	template <class T>
 	void set(unsigned int offset, T value) {
@@ -64,17 +72,199 @@ public:
 		return buf;
 	}
 
+	// accesses of registers in the given byte order
+	template <class T>
+	void set(unsigned int offset, T value, eEndian order) {
+		this->set<T>(offset, toDevice<T>(value, order));
+	}
+
+	template <class T>
+	T get(unsigned int offset, eEndian order) {
+		return toHost<T>(this->get<T>(offset), order);
+	}
+
+	// Accesses without the range check, they go straight to the mapping on
+	// validated memory backends. Only for offsets checked against size()
+	// before, i.e. registers of a map, see RegMapBase::setBackend.
+	template <class T>
+	T fetch_unchecked(unsigned int offset) {
+		if (!m_pUnchecked)
+			return this->get<T>(offset);
+
+		if (offset & (sizeof(T) - 1)) {
+			T value;
+			memcpy(&value, m_pUnchecked + offset, sizeof(T));
+			return value;
+		}
+		return *reinterpret_cast<volatile T*>(m_pUnchecked + offset);
+	}
+
+	template <class T>
+	void store_unchecked(unsigned int offset, T value) {
+		if (!m_pUnchecked)
+			return this->set<T>(offset, value);
+
+		if (offset & (sizeof(T) - 1))
+			memcpy(m_pUnchecked + offset, &value, sizeof(T));
+		else
+			*reinterpret_cast<volatile T*>(m_pUnchecked + offset) = value;
+	}
+
+	// accesses without exceptions, errors are returned as std::errc codes
+	template <class T>
+	Result<T> try_get(unsigned int offset) noexcept {
+		T buf;
+		std::error_code error;
+
+		if (!this->isIndirect()) {
+			error = this->try_read(offset, (void*)(&buf), sizeof(T));
+		} else {
+			error = this->try_write(m_addrOffset, (void*)(&offset), sizeof(T));
+			if (!error)
+				error = this->try_read(m_dataOffset, (void*)(&buf), sizeof(T));
+		}
+
+		if (error)
+			return Result<T>(error);
+		return Result<T>(buf);
+	}
+
+	template <class T>
+	std::error_code try_set(unsigned int offset, T value) noexcept {
+
+		if (!this->isIndirect())
+			return this->try_write(offset, (void*)(&value), sizeof(T));
+
+		std::error_code error = this->try_write(m_addrOffset, (void*)(&offset), sizeof(T));
+		return error ? error : this->try_write(m_dataOffset, (void*)(&value), sizeof(T));
+	}
+
+	// unchecked accesses without exceptions
+	template <class T>
+	Result<T> try_fetch_unchecked(unsigned int offset) noexcept {
+		if (m_pUnchecked)
+			return this->fetch_unchecked<T>(offset);
+		return this->try_get<T>(offset);
+	}
+
+	template <class T>
+	std::error_code try_store_unchecked(unsigned int offset, T value) noexcept {
+		if (!m_pUnchecked)
+			return this->try_set<T>(offset, value);
+
+		this->store_unchecked<T>(offset, value);
+		return std::error_code();
+	}
+
+	// size of the accessible range, 0 if the backend does not know
+	virtual size_t size() const {
+		return 0;
+	}
+
+	// all registers of the map were checked against size()
+	virtual void validated() {}
+
+	// Bulk transfers of device memory windows like SRAM or lookup tables.
+	// Backends without a mapping transfer the range with a single access.
+	virtual void copy_to_device(unsigned int offset, const void* src, size_t size) {
+
+		this->checkDirect();
+		this->write(offset, const_cast<void*>(src), size);
+	}
+
+	virtual void copy_from_device(unsigned int offset, void* dst, size_t size) {
+
+		this->checkDirect();
+		this->read(offset, dst, size);
+	}
+
+	// count accesses of width bytes to the same register, e.g. a FIFO data
+	// register. Indirectly accessed registers are addressed only once.
+	virtual void read_repeated(unsigned int offset, void* dst, size_t width, size_t count) {
+
+		unsigned char *p = static_cast<unsigned char*>(dst);
+		if (this->isIndirect()) {
+			this->write(m_addrOffset, (void*)(&offset), width);
+			offset = m_dataOffset;
+		}
+
+		for (size_t i = 0; i < count; i++, p += width)
+			this->read(offset, p, width);
+	}
+
+	virtual void write_repeated(unsigned int offset, const void* src, size_t width, size_t count) {
+
+		unsigned char *p = static_cast<unsigned char*>(const_cast<void*>(src));
+		if (this->isIndirect()) {
+			this->write(m_addrOffset, (void*)(&offset), width);
+			offset = m_dataOffset;
+		}
+
+		for (size_t i = 0; i < count; i++, p += width)
+			this->write(offset, p, width);
+	}
+
+	// address of the range if the backend maps device memory, NULL otherwise
+	virtual void* mapping(unsigned int offset, size_t size) {
+		return NULL;
+	}
+
 	void setIndirection(std::uint32_t addrReg, std::uint32_t dataReg) {
 
+		m_pUnchecked = NULL;
 		m_addrOffset = addrReg;
 		m_dataOffset = dataReg;
 	}
 
+	bool isIndirect() const {
+		return m_addrOffset != std::numeric_limits<std::uint32_t>::max();
+	}
+
 protected:
 	virtual void write(unsigned int offset, void* value, size_t size){}
 	virtual void read(unsigned int offset, void* value, size_t size){}
 
+	// backends without system call level errors keep these wrappers
+	virtual std::error_code try_write(unsigned int offset, void* value, size_t size) noexcept {
+		try {
+			this->write(offset, value, size);
+		} catch (...) {
+			return current();
+		}
+		return std::error_code();
+	}
+
+	virtual std::error_code try_read(unsigned int offset, void* value, size_t size) noexcept {
+		try {
+			this->read(offset, value, size);
+		} catch (...) {
+			return current();
+		}
+		return std::error_code();
+	}
+
+	// the error code of the exception being handled
+	static std::error_code current() noexcept {
+		try {
+			throw;
+		} catch (const std::out_of_range&) {
+			return std::make_error_code(std::errc::result_out_of_range);
+		} catch (const std::system_error &e) {
+			return e.code();
+		} catch (...) {
+			return std::make_error_code(std::errc::io_error);
+		}
+	}
+
+	// direct access to the mapping once validated
+	unsigned char *m_pUnchecked;
+
 private:
+	void checkDirect() const {
+		if (this->isIndirect())
+			throw std::runtime_error("Bulk transfers are not supported on indirectly accessed registers");
+	}
+
 	std::uint32_t m_addrOffset;
 	std::uint32_t m_dataOffset;
 };
@@ -83,27 +273,143 @@ typedef std::shared_ptr<void> BackendMemory_t;
 class RegBackendMemory : public IRegBackend {
 
 public:
-	RegBackendMemory() {}
-	RegBackendMemory(BackendMemory_t mem, size_t size)
-	: m_pMem(mem), m_uSize(size) {}
+	RegBackendMemory() : m_uSize(0), m_uAccessWidth(8) {}
+	RegBackendMemory(BackendMemory_t mem, size_t size, unsigned int accessWidth = 8)
+	: m_pMem(mem), m_uSize(size), m_uAccessWidth(accessWidth) {
+
+		checkAccessWidth(m_uAccessWidth);
+	}
+
+	// widest single access of the bulk copies, see copyToDevice
+	void setAccessWidth(unsigned int width) {
+		checkAccessWidth(width);
+		m_uAccessWidth = width;
+	}
+
+	unsigned int accessWidth() const {
+		return m_uAccessWidth;
+	}
+
+	size_t size() const {
+		return m_uSize;
+	}
+
+	void validated() {
+		if (!this->isIndirect())
+			m_pUnchecked = (unsigned char*)(m_pMem.get());
+	}
+
+	void read_repeated(unsigned int offset, void* dst, size_t width, size_t count) {
+		if (this->isIndirect())
+			return IRegBackend::read_repeated(offset, dst, width, count);
+		if (offset + width > m_uSize)
+			throwOutOfRange("RegBackendMemory", offset);
+
+		void *reg = (unsigned char*)(m_pMem.get())+offset;
+		switch (width) {
+			case 1: drain<std::uint8_t>(reg, dst, count); break;
+			case 2: drain<std::uint16_t>(reg, dst, count); break;
+			case 4: drain<std::uint32_t>(reg, dst, count); break;
+			case 8: drain<std::uint64_t>(reg, dst, count); break;
+			default: throw std::runtime_error("RegBackendMemory: Unsupported register width");
+		}
+	}
+
+	void write_repeated(unsigned int offset, const void* src, size_t width, size_t count) {
+		if (this->isIndirect())
+			return IRegBackend::write_repeated(offset, src, width, count);
+		if (offset + width > m_uSize)
+			throwOutOfRange("RegBackendMemory", offset);
+
+		void *reg = (unsigned char*)(m_pMem.get())+offset;
+		switch (width) {
+			case 1: fill<std::uint8_t>(reg, src, count); break;
+			case 2: fill<std::uint16_t>(reg, src, count); break;
+			case 4: fill<std::uint32_t>(reg, src, count); break;
+			case 8: fill<std::uint64_t>(reg, src, count); break;
+			default: throw std::runtime_error("RegBackendMemory: Unsupported register width");
+		}
+	}
+
+	void* mapping(unsigned int offset, size_t size) {
+		if (offset + size > m_uSize)
+			throwOutOfRange("RegBackendMemory", offset);
+
+		return (unsigned char*)(m_pMem.get())+offset;
+	}
+
+	void copy_to_device(unsigned int offset, const void* src, size_t size) {
+		if (offset + size > m_uSize)
+			throwOutOfRange("RegBackendMemory", offset);
+
+		copyToDevice((unsigned char*)(m_pMem.get())+offset, src, size, m_uAccessWidth);
+	}
+
+	void copy_from_device(unsigned int offset, void* dst, size_t size) {
+		if (offset + size > m_uSize)
+			throwOutOfRange("RegBackendMemory", offset);
+
+		copyFromDevice(dst, (unsigned char*)(m_pMem.get())+offset, size, m_uAccessWidth);
+	}
+
+	// bulk write with non-temporal stores, see streamCopy
+	void stream(unsigned int offset, const void* data, size_t size) {
+		if (offset + size > m_uSize)
+			throwOutOfRange("RegBackendMemory", offset);
+
+		streamCopy((unsigned char*)(m_pMem.get())+offset, data, size);
+	}
 
 private:
 	void write(unsigned int offset, void* value, size_t size) {
 		if (offset + size > m_uSize)
-			throw std::out_of_range("RegBackendMemory: Given offset is out of range");
+			throwOutOfRange("RegBackendMemory", offset);
 
 		memcpy((unsigned char*)(m_pMem.get())+offset, value, size);
 	}
 
 	void read(unsigned int offset, void* value, size_t size) {
 		if (offset + size > m_uSize)
-			throw std::out_of_range("RegBackendMemory: Given offset is out of range");
+			throwOutOfRange("RegBackendMemory", offset);
+
+		memcpy(value, (unsigned char*)(m_pMem.get())+offset, size);
+	}
+
+	std::error_code try_write(unsigned int offset, void* value, size_t size) noexcept {
+		if (offset + size > m_uSize)
+			return std::make_error_code(std::errc::result_out_of_range);
+
+		memcpy((unsigned char*)(m_pMem.get())+offset, value, size);
+		return std::error_code();
+	}
+
+	std::error_code try_read(unsigned int offset, void* value, size_t size) noexcept {
+		if (offset + size > m_uSize)
+			return std::make_error_code(std::errc::result_out_of_range);
 
 		memcpy(value, (unsigned char*)(m_pMem.get())+offset, size);
+		return std::error_code();
+	}
+
+	template <class T>
+	static void drain(void *reg, void *dst, size_t count) {
+		const volatile T *r = static_cast<const volatile T*>(reg);
+		T *d = static_cast<T*>(dst);
+		for (size_t i = 0; i < count; i++)
+			d[i] = *r;
+	}
+
+	template <class T>
+	static void fill(void *reg, const void *src, size_t count) {
+		volatile T *r = static_cast<volatile T*>(reg);
+		const T *s = static_cast<const T*>(src);
+		for (size_t i = 0; i < count; i++)
+			*r = s[i];
 	}
 
 	BackendMemory_t m_pMem;
 	size_t		m_uSize;
+	unsigned int	m_uAccessWidth;
 };
 
 typedef std::shared_ptr<int> BackendFile_t;
@@ -114,25 +420,47 @@ public:
 	RegBackendFile(BackendFile_t file, size_t size)
 	: m_pFile(file), m_uSize(size) {}
 
+	size_t size() const {
+		return m_uSize;
+	}
+
 private:
 	void write(unsigned int offset, void* value, size_t size) {
 		if (offset + size > m_uSize)
-			throw std::out_of_range("RegBackendFile: Given offset is out of range: " + std::to_string(offset));
+			throwOutOfRange("RegBackendFile", offset);
 
-		lseek(*m_pFile, offset, SEEK_SET);
-		if (-1 == ::write(*m_pFile, value, size))
+		if (this->try_write(offset, value, size))
 			throw std::runtime_error("Error writing to io mapped register");
 	}
 
 	void read(unsigned int offset, void* value, size_t size) {
 		if (offset + size > m_uSize)
-			throw std::out_of_range("RegBackendFile: Given offset is out of range: " + std::to_string(offset));
+			throwOutOfRange("RegBackendFile", offset);
 
-		lseek(*m_pFile, offset, SEEK_SET);
-		if (-1 == ::read(*m_pFile, value, size))
+		if (this->try_read(offset, value, size))
 			throw std::runtime_error("Error reading io mapped register");
 	}
 
+	std::error_code try_write(unsigned int offset, void* value, size_t size) noexcept {
+		if (offset + size > m_uSize)
+			return std::make_error_code(std::errc::result_out_of_range);
+
+		ssize_t written = ::pwrite(*m_pFile, value, size, offset);
+		if (-1 == written)
+			return std::error_code(errno, std::generic_category());
+		return written == (ssize_t)size ? std::error_code() : std::make_error_code(std::errc::io_error);
+	}
+
+	std::error_code try_read(unsigned int offset, void* value, size_t size) noexcept {
+		if (offset + size > m_uSize)
+			return std::make_error_code(std::errc::result_out_of_range);
+
+		ssize_t got = ::pread(*m_pFile, value, size, offset);
+		if (-1 == got)
+			return std::error_code(errno, std::generic_category());
+		return got == (ssize_t)size ? std::error_code() : std::make_error_code(std::errc::io_error);
+	}
+
 	BackendFile_t	m_pFile;
 	size_t		m_uSize;
 };
@@ -144,9 +472,42 @@ public:
 	RegBackendI2CDev(BackendFile_t file, unsigned char slave_addr)
 	: m_pFile(file), m_uSlaveAddr(slave_addr) {}
 
+	// FIFO registers don't auto increment the register address, all words
+	// are transferred in a single transaction
+	void read_repeated(unsigned int offset, void* dst, size_t width, size_t count) {
+		if (this->isIndirect())
+			return IRegBackend::read_repeated(offset, dst, width, count);
+
+		this->read(offset, dst, width * count);
+	}
+
+	void write_repeated(unsigned int offset, const void* src, size_t width, size_t count) {
+		if (this->isIndirect())
+			return IRegBackend::write_repeated(offset, src, width, count);
+
+		this->write(offset, const_cast<void*>(src), width * count);
+	}
+
+	// 8 bit register addresses
+	size_t size() const {
+		return 256;
+	}
+
 private:
 	void write(unsigned int offset, void* value, size_t size) {
 
+		if (this->try_write(offset, value, size))
+			throw std::runtime_error("Write to the i2c dev unsuccessful");
+	}
+
+	void read(unsigned int offset, void* value, size_t size) {
+
+		if (this->try_read(offset, value, size))
+			throw std::runtime_error("Read on the i2c dev unsuccessful");
+	}
+
+	std::error_code try_write(unsigned int offset, void* value, size_t size) noexcept {
+
 		unsigned char outbuf[size+1];
 		struct i2c_rdwr_ioctl_data packets;
 		struct i2c_msg messages[1];
@@ -162,11 +523,12 @@ private:
 		packets.msgs  = messages;
 		packets.nmsgs = 1;
 
-		if (ioctl(*m_pFile, I2C_RDWR, &packets) < 0) 
-			throw std::runtime_error("Write to the i2c dev unsuccessful");
+		if (ioctl(*m_pFile, I2C_RDWR, &packets) < 0)
+			return std::error_code(errno, std::generic_category());
+		return std::error_code();
 	}
 
-	void read(unsigned int offset, void* value, size_t size) {
+	std::error_code try_read(unsigned int offset, void* value, size_t size) noexcept {
 
 		unsigned char outbuf;
 		struct i2c_rdwr_ioctl_data packets;
@@ -186,8 +548,9 @@ private:
 		packets.msgs      = messages;
 		packets.nmsgs     = 2;
 
-		if (ioctl(*m_pFile, I2C_RDWR, &packets) < 0) 
-			throw std::runtime_error("Read on the i2c dev unsuccessful");
+		if (ioctl(*m_pFile, I2C_RDWR, &packets) < 0)
+			return std::error_code(errno, std::generic_category());
+		return std::error_code();
 	}
 
 	BackendFile_t	m_pFile;
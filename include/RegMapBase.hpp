@@ -19,116 +19,135 @@
 
 #include <map>
 #include <boost/format.hpp>
-#include <boost/any.hpp>
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/json_parser.hpp>
 #include "RegisterBase.hpp"
+#include "RegisterArray.hpp"
+#include "RegMapDefinition.hpp"
+#include "reload.hpp"
 
 namespace regmap {
 namespace pt = boost::property_tree;
 
-typedef std::map<std::string, boost::any> RegisterMap_t;
-
 template <class TBackend>
 class RegMapBase {
 
 public:
 	RegMapBase() = delete;
 	virtual ~RegMapBase() {}
-	RegMapBase(std::string defFile)
-        : m_sDefFile(defFile) {
-		this->createFromFile(defFile);
-	}
+	RegMapBase(const DefinitionRef &definition)
+	: m_pDefinition(std::make_shared<DefinitionCell>(definition.get())), m_sDefFile(definition.get()->file()) {}
 
 	std::string defFile() {
 		return m_sDefFile;
 	}
 
+	// the current definition, it stays valid as long as the pointer is
+	// held, even if a reload replaces it in the meantime
+	Definition_t definition() const {
+		return m_pDefinition->get();
+	}
+
 	TBackend& getBackend() {
 		return m_oRegBackend;
 	}
 
+	// Registers are copies, they keep working unchanged after a reload and
+	// keep the definition their name lives in. Looking one up does not take
+	// a lock. The definition was checked against the backend, so its
+	// registers skip the range check.
 	template <class T>
 	T get(std::string key) {
-		try {
-			if (m_oRegisters.end() == m_oRegisters.find(key))
-				throw std::runtime_error("No register found with name " + key);
-
-			return boost::any_cast<T>(m_oRegisters[key]);
-		} catch (const boost::bad_any_cast &ex) {
-			throw std::runtime_error("Invalid register size for " + key);
-		}
+		DefinitionCell::Reader reader(*m_pDefinition);
+		return RegisterBlockRef(reader->registers(), m_oRegBackend, 0, reader.get(), true).template get<T>(key);
 	}
 
-private:
-	void createFromFile(const std::string &filename) {
-
-		pt::ptree pTree;
-		try {
-			pt::read_json(filename, pTree);
-		} catch (...) {
-			throw std::runtime_error("Definition file could not be parsed: " + filename);
-		}
-
-		// parse and create all registers
-		for (auto &node : pTree.get_child("registers")) {
-
-			std::string key = node.first;
-			unsigned int offset = static_cast<unsigned int>(strtoul(node.second.get<std::string>("offset").c_str(), NULL, 0));
-			unsigned int size = static_cast<unsigned int>(strtoul(node.second.get<std::string>("size").c_str(), NULL, 0));
-			unsigned int busy_mask = static_cast<unsigned int>(strtoul(node.second.get<std::string>("busy_mask", "0").c_str(), NULL, 0));
-			unsigned int ready_mask = static_cast<unsigned int>(strtoul(node.second.get<std::string>("ready_mask", "0").c_str(), NULL, 0));
-			unsigned int access_mask = static_cast<unsigned int>(strtoul(node.second.get<std::string>("access_mask", "0xFFFFFFFF").c_str(), NULL, 0));
-			unsigned int reset_mask = static_cast<unsigned int>(strtoul(node.second.get<std::string>("reset_mask", "0xFFFFFFFF").c_str(), NULL, 0));
-			unsigned int start_mask = static_cast<unsigned int>(strtoul(node.second.get<std::string>("start_mask", "0xFFFFFFFF").c_str(), NULL, 0));
-			unsigned int freeze_mask = static_cast<unsigned int>(strtoul(node.second.get<std::string>("freeze_mask", "0xFFFFFFFF").c_str(), NULL, 0));
-			switch (size) {
-				case 1:
-				m_oRegisters[key] = Register8_t(key, m_oRegBackend, offset, static_cast<std::uint8_t>(busy_mask), static_cast<std::uint8_t>(ready_mask), static_cast<std::uint8_t>(access_mask), static_cast<std::uint8_t>(reset_mask), static_cast<std::uint8_t>(start_mask), static_cast<std::uint8_t>(freeze_mask));
-				break;
-
-				case 2:
-				m_oRegisters[key] = Register16_t(key, m_oRegBackend, offset, static_cast<std::uint16_t>(busy_mask), static_cast<std::uint16_t>(ready_mask), static_cast<std::uint16_t>(access_mask), static_cast<std::uint16_t>(reset_mask), static_cast<std::uint16_t>(start_mask), static_cast<std::uint16_t>(freeze_mask));
-				break;
-
-				case 4:
-				m_oRegisters[key] = Register32_t(key, m_oRegBackend, offset, static_cast<std::uint32_t>(busy_mask), static_cast<std::uint32_t>(ready_mask), static_cast<std::uint32_t>(access_mask), static_cast<std::uint32_t>(reset_mask), static_cast<std::uint32_t>(start_mask), static_cast<std::uint32_t>(freeze_mask));
-				break;
-
-				default:
-				throw std::runtime_error("Size out of range for register " + key);
-				break;
-			}
+	// element of an array of single registers
+	template <class T>
+	T get(const std::string &key, unsigned int index) {
+		DefinitionCell::Reader reader(*m_pDefinition);
+		return RegisterBlockRef(reader->registers(), m_oRegBackend, 0, reader.get(), true).array(key).template get<T>(index);
+	}
 
-			// parse defined bitmasks
-			try {
-				for (auto &bitmask : node.second.get_child("bitmasks")) {
+	// array of registers or register blocks, the offsets of its elements
+	// are computed on access. The array keeps its definition alive.
+	RegisterArrayRef array(const std::string &key) {
+		Definition_t definition = this->definition();
+		return RegisterBlockRef(definition->registers(), m_oRegBackend, 0, definition, true).array(key);
+	}
 
-					std::string maskName = bitmask.first;
-					long value = strtoul(bitmask.second.data().c_str(), NULL, 0);
+	// view on a device memory range declared in the "regions" section
+	RegionView region(const std::string &key) {
 
-					switch (size) {
-						case 1:
-						boost::any_cast<Register8_t&>(m_oRegisters[key]).addBitmask(maskName, (std::uint8_t)(value));
-						break;
+		Definition_t definition = this->definition();
+		auto it = definition->regions().find(key);
+		if (definition->regions().end() == it)
+			throw std::runtime_error("No region found with name " + key);
 
-						case 2:
-						boost::any_cast<Register16_t&>(m_oRegisters[key]).addBitmask(maskName, (std::uint16_t)(value));
-						break;
+		return RegionView(it->first, it->second, m_oRegBackend, definition);
+	}
 
-						case 4:
-						boost::any_cast<Register32_t&>(m_oRegisters[key]).addBitmask(maskName, (std::uint32_t)(value));
-						break;
-					}
-				}
+	// reads all registers, adjacent ones in a single transfer, see regmap::dump
+	Snapshot dump(unsigned int maxGap = 0, std::size_t maxBurst = 0) {
+		return regmap::dump(this->definition()->layout(), m_oRegBackend, maxGap, maxBurst);
+	}
+
+	// Parses the definition file again and swaps it in. Registers, arrays
+	// and regions obtained before keep using the previous definition.
+	// Throws if the file can not be parsed or does not fit the backend,
+	// the current definition stays in place then.
+	Definition_t reload() {
+		return m_pDefinition->reload(m_sDefFile, m_oRegBackend.size());
+	}
+
+	// Reloads the definition in the background whenever its file changes.
+	// Access threads are never blocked, the watcher waits for their read
+	// sections to end before it releases a replaced definition.
+	void autoReload(const ReloadCallback_t &callback = ReloadCallback_t()) {
+
+		std::shared_ptr<DefinitionCell> cell = m_pDefinition;
+		std::string file = m_sDefFile;
+		std::size_t size = m_oRegBackend.size();
+
+		m_pWatcher.reset();
+		m_pWatcher = std::make_shared<DefinitionWatcher>(file, [cell, file, size, callback]() {
+			Definition_t definition;
+			std::exception_ptr error;
+			try {
+				definition = cell->reload(file, size);
+			} catch (...) {
+				error = std::current_exception();
 			}
-			catch (const pt::ptree_bad_path &ex) {}
-		}
+
+			if (callback)
+				callback(definition, error);
+		});
 	}
 
-	RegisterMap_t	m_oRegisters;
+	void stopReload() {
+		m_pWatcher.reset();
+	}
+
+	// number of definitions swapped in since the map was created
+	std::uint64_t reloads() const {
+		return m_pDefinition->reloads();
+	}
+
+private:
+	// shared by copies of the map
+	std::shared_ptr<DefinitionCell>		m_pDefinition;
+	std::shared_ptr<DefinitionWatcher>	m_pWatcher;
 
 protected:
+	// Binds the map to its backend. All registers and regions are checked
+	// against the backend's size once, so their accesses may skip the check.
+	void setBackend(const TBackend &backend) {
+
+		m_oRegBackend = backend;
+		this->definition()->check(m_oRegBackend.size());
+		m_oRegBackend.validated();
+	}
+
 	TBackend	m_oRegBackend;
 	std::string	m_sDefFile;
 };
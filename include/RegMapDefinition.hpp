@@ -0,0 +1,124 @@
+/* This file is part of libregmap.
+ *
+ * libregmap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libregmap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libregmap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __RegMapDefinition__
+#define __RegMapDefinition__
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <boost/property_tree/ptree.hpp>
+#include "RegisterBase.hpp"
+#include "RegisterArray.hpp"
+#include "RegionView.hpp"
+#include "snapshot.hpp"
+
+namespace regmap {
+namespace pt = boost::property_tree;
+
+class RegMapDefinition;
+typedef std::shared_ptr<const RegMapDefinition> Definition_t;
+
+// The parsed content of a definition file. A definition is immutable once
+// loaded and shared by all register maps created from it, its registers are
+// bound to a map's backend on access. Register names are interned in one
+// string pool, registers with the same bitmasks share one table.
+class RegMapDefinition {
+
+public:
+	RegMapDefinition() = delete;
+	RegMapDefinition(const RegMapDefinition&) = delete;
+	explicit RegMapDefinition(const std::string &defFile);
+
+	// returns the definition already loaded from the file if there is one
+	// and the file was not modified since, parses the file otherwise
+	static Definition_t load(const std::string &defFile);
+
+	const std::string& file() const {
+		return m_sDefFile;
+	}
+
+	const RegisterBlock& registers() const {
+		return m_oRegisters;
+	}
+
+	const RegionMap_t& regions() const {
+		return m_oRegions;
+	}
+
+	// default byte order of the registers
+	eEndian endian() const {
+		return m_eEndian;
+	}
+
+	// all registers in offset order, built on first use
+	const Layout_t& layout() const;
+
+	// throws std::out_of_range if a register or region exceeds size bytes,
+	// a size of 0 is not checked
+	void check(std::size_t size) const;
+
+	// backend of the registers stored in definitions, it ignores all accesses
+	static IRegBackend& unbound();
+
+private:
+	void parseRegions(const pt::ptree &regions);
+	void parseRegisters(const pt::ptree &registers, const pt::ptree *mapAliases, RegisterBlock &block);
+	RegisterEntry createRegister(const std::string &key, const pt::ptree &node, const pt::ptree *mapAliases);
+	Bitmasks_t share(std::vector<std::pair<std::string, std::uint32_t> > bitmasks);
+
+	std::string	m_sDefFile;
+	StringPool	m_oNames;
+	RegisterBlock	m_oRegisters;
+	RegionMap_t	m_oRegions;
+	eEndian		m_eEndian;
+	// bitmask tables by content while parsing
+	std::map<std::vector<std::pair<std::string, std::uint32_t> >, Bitmasks_t>	m_oBitmaskTables;
+
+	mutable std::once_flag	m_oLayoutOnce;
+	mutable Layout_t	m_pLayout;
+};
+
+// Either the name of a definition file or an already loaded definition
+class DefinitionRef {
+
+public:
+	DefinitionRef(const std::string &defFile)
+	: m_pDefinition(RegMapDefinition::load(defFile)) {}
+
+	DefinitionRef(const char *defFile)
+	: m_pDefinition(RegMapDefinition::load(defFile)) {}
+
+	DefinitionRef(const Definition_t &definition)
+	: m_pDefinition(definition) {
+
+		if (!m_pDefinition)
+			throw std::runtime_error("No register map definition given");
+	}
+
+	const Definition_t& get() const {
+		return m_pDefinition;
+	}
+
+private:
+	Definition_t m_pDefinition;
+};
+
+};
+
+#endif
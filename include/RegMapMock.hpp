@@ -25,10 +25,10 @@ namespace regmap {
 class RegMapMock : public RegMapBase<RegBackendMemory> {
 
 public:
-	RegMapMock(std::string defFile, unsigned int size)
-	: RegMapBase(defFile), m_pMemory(malloc(size), free) {
+	RegMapMock(const DefinitionRef &definition, unsigned int size)
+	: RegMapBase(definition), m_pMemory(malloc(size), free) {
 		m_oRegBackendMemory = RegBackendMemory(m_pMemory, size);
-		m_oRegBackend = m_oRegBackendMemory;
+		this->setBackend(m_oRegBackendMemory);
 	}
 
 private:
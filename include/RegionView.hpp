@@ -0,0 +1,193 @@
+/* This file is part of libregmap.
+ *
+ * libregmap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libregmap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libregmap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __RegionView__
+#define __RegionView__
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include "IRegBackend.hpp"
+#include "bulk.hpp"
+
+namespace regmap {
+
+// A named range of device memory like a packet buffer, a lookup table or
+// a mailbox. Its elements are accessed with width bytes at a time.
+struct Region {
+
+	Region(unsigned int offset, std::size_t size, unsigned int width)
+	: m_uOffset(offset), m_uSize(size), m_uWidth(width) {}
+
+	unsigned int	m_uOffset;
+	std::size_t	m_uSize;
+	unsigned int	m_uWidth;
+};
+
+typedef std::map<std::string, Region> RegionMap_t;
+
+// Bounds checked array of volatile elements directly on the mapping
+template <class T>
+class Span {
+
+public:
+	typedef volatile T* iterator;
+
+	Span(volatile T *data, std::size_t count)
+	: m_pData(data), m_uCount(count) {}
+
+	std::size_t size() const {
+		return m_uCount;
+	}
+
+	volatile T* data() const {
+		return m_pData;
+	}
+
+	iterator begin() const {
+		return m_pData;
+	}
+
+	iterator end() const {
+		return m_pData + m_uCount;
+	}
+
+	volatile T& operator[](std::size_t index) const {
+
+		if (index >= m_uCount)
+			throw std::out_of_range("Span index out of range: " + std::to_string(index));
+
+		return m_pData[index];
+	}
+
+private:
+	volatile T	*m_pData;
+	std::size_t	m_uCount;
+};
+
+// A region placed on a backend. On memory mapped backends all accesses go
+// straight to the mapping, other backends read and write through the bus.
+class RegionView {
+
+public:
+	// owner keeps the region's definition alive as long as the view
+	RegionView(const std::string &name, const Region &region, IRegBackend &backend,
+			const std::shared_ptr<const void> &owner = std::shared_ptr<const void>())
+	: m_pName(&name), m_pRegion(&region), m_pBackend(&backend),
+	  m_pMapping(static_cast<unsigned char*>(backend.mapping(region.m_uOffset, region.m_uSize))), m_pOwner(owner) {}
+
+	unsigned int getOffset() const {
+		return m_pRegion->m_uOffset;
+	}
+
+	std::size_t size() const {
+		return m_pRegion->m_uSize;
+	}
+
+	unsigned int width() const {
+		return m_pRegion->m_uWidth;
+	}
+
+	bool mapped() const {
+		return m_pMapping != NULL;
+	}
+
+	// zero copy view, only available on memory mapped backends
+	template <class T>
+	Span<T> span() const {
+
+		this->checkWidth(sizeof(T));
+		if (!m_pMapping)
+			throw std::runtime_error("Region " + *m_pName + " is not memory mapped");
+
+		return Span<T>(reinterpret_cast<volatile T*>(m_pMapping), m_pRegion->m_uSize / sizeof(T));
+	}
+
+	template <class T>
+	T get(std::size_t index) const {
+
+		this->checkWidth(sizeof(T));
+		this->checkRange(index * sizeof(T), sizeof(T));
+		if (m_pMapping)
+			return reinterpret_cast<volatile T*>(m_pMapping)[index];
+
+		return m_pBackend->get<T>(m_pRegion->m_uOffset + index * sizeof(T));
+	}
+
+	template <class T>
+	void set(std::size_t index, T value) const {
+
+		this->checkWidth(sizeof(T));
+		this->checkRange(index * sizeof(T), sizeof(T));
+		if (m_pMapping)
+			reinterpret_cast<volatile T*>(m_pMapping)[index] = value;
+		else
+			m_pBackend->set<T>(m_pRegion->m_uOffset + index * sizeof(T), value);
+	}
+
+	// bulk transfers relative to the start of the region, mapped regions
+	// are accessed with the region's width
+	void read(std::size_t offset, void *dst, std::size_t size) const {
+
+		this->checkRange(offset, size);
+		if (m_pMapping)
+			copyFromDevice(dst, m_pMapping + offset, size, m_pRegion->m_uWidth);
+		else
+			m_pBackend->copy_from_device(m_pRegion->m_uOffset + offset, dst, size);
+	}
+
+	void write(std::size_t offset, const void *src, std::size_t size) const {
+
+		this->checkRange(offset, size);
+		if (m_pMapping)
+			copyToDevice(m_pMapping + offset, src, size, m_pRegion->m_uWidth);
+		else
+			m_pBackend->copy_to_device(m_pRegion->m_uOffset + offset, src, size);
+	}
+
+	// buffered copy of the whole region
+	template <class T>
+	std::vector<T> buffer() const {
+
+		this->checkWidth(sizeof(T));
+		std::vector<T> data(m_pRegion->m_uSize / sizeof(T));
+		this->read(0, data.data(), data.size() * sizeof(T));
+		return data;
+	}
+
+private:
+	void checkWidth(std::size_t width) const {
+		if (width != m_pRegion->m_uWidth)
+			throw std::runtime_error("Invalid access width for region " + *m_pName);
+	}
+
+	void checkRange(std::size_t offset, std::size_t size) const {
+		if (offset > m_pRegion->m_uSize || size > m_pRegion->m_uSize - offset)
+			throw std::out_of_range("Access out of range for region " + *m_pName + ": " + std::to_string(offset));
+	}
+
+	const std::string	*m_pName;
+	const Region		*m_pRegion;
+	IRegBackend		*m_pBackend;
+	unsigned char		*m_pMapping;
+	std::shared_ptr<const void>	m_pOwner;
+};
+
+};
+
+#endif
@@ -0,0 +1,230 @@
+/* This file is part of libregmap.
+ *
+ * libregmap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libregmap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libregmap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __RegisterArray__
+#define __RegisterArray__
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include "RegisterBase.hpp"
+
+namespace regmap {
+
+typedef std::vector<RegisterEntry> RegisterTable_t;
+
+struct RegisterArray;
+typedef std::map<std::string, RegisterArray> ArrayMap_t;
+
+// Registers and nested arrays at offsets relative to the start of the
+// block. The registers are stored contiguously in offset order, names are
+// looked up through an open addressing hash index of positions in the
+// table.
+struct RegisterBlock {
+
+	// registers with the same name replace each other, call seal() when
+	// done. The name has to outlive the block, e.g. by interning it.
+	void insert(const RegisterEntry &entry) {
+
+		if (2 * (m_oRegisters.size() + 1) > m_oIndex.size())
+			this->rehash(std::max<std::size_t>(16, 2 * m_oIndex.size()));
+
+		std::size_t slot = this->slot(entry.m_pName);
+		if (m_oIndex[slot]) {
+			m_oRegisters[m_oIndex[slot] - 1] = entry;
+			return;
+		}
+
+		m_oRegisters.push_back(entry);
+		m_oIndex[slot] = static_cast<std::uint32_t>(m_oRegisters.size());
+	}
+
+	void insert(const char *name, unsigned int offset, unsigned int size) {
+		this->insert(RegisterEntry(name, offset, size));
+	}
+
+	// sorts the registers by offset and rebuilds the index
+	void seal() {
+
+		std::stable_sort(m_oRegisters.begin(), m_oRegisters.end(), [](const RegisterEntry &a, const RegisterEntry &b) {
+			return a.m_uOffset < b.m_uOffset;
+		});
+
+		m_oRegisters.shrink_to_fit();
+		std::size_t capacity = 16;
+		while (capacity < 2 * m_oRegisters.size())
+			capacity *= 2;
+		this->rehash(capacity);
+	}
+
+	const RegisterEntry* find(const std::string &name) const {
+
+		if (m_oIndex.empty())
+			return NULL;
+
+		std::uint32_t position = m_oIndex[this->slot(name.c_str())];
+		return position ? &m_oRegisters[position - 1] : NULL;
+	}
+
+	// registers starting in [begin, end)
+	std::pair<RegisterTable_t::const_iterator, RegisterTable_t::const_iterator> range(unsigned int begin, unsigned int end) const {
+
+		auto less = [](const RegisterEntry &entry, unsigned int offset) { return entry.m_uOffset < offset; };
+		auto first = std::lower_bound(m_oRegisters.begin(), m_oRegisters.end(), begin, less);
+		auto last = std::lower_bound(first, m_oRegisters.end(), std::max(begin, end), less);
+		return std::make_pair(first, last);
+	}
+
+	RegisterTable_t			m_oRegisters;
+	// position + 1 in m_oRegisters, 0 for free slots, a power of two in size
+	std::vector<std::uint32_t>	m_oIndex;
+	ArrayMap_t			m_oArrays;
+
+private:
+	static std::size_t hash(const char *name) {
+
+		// FNV-1a
+		std::size_t h = 14695981039346656037ull;
+		for (; *name; name++)
+			h = (h ^ static_cast<unsigned char>(*name)) * 1099511628211ull;
+		return h;
+	}
+
+	// slot of the name, or the free slot it belongs into
+	std::size_t slot(const char *name) const {
+
+		std::size_t mask = m_oIndex.size() - 1;
+		std::size_t i = hash(name) & mask;
+		while (m_oIndex[i] && strcmp(m_oRegisters[m_oIndex[i] - 1].m_pName, name))
+			i = (i + 1) & mask;
+		return i;
+	}
+
+	void rehash(std::size_t capacity) {
+
+		std::vector<std::uint32_t>(capacity, 0).swap(m_oIndex);
+		for (std::size_t i = 0; i < m_oRegisters.size(); i++)
+			m_oIndex[this->slot(m_oRegisters[i].m_pName)] = static_cast<std::uint32_t>(i + 1);
+	}
+};
+
+// count elements of the same layout, stride bytes apart. The layout is
+// stored once, elements are created on access. Arrays of single registers
+// hold a block containing just that register under the array's name.
+struct RegisterArray {
+
+	RegisterArray(unsigned int offset, unsigned int count, unsigned int stride)
+	: m_uOffset(offset), m_uCount(count), m_uStride(stride), m_pElement(std::make_shared<RegisterBlock>()) {}
+
+	unsigned int			m_uOffset;
+	unsigned int			m_uCount;
+	unsigned int			m_uStride;
+	std::shared_ptr<RegisterBlock>	m_pElement;
+};
+
+class RegisterArrayRef;
+
+// A block placed at an absolute offset of a backend, e.g. one element of an
+// array. Registers of a validated block were checked against the backend's
+// size, see RegMapBase::setBackend.
+class RegisterBlockRef {
+
+public:
+	RegisterBlockRef(const RegisterBlock &block, IRegBackend &backend, unsigned int base, const Owner_t &owner = Owner_t(),
+			bool validated = false)
+	: m_pBlock(&block), m_pBackend(&backend), m_uBase(base), m_pOwner(owner), m_bValidated(validated) {}
+
+	unsigned int getOffset() const {
+		return m_uBase;
+	}
+
+	template <class T>
+	T get(const std::string &key) const {
+
+		const RegisterEntry *entry = m_pBlock->find(key);
+		if (!entry)
+			throw std::runtime_error("No register found with name " + key);
+
+		if (entry->m_uSize != sizeof(typename T::value_type))
+			throw std::runtime_error("Invalid register size for " + key);
+
+		return T(*entry, *m_pBackend, m_uBase + entry->m_uOffset, m_pOwner, m_bValidated);
+	}
+
+	RegisterArrayRef array(const std::string &key) const;
+
+private:
+	const RegisterBlock	*m_pBlock;
+	IRegBackend		*m_pBackend;
+	unsigned int		m_uBase;
+	Owner_t			m_pOwner;
+	bool			m_bValidated;
+};
+
+class RegisterArrayRef {
+
+public:
+	RegisterArrayRef(const std::string &name, const RegisterArray &array, IRegBackend &backend, unsigned int base,
+			const Owner_t &owner = Owner_t(), bool validated = false)
+	: m_pName(&name), m_pArray(&array), m_pBackend(&backend), m_uBase(base), m_pOwner(owner), m_bValidated(validated) {}
+
+	unsigned int size() const {
+		return m_pArray->m_uCount;
+	}
+
+	unsigned int stride() const {
+		return m_pArray->m_uStride;
+	}
+
+	RegisterBlockRef operator[](unsigned int index) const {
+
+		if (index >= m_pArray->m_uCount)
+			throw std::out_of_range("Index " + std::to_string(index) + " out of range for array " + *m_pName);
+
+		return RegisterBlockRef(*m_pArray->m_pElement, *m_pBackend, m_uBase + m_pArray->m_uOffset + index * m_pArray->m_uStride, m_pOwner, m_bValidated);
+	}
+
+	// element of an array of single registers
+	template <class T>
+	T get(unsigned int index) const {
+		return this->operator[](index).template get<T>(*m_pName);
+	}
+
+private:
+	const std::string	*m_pName;
+	const RegisterArray	*m_pArray;
+	IRegBackend		*m_pBackend;
+	unsigned int		m_uBase;
+	Owner_t			m_pOwner;
+	bool			m_bValidated;
+};
+
+inline RegisterArrayRef RegisterBlockRef::array(const std::string &key) const {
+
+	auto it = m_pBlock->m_oArrays.find(key);
+	if (m_pBlock->m_oArrays.end() == it)
+		throw std::runtime_error("No register array found with name " + key);
+
+	return RegisterArrayRef(it->first, it->second, *m_pBackend, m_uBase, m_pOwner, m_bValidated);
+}
+
+};
+
+#endif
@@ -22,14 +22,26 @@
 #include <iostream>
 #include <chrono>
 #include <map>
+#include <limits>
 #include "IRegBackend.hpp"
+#include "RegisterExpression.hpp"
+#include "descriptor.hpp"
 
 namespace regmap {
 
 template <class T>
-class RegisterBase {
+class RegisterBase : public expr::RegisterTag {
+
+	typedef expr::Leaf<T> Leaf_t;
+	typedef expr::Const<T> Const_t;
+	template <class Op>
+	using Binary_t = expr::Binary<Op, Leaf_t, Const_t>;
+	typedef expr::Binary<expr::Equal, Binary_t<expr::And>, Const_t> IsSet_t;
 
 public:
+	typedef T value_type;
+	static const unsigned int NO_ALIAS = std::numeric_limits<unsigned int>::max();
+
 	RegisterBase() = delete;
 	RegisterBase(const RegisterBase&) = default;
 	RegisterBase(RegisterBase&&) = default;
@@ -44,7 +56,8 @@ public:
 		T reset_mask,
 		T start_mask,
 		T freeze_mask)
-	: m_sRegName(regName),
+	: m_pNameOwner(std::make_shared<std::string>(regName)),
+	  m_pName(static_cast<const std::string*>(m_pNameOwner.get())->c_str()),
 	  m_oRegBackend(regBackend),
 	  m_uOffset(offset),
 	  m_uBusyMask(busy_mask),
@@ -52,22 +65,117 @@ public:
 	  m_uAccessMask(access_mask),
 	  m_uResetMask(reset_mask),
 	  m_uStartMask(start_mask),
-          m_uFreezeMask(freeze_mask) {}
+          m_uFreezeMask(freeze_mask),
+	  m_uSetAlias(NO_ALIAS),
+	  m_uClearAlias(NO_ALIAS),
+	  m_uToggleAlias(NO_ALIAS),
+	  m_eEndian(HOST_ENDIAN),
+	  m_bValidated(false) {}
+
+	// copy of a register placed at another offset of a backend, e.g. an
+	// array element or a register of a shared definition
+	RegisterBase(const RegisterBase &other, IRegBackend &regBackend, unsigned int offset)
+	: m_pNameOwner(other.m_pNameOwner),
+	  m_pName(other.m_pName),
+	  m_oRegBackend(regBackend),
+	  m_uOffset(offset),
+	  m_pBitmasks(other.m_pBitmasks),
+	  m_uBusyMask(other.m_uBusyMask),
+	  m_uReadyMask(other.m_uReadyMask),
+	  m_uAccessMask(other.m_uAccessMask),
+	  m_uResetMask(other.m_uResetMask),
+	  m_uStartMask(other.m_uStartMask),
+	  m_uFreezeMask(other.m_uFreezeMask),
+	  m_uSetAlias(other.m_uSetAlias),
+	  m_uClearAlias(other.m_uClearAlias),
+	  m_uToggleAlias(other.m_uToggleAlias),
+	  m_eEndian(other.m_eEndian),
+	  m_bValidated(false) {}
+
+	RegisterBase(const RegisterBase &other, unsigned int offset)
+	: RegisterBase(other, other.m_oRegBackend, offset) {}
+
+	// register of a definition placed at an offset of a backend, it shares
+	// the interned name and the bitmask table of the definition and keeps
+	// owner, the definition, alive for the name. Validated registers were
+	// checked against the backend's size and skip the check on every access.
+	RegisterBase(const RegisterEntry &entry, IRegBackend &regBackend, unsigned int offset, const Owner_t &owner,
+			bool validated = false)
+	: m_pNameOwner(owner),
+	  m_pName(entry.m_pName),
+	  m_oRegBackend(regBackend),
+	  m_uOffset(offset),
+	  m_pBitmasks(entry.m_pBitmasks),
+	  m_uBusyMask(static_cast<T>(entry.m_uBusyMask)),
+	  m_uReadyMask(static_cast<T>(entry.m_uReadyMask)),
+	  m_uAccessMask(static_cast<T>(entry.m_uAccessMask)),
+	  m_uResetMask(static_cast<T>(entry.m_uResetMask)),
+	  m_uStartMask(static_cast<T>(entry.m_uStartMask)),
+	  m_uFreezeMask(static_cast<T>(entry.m_uFreezeMask)),
+	  m_uSetAlias(entry.m_uSetAlias),
+	  m_uClearAlias(entry.m_uClearAlias),
+	  m_uToggleAlias(entry.m_uToggleAlias),
+	  m_eEndian(entry.m_eEndian),
+	  m_bValidated(validated) {}
+
+	std::string getName() const {
+		return m_pName;
+	}
+
+	unsigned int getOffset() const {
+		return m_uOffset;
+	}
 
-	const std::string& getName() {
-		return m_sRegName;
+	IRegBackend& getBackend() const {
+		return m_oRegBackend;
 	}
 
-	unsigned int getOffset() {
-		return m_uOffset;
+	T getAccessMask() const {
+		return m_uAccessMask;
+	}
+
+	const BitmaskTable& getBitmasks() const {
+		return m_pBitmasks ? *m_pBitmasks : BitmaskTable::none();
+	}
+
+	// byte order of the register on the device, taken from the definition at
+	// runtime. Every access checks it and converts values in the other order.
+	eEndian getEndian() const {
+		return m_eEndian;
+	}
+
+	void setEndian(eEndian order) {
+		m_eEndian = order;
+	}
+
+	bool isValidated() const {
+		return m_bValidated;
 	}
 
 	void set(const T& value) {
-		m_oRegBackend.set(m_uOffset, value & m_uAccessMask);
+		T device = toDevice<T>(value & m_uAccessMask, m_eEndian);
+		if (m_bValidated)
+			m_oRegBackend.store_unchecked<T>(m_uOffset, device);
+		else
+			m_oRegBackend.set<T>(m_uOffset, device);
 	}
 
 	T get() const {
-		return (m_oRegBackend.get<T>(m_uOffset) & m_uAccessMask);
+		T device = m_bValidated ? m_oRegBackend.fetch_unchecked<T>(m_uOffset) : m_oRegBackend.get<T>(m_uOffset);
+		return (toHost<T>(device, m_eEndian) & m_uAccessMask);
+	}
+
+	// accesses without exceptions, for loops that handle bus errors themselves
+	Result<T> try_get() const noexcept {
+		Result<T> value = m_bValidated ? m_oRegBackend.try_fetch_unchecked<T>(m_uOffset) : m_oRegBackend.try_get<T>(m_uOffset);
+		return value ? Result<T>(toHost<T>(value.value_or(0), m_eEndian) & m_uAccessMask) : value;
+	}
+
+	std::error_code try_set(const T& value) noexcept {
+		T device = toDevice<T>(value & m_uAccessMask, m_eEndian);
+		if (m_bValidated)
+			return m_oRegBackend.try_store_unchecked<T>(m_uOffset, device);
+		return m_oRegBackend.try_set<T>(m_uOffset, device);
 	}
 
 	// register access
@@ -80,115 +188,117 @@ public:
 		return this->get();
 	}
 
-	// operator overloading
-	RegisterBase<T> operator^=(const T &mask) {
-		T tmp = this->get();
-		tmp ^= mask;
-		this->set(tmp);
+	// operator overloading, see RegisterExpression.hpp
+	RegisterBase<T>& operator^=(const T &mask) {
+		this->toggle(mask);
 		return *this;
 	}
 
-	T operator^(const T &mask) const {
-		T tmp = this->get();
-		return tmp ^ mask;
+	template <class E>
+	RegisterBase<T>& operator^=(const expr::Expression<E, T> &mask) {
+		return this->update(expr::Xor(), mask);
+	}
+
+	Binary_t<expr::Xor> operator^(const T &mask) const {
+		return Binary_t<expr::Xor>(Leaf_t(*this), Const_t(mask));
 	}
 	
-	T operator^(const typename std::make_signed<T>::type &mask) const {
-		T tmp = this->get();
-		return tmp ^ mask;
+	Binary_t<expr::Xor> operator^(const typename std::make_signed<T>::type &mask) const {
+		return Binary_t<expr::Xor>(Leaf_t(*this), Const_t(mask));
 	}
 
-	RegisterBase<T> operator|=(const T &mask) {
-		T tmp = this->get();
-		tmp |= mask;
-		this->set(tmp);
+	RegisterBase<T>& operator|=(const T &mask) {
+		this->apply(mask);
 		return *this;
 	}
 
-	T operator|(const T &mask) const {
-		T tmp = this->get();
-		return tmp | mask;
+	template <class E>
+	RegisterBase<T>& operator|=(const expr::Expression<E, T> &mask) {
+		return this->update(expr::Or(), mask);
+	}
+
+	Binary_t<expr::Or> operator|(const T &mask) const {
+		return Binary_t<expr::Or>(Leaf_t(*this), Const_t(mask));
 	}
 	
-	T operator|(const typename std::make_signed<T>::type &mask) const {
-		T tmp = this->get();
-		return tmp | mask;
+	Binary_t<expr::Or> operator|(const typename std::make_signed<T>::type &mask) const {
+		return Binary_t<expr::Or>(Leaf_t(*this), Const_t(mask));
 	}
 
-	RegisterBase<T> operator&=(const T &mask) {
-		T tmp = this->get();
-		tmp &= mask;
-		this->set(tmp);
+	RegisterBase<T>& operator&=(const T &mask) {
+		this->clear(static_cast<T>(~mask));
 		return *this;
 	}
+
+	template <class E>
+	RegisterBase<T>& operator&=(const expr::Expression<E, T> &mask) {
+		return this->update(expr::And(), mask);
+	}
 	
-	T operator&(const T &mask) const {
-		T tmp = this->get();
-		return tmp & mask;
+	Binary_t<expr::And> operator&(const T &mask) const {
+		return Binary_t<expr::And>(Leaf_t(*this), Const_t(mask));
 	}
 	
-	T operator&(const typename std::make_signed<T>::type &mask) const {
-		T tmp = this->get();
-		return tmp & mask;
+	Binary_t<expr::And> operator&(const typename std::make_signed<T>::type &mask) const {
+		return Binary_t<expr::And>(Leaf_t(*this), Const_t(mask));
 	}
 	
-	T operator~() const {
-		return ~this->get();
+	expr::Unary<expr::Invert, Leaf_t> operator~() const {
+		return expr::Unary<expr::Invert, Leaf_t>(Leaf_t(*this));
 	}
 	
-	T operator<<(const T &steps) const {
-		T tmp = this->get();
-		return tmp << steps;
+	Binary_t<expr::ShiftLeft> operator<<(const T &steps) const {
+		return Binary_t<expr::ShiftLeft>(Leaf_t(*this), Const_t(steps));
 	}
 
-	T operator<<(const typename std::make_signed<T>::type &steps) const {
-		T tmp = this->get();
-		return tmp << steps;
+	Binary_t<expr::ShiftLeft> operator<<(const typename std::make_signed<T>::type &steps) const {
+		return Binary_t<expr::ShiftLeft>(Leaf_t(*this), Const_t(steps));
 	}
 
-	RegisterBase<T> operator<<=(const T &steps) {
-		T tmp = this->get();
-		tmp <<= steps;
-		this->set(tmp);
+	RegisterBase<T>& operator<<=(const T &steps) {
+		this->set(this->get() << steps);
 		return *this;
 	}
 	
-	T operator>>(const T &steps) const {
-		T tmp = this->get();
-		return tmp >> steps;
+	Binary_t<expr::ShiftRight> operator>>(const T &steps) const {
+		return Binary_t<expr::ShiftRight>(Leaf_t(*this), Const_t(steps));
 	}
 	
-	T operator>>(const typename std::make_signed<T>::type &steps) const {
-		T tmp = this->get();
-		return tmp >> steps;
+	Binary_t<expr::ShiftRight> operator>>(const typename std::make_signed<T>::type &steps) const {
+		return Binary_t<expr::ShiftRight>(Leaf_t(*this), Const_t(steps));
 	}
 
-	RegisterBase<T> operator>>=(const T &steps) {
-		T tmp = this->get();
-		tmp >>= steps;
-		this->set(tmp);
+	RegisterBase<T>& operator>>=(const T &steps) {
+		this->set(this->get() >> steps);
 		return *this;
 	}
 
-	T operator!() const {
-		return !this->get();
+	expr::Unary<expr::LogicalNot, Leaf_t> operator!() const {
+		return expr::Unary<expr::LogicalNot, Leaf_t>(Leaf_t(*this));
 	}
 
-	bool operator==(const T &right) const {
-		return this->get() == right;
+	Binary_t<expr::Equal> operator==(const T &right) const {
+		return Binary_t<expr::Equal>(Leaf_t(*this), Const_t(right));
 	}
 
 	//bool operator==(const typename std::make_signed<T>::type &right) const {
 	//	return this->get() == right;
 	//}
 	
-	bool operator!=(const T &right) const {
-		return this->get() != right;
+	Binary_t<expr::NotEqual> operator!=(const T &right) const {
+		return Binary_t<expr::NotEqual>(Leaf_t(*this), Const_t(right));
 	}
 
 	//bool operator!=(const typename std::make_signed<T>::type &right) const {
 	//	return this->get() != right;
 	//}
+
+	// evaluates the expression and writes the result with a single access
+	template <class E>
+	RegisterBase<T>& operator=(const expr::Expression<E, T> &value) {
+		this->set(value.evaluate());
+		return *this;
+	}
 	
 	operator T() {
 		return this->get();
@@ -198,43 +308,64 @@ public:
 		return operator[](std::string(string));
 	}
 
-	// some helper functions
+	// some helper functions, they return the value written. Registers with
+	// set/clear/toggle aliases write the mask to the alias with a single
+	// access instead of a read-modify-write and return the mask.
 	T apply(const T &mask) {
-		return this->operator|=(mask);
+		if (NO_ALIAS != m_uSetAlias)
+			return this->alias(m_uSetAlias, mask);
+		return this->modify(this->get() | mask);
 	}
 	T clear(const T &mask) {
-		return this->operator&=(~mask);
+		if (NO_ALIAS != m_uClearAlias)
+			return this->alias(m_uClearAlias, mask);
+		return this->modify(this->get() & ~mask);
+	}
+	T toggle(const T &mask) {
+		if (NO_ALIAS != m_uToggleAlias)
+			return this->alias(m_uToggleAlias, mask);
+		return this->modify(this->get() ^ mask);
 	}
-	bool is_set(const T &mask) const {
-		return this->operator&(mask) == mask;
+	IsSet_t is_set(const T &mask) const {
+		return IsSet_t(Binary_t<expr::And>(Leaf_t(*this), Const_t(mask)), Const_t(mask));
 	}
-	bool is_set(const std::string &mask) {
-		T bitmask = this->operator[](mask);
-		return this->operator&(bitmask) == bitmask;
+	IsSet_t is_set(const std::string &mask) {
+		return this->is_set(this->operator[](mask));
 	}
 
 	// start mask
 	T start() {
-		return this->operator|=(m_uStartMask);
+		return this->apply(m_uStartMask);
 	}
 	T stop() {
-		return this->operator&=(~m_uStartMask);
+		return this->clear(m_uStartMask);
 	}
 
 	// reset mask
 	T reset() {
-		return this->operator|=(m_uResetMask);
+		return this->apply(m_uResetMask);
 	}
 	T clear_reset() {
-		return this->operator&=(~m_uResetMask);
+		return this->clear(m_uResetMask);
 	}
 
 	// freeze mask
 	T freeze() {
-		return this->operator|=(m_uFreezeMask);
+		return this->apply(m_uFreezeMask);
 	}
 	T unfreeze() {
-		return this->operator&=(~m_uFreezeMask);
+		return this->clear(m_uFreezeMask);
+	}
+
+	// alias offsets relative to the register, NO_ALIAS if there is none
+	void setAliases(unsigned int setAlias, unsigned int clearAlias, unsigned int toggleAlias) {
+		m_uSetAlias = setAlias;
+		m_uClearAlias = clearAlias;
+		m_uToggleAlias = toggleAlias;
+	}
+
+	bool has_aliases() const {
+		return NO_ALIAS != m_uSetAlias || NO_ALIAS != m_uClearAlias || NO_ALIAS != m_uToggleAlias;
 	}
 
 	// busy and ready mask related functions
@@ -267,20 +398,50 @@ public:
 	// bitmask accessor
 	T operator[](const std::string &name);
 
+	// copies the bitmask table on the first change, registers sharing it
+	// are not affected
 	void addBitmask(const std::string &name, T mask);
 		
 
 protected:
-	std::string			m_sRegName;
+	T modify(T value) {
+		this->set(value);
+		return value & m_uAccessMask;
+	}
+
+	T alias(unsigned int alias, T mask) {
+		T value = mask & m_uAccessMask;
+		m_oRegBackend.set<T>(m_uOffset + alias, value, m_eEndian);
+		return value;
+	}
+
+	// read-modify-write with this register read once, even if it is part of
+	// the operand as well
+	template <class Op, class E>
+	RegisterBase<T>& update(Op, const expr::Expression<E, T> &operand) {
+		expr::Context<T> ctx;
+		T value = ctx.fetch(*this);
+		this->set(Op::apply(value, operand.self().eval(ctx)));
+		return *this;
+	}
+
+	// the name is shared with the definition or a copy of the register
+	Owner_t				m_pNameOwner;
+	const char			*m_pName;
 	IRegBackend&			m_oRegBackend;
 	unsigned int			m_uOffset;
-	std::map<std::string, T>	m_oBitmasks;
+	Bitmasks_t			m_pBitmasks;
 	T				m_uBusyMask;
 	T				m_uReadyMask;
 	T				m_uAccessMask;
 	T				m_uResetMask;
 	T				m_uStartMask;
 	T				m_uFreezeMask;
+	unsigned int			m_uSetAlias;
+	unsigned int			m_uClearAlias;
+	unsigned int			m_uToggleAlias;
+	eEndian				m_eEndian;
+	bool				m_bValidated;
 
 	friend std::ostream& operator<<(std::ostream& os, const RegisterBase<T>& obj) {
 		os << (T)obj;
@@ -288,6 +449,8 @@ protected:
 	}
 };
 
+template <class T>
+const unsigned int RegisterBase<T>::NO_ALIAS;
 
 typedef RegisterBase<std::uint32_t> Register32_t;
 typedef RegisterBase<std::uint16_t> Register16_t;
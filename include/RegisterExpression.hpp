@@ -0,0 +1,384 @@
+/* This file is part of libregmap.
+ *
+ * libregmap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libregmap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libregmap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __RegisterExpression__
+#define __RegisterExpression__
+
+#include <cstdint>
+#include <ostream>
+#include <type_traits>
+#include "IRegBackend.hpp"
+
+namespace regmap {
+
+template <class T> class RegisterBase;
+
+// Operators on registers do not access the device right away. They build an
+// expression which is evaluated as soon as its value is needed. Every register
+// taking part in an expression is read at most once per evaluation, so
+// (reg & A) | (reg & B) costs a single read and sees a consistent value.
+//
+// Expressions keep the location of the registers they were built from, not
+// the register objects, so they may outlive temporaries like map.get<>().
+// The map owning the backend has to outlive them. Keep in mind that an
+// expression stored with auto is evaluated, i.e. read, on every use, convert
+// it to a value for a snapshot.
+namespace expr {
+
+// register values fetched during one evaluation
+template <class T>
+class Context {
+
+public:
+	Context() : m_uCount(0) {}
+
+	T fetch(const RegisterBase<T> &reg) {
+		return this->fetch(reg.getBackend(), reg.getOffset(), reg.getEndian(), reg.getAccessMask(), reg.isValidated());
+	}
+
+	// reads like RegisterBase::get()
+	T fetch(IRegBackend &backend, unsigned int offset, eEndian order, T accessMask, bool validated) {
+
+		for (std::size_t i = 0; i < m_uCount; i++)
+			if (m_pBackend[i] == &backend && m_uOffset[i] == offset)
+				return m_uValue[i];
+
+		T value = toHost<T>(validated ? backend.fetch_unchecked<T>(offset) : backend.get<T>(offset), order) & accessMask;
+		if (m_uCount < MAX_REGISTERS) {
+			m_pBackend[m_uCount] = &backend;
+			m_uOffset[m_uCount] = offset;
+			m_uValue[m_uCount] = value;
+			m_uCount++;
+		}
+
+		return value;
+	}
+
+private:
+	static const std::size_t MAX_REGISTERS = 8;
+
+	const IRegBackend*	m_pBackend[MAX_REGISTERS];
+	unsigned int		m_uOffset[MAX_REGISTERS];
+	T			m_uValue[MAX_REGISTERS];
+	std::size_t		m_uCount;
+};
+
+struct RegisterTag {};
+struct ExpressionTag {};
+struct ConditionTag {};
+
+// operations
+struct And		{ template <class T> static T apply(T a, T b) { return static_cast<T>(a & b); } };
+struct Or		{ template <class T> static T apply(T a, T b) { return static_cast<T>(a | b); } };
+struct Xor		{ template <class T> static T apply(T a, T b) { return static_cast<T>(a ^ b); } };
+struct ShiftLeft	{ template <class T> static T apply(T a, T b) { return static_cast<T>(a << b); } };
+struct ShiftRight	{ template <class T> static T apply(T a, T b) { return static_cast<T>(a >> b); } };
+struct Invert		{ template <class T> static T apply(T a) { return static_cast<T>(~a); } };
+struct LogicalNot	{ template <class T> static T apply(T a) { return static_cast<T>(!a); } };
+struct Equal		{ template <class T> static bool apply(T a, T b) { return a == b; } };
+struct NotEqual		{ template <class T> static bool apply(T a, T b) { return a != b; } };
+struct LogicalAnd	{ static bool apply(bool a, bool b) { return a && b; } };
+struct LogicalOr	{ static bool apply(bool a, bool b) { return a || b; } };
+
+template <class Op, class L, class R> class Binary;
+template <class Op, class E> class Unary;
+template <class T> class Const;
+
+// Base of all expressions yielding a register value
+template <class E, class T>
+class Expression : public ExpressionTag {
+
+public:
+	typedef T value_type;
+
+	const E& self() const {
+		return static_cast<const E&>(*this);
+	}
+
+	T evaluate() const {
+		Context<T> ctx;
+		return this->self().eval(ctx);
+	}
+
+	operator T() const {
+		return this->evaluate();
+	}
+
+	Binary<Xor, E, Const<T> > operator^(const T &mask) const;
+	Binary<Xor, E, Const<T> > operator^(const typename std::make_signed<T>::type &mask) const;
+	Binary<Or, E, Const<T> > operator|(const T &mask) const;
+	Binary<Or, E, Const<T> > operator|(const typename std::make_signed<T>::type &mask) const;
+	Binary<And, E, Const<T> > operator&(const T &mask) const;
+	Binary<And, E, Const<T> > operator&(const typename std::make_signed<T>::type &mask) const;
+	Binary<ShiftLeft, E, Const<T> > operator<<(const T &steps) const;
+	Binary<ShiftLeft, E, Const<T> > operator<<(const typename std::make_signed<T>::type &steps) const;
+	Binary<ShiftRight, E, Const<T> > operator>>(const T &steps) const;
+	Binary<ShiftRight, E, Const<T> > operator>>(const typename std::make_signed<T>::type &steps) const;
+	Unary<Invert, E> operator~() const;
+	Unary<LogicalNot, E> operator!() const;
+	Binary<Equal, E, Const<T> > operator==(const T &right) const;
+	Binary<Equal, E, Const<T> > operator==(const typename std::make_signed<T>::type &right) const;
+	Binary<NotEqual, E, Const<T> > operator!=(const T &right) const;
+	Binary<NotEqual, E, Const<T> > operator!=(const typename std::make_signed<T>::type &right) const;
+
+	friend std::ostream& operator<<(std::ostream& os, const Expression<E, T>& obj) {
+		os << obj.evaluate();
+		return os;
+	}
+};
+
+// Base of all expressions yielding a truth value
+template <class E, class T>
+class Condition : public ConditionTag {
+
+public:
+	typedef T value_type;
+
+	const E& self() const {
+		return static_cast<const E&>(*this);
+	}
+
+	bool evaluate() const {
+		Context<T> ctx;
+		return this->self().eval(ctx);
+	}
+
+	operator bool() const {
+		return this->evaluate();
+	}
+
+	Unary<LogicalNot, E> operator!() const;
+
+	friend std::ostream& operator<<(std::ostream& os, const Condition<E, T>& obj) {
+		os << obj.evaluate();
+		return os;
+	}
+};
+
+template <class T>
+class Const : public Expression<Const<T>, T> {
+
+public:
+	typedef T result_type;
+
+	explicit Const(T value) : m_uValue(value) {}
+
+	T eval(Context<T>&) const {
+		return m_uValue;
+	}
+
+private:
+	T m_uValue;
+};
+
+template <class T>
+class Leaf : public Expression<Leaf<T>, T> {
+
+public:
+	typedef T result_type;
+
+	explicit Leaf(const RegisterBase<T> &reg)
+	: m_pBackend(&reg.getBackend()), m_uOffset(reg.getOffset()), m_eEndian(reg.getEndian()), m_uAccessMask(reg.getAccessMask()),
+	  m_bValidated(reg.isValidated()) {}
+
+	T eval(Context<T> &ctx) const {
+		return ctx.fetch(*m_pBackend, m_uOffset, m_eEndian, m_uAccessMask, m_bValidated);
+	}
+
+private:
+	IRegBackend	*m_pBackend;
+	unsigned int	m_uOffset;
+	eEndian		m_eEndian;
+	T		m_uAccessMask;
+	bool		m_bValidated;
+};
+
+// the result of an operation is either a register value or a truth value
+template <class E, class T, class R>
+struct ResultBase;
+
+template <class E, class T>
+struct ResultBase<E, T, T> { typedef Expression<E, T> type; };
+
+template <class E, class T>
+struct ResultBase<E, T, bool> { typedef Condition<E, T> type; };
+
+template <class Op, class U>
+struct Result {
+	typedef decltype(Op::apply(std::declval<U>(), std::declval<U>())) type;
+};
+
+template <class Op, class L, class R>
+class Binary : public ResultBase<Binary<Op, L, R>, typename L::value_type,
+		typename Result<Op, typename L::result_type>::type>::type {
+
+	static_assert(std::is_same<typename L::value_type, typename R::value_type>::value,
+		"Registers of different sizes can't be combined in one expression");
+
+public:
+	typedef typename L::value_type value_type;
+	typedef typename Result<Op, typename L::result_type>::type result_type;
+
+	Binary(const L &left, const R &right) : m_oLeft(left), m_oRight(right) {}
+
+	result_type eval(Context<value_type> &ctx) const {
+		return Op::apply(m_oLeft.eval(ctx), m_oRight.eval(ctx));
+	}
+
+private:
+	L m_oLeft;
+	R m_oRight;
+};
+
+template <class Op, class E>
+class Unary : public ResultBase<Unary<Op, E>, typename E::value_type, typename E::result_type>::type {
+
+public:
+	typedef typename E::value_type value_type;
+	typedef typename E::result_type result_type;
+
+	explicit Unary(const E &operand) : m_oOperand(operand) {}
+
+	result_type eval(Context<value_type> &ctx) const {
+		return static_cast<result_type>(Op::apply(m_oOperand.eval(ctx)));
+	}
+
+private:
+	E m_oOperand;
+};
+
+// maps the operands of an operator to expression nodes
+template <class U, class Enable = void>
+struct Node {
+	static const bool value = false;
+};
+
+template <class U>
+struct Node<U, typename std::enable_if<std::is_base_of<RegisterTag, U>::value>::type> {
+	static const bool value = true;
+	typedef Leaf<typename U::value_type> type;
+	static type make(const U &reg) { return type(reg); }
+};
+
+template <class E>
+struct Node<E, typename std::enable_if<std::is_base_of<ExpressionTag, E>::value>::type> {
+	static const bool value = true;
+	typedef E type;
+	static const E& make(const E &e) { return e; }
+};
+
+template <class E>
+struct IsCondition {
+	static const bool value = std::is_base_of<ConditionTag, E>::value;
+};
+
+template <class Op, class L, class R, bool = Node<L>::value && Node<R>::value>
+struct Combined {};
+
+template <class Op, class L, class R>
+struct Combined<Op, L, R, true> {
+	typedef Binary<Op, typename Node<L>::type, typename Node<R>::type> type;
+
+	static type make(const L &left, const R &right) {
+		return type(Node<L>::make(left), Node<R>::make(right));
+	}
+};
+
+template <class Op, class L, class R, bool = IsCondition<L>::value && IsCondition<R>::value>
+struct Connected {};
+
+template <class Op, class L, class R>
+struct Connected<Op, L, R, true> {
+	typedef Binary<Op, L, R> type;
+};
+
+// Operators combining registers and expressions with each other. Operators
+// with plain values as operand are members of RegisterBase and Expression.
+template <class L, class R>
+typename Combined<And, L, R>::type operator&(const L &left, const R &right) {
+	return Combined<And, L, R>::make(left, right);
+}
+
+template <class L, class R>
+typename Combined<Or, L, R>::type operator|(const L &left, const R &right) {
+	return Combined<Or, L, R>::make(left, right);
+}
+
+template <class L, class R>
+typename Combined<Xor, L, R>::type operator^(const L &left, const R &right) {
+	return Combined<Xor, L, R>::make(left, right);
+}
+
+template <class L, class R>
+typename Combined<Equal, L, R>::type operator==(const L &left, const R &right) {
+	return Combined<Equal, L, R>::make(left, right);
+}
+
+template <class L, class R>
+typename Combined<NotEqual, L, R>::type operator!=(const L &left, const R &right) {
+	return Combined<NotEqual, L, R>::make(left, right);
+}
+
+// Conditions are combined lazily as well, which gives up short circuit
+// evaluation for reading every register involved only once.
+template <class L, class R>
+typename Connected<LogicalAnd, L, R>::type operator&&(const L &left, const R &right) {
+	return typename Connected<LogicalAnd, L, R>::type(left, right);
+}
+
+template <class L, class R>
+typename Connected<LogicalOr, L, R>::type operator||(const L &left, const R &right) {
+	return typename Connected<LogicalOr, L, R>::type(left, right);
+}
+
+#define __REGMAP_EXPRESSION_OPERATOR(op, Op) \
+template <class E, class T> \
+Binary<Op, E, Const<T> > Expression<E, T>::operator op(const T &value) const { \
+	return Binary<Op, E, Const<T> >(this->self(), Const<T>(value)); \
+} \
+template <class E, class T> \
+Binary<Op, E, Const<T> > Expression<E, T>::operator op(const typename std::make_signed<T>::type &value) const { \
+	return Binary<Op, E, Const<T> >(this->self(), Const<T>(static_cast<T>(value))); \
+}
+
+__REGMAP_EXPRESSION_OPERATOR(^, Xor)
+__REGMAP_EXPRESSION_OPERATOR(|, Or)
+__REGMAP_EXPRESSION_OPERATOR(&, And)
+__REGMAP_EXPRESSION_OPERATOR(<<, ShiftLeft)
+__REGMAP_EXPRESSION_OPERATOR(>>, ShiftRight)
+__REGMAP_EXPRESSION_OPERATOR(==, Equal)
+__REGMAP_EXPRESSION_OPERATOR(!=, NotEqual)
+
+#undef __REGMAP_EXPRESSION_OPERATOR
+
+template <class E, class T>
+Unary<Invert, E> Expression<E, T>::operator~() const {
+	return Unary<Invert, E>(this->self());
+}
+
+template <class E, class T>
+Unary<LogicalNot, E> Expression<E, T>::operator!() const {
+	return Unary<LogicalNot, E>(this->self());
+}
+
+template <class E, class T>
+Unary<LogicalNot, E> Condition<E, T>::operator!() const {
+	return Unary<LogicalNot, E>(this->self());
+}
+
+}};
+
+#endif
@@ -0,0 +1,62 @@
+/* This file is part of libregmap.
+ *
+ * libregmap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libregmap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libregmap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef __REGMAP_RESULT__
+#define __REGMAP_RESULT__
+
+#include <system_error>
+
+namespace regmap {
+
+// Value or error of a noexcept access. Errors are std::errc codes:
+// result_out_of_range for offsets outside the backend, the errno of failed
+// system calls and io_error otherwise.
+template <class T>
+class Result {
+
+public:
+	Result(T value) noexcept
+	: m_uValue(value) {}
+
+	Result(const std::error_code &error) noexcept
+	: m_uValue(), m_oError(error) {}
+
+	explicit operator bool() const noexcept {
+		return !m_oError;
+	}
+
+	const std::error_code& error() const noexcept {
+		return m_oError;
+	}
+
+	// throws std::system_error on errors
+	T value() const {
+		if (m_oError)
+			throw std::system_error(m_oError);
+		return m_uValue;
+	}
+
+	T value_or(T fallback) const noexcept {
+		return m_oError ? fallback : m_uValue;
+	}
+
+private:
+	T		m_uValue;
+	std::error_code	m_oError;
+};
+
+};
+
+#endif
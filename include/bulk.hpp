@@ -0,0 +1,36 @@
+/* This file is part of libregmap.
+ *
+ * libregmap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libregmap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libregmap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __REGMAP_BULK__
+#define __REGMAP_BULK__
+
+#include <cstddef>
+
+namespace regmap {
+
+// Copies between host and device memory with naturally aligned single
+// accesses of at most width bytes (1, 2, 4, 8 or 16, 16 needs SSE2). The
+// unaligned head and tail of the device range are split into narrower
+// aligned accesses, the host buffer may have any alignment.
+void copyToDevice(volatile void *dst, const void *src, std::size_t size, unsigned int width = 8);
+void copyFromDevice(void *dst, const volatile void *src, std::size_t size, unsigned int width = 8);
+
+// throws if the width is not supported on this platform
+void checkAccessWidth(unsigned int width);
+
+};
+
+#endif
@@ -0,0 +1,134 @@
+/* This file is part of libregmap.
+ *
+ * libregmap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libregmap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libregmap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef __REGMAP_CACHE__
+#define __REGMAP_CACHE__
+
+#include <chrono>
+#include <mutex>
+#include <vector>
+#include "IRegBackend.hpp"
+#include "RegMapBase.hpp"
+
+namespace regmap { namespace cache {
+
+typedef std::chrono::nanoseconds Duration_t;
+typedef std::chrono::steady_clock Clock_t;
+
+// A miss reads window bytes in one transfer, starting up to before bytes
+// ahead of the requested register. Cached bytes are valid for ttl unless
+// their register gives a "ttl_us" of its own.
+struct Policy {
+
+	Policy(unsigned int window = 16, Duration_t ttl = std::chrono::milliseconds(1), unsigned int before = 0)
+	: m_uWindow(window), m_uTtl(ttl), m_uBefore(before) {}
+
+	unsigned int	m_uWindow;
+	Duration_t	m_uTtl;
+	unsigned int	m_uBefore;
+};
+
+struct Statistics {
+
+	Statistics()
+	: m_uHits(0), m_uMisses(0), m_uBypassed(0), m_uBusReads(0), m_uBusTime(0) {}
+
+	// hits of all cacheable reads
+	double hitRate() const;
+	// bus time of the reads served from the cache, estimated with the
+	// average measured time of a bus read
+	Duration_t savedTime() const;
+
+	std::uint64_t	m_uHits;
+	std::uint64_t	m_uMisses;
+	// reads of volatile registers, FIFOs and offsets outside the definition
+	std::uint64_t	m_uBypassed;
+	// transfers of the parent backend and the time spent in them
+	std::uint64_t	m_uBusReads;
+	Duration_t	m_uBusTime;
+};
+
+// Read-ahead cache in front of a slow backend, e.g. i2c where every read
+// is a transaction of its own. Registers marked "volatile" in the
+// definition are always read from the device and never read ahead, all
+// writes go straight to the device and invalidate the written bytes.
+class RegBackendCached : public IRegBackend {
+
+public:
+	RegBackendCached() : m_pParent(NULL) {}
+	// the parent backend has to outlive this one
+	RegBackendCached(IRegBackend &parent, const Layout &layout, const Policy &policy);
+
+	Statistics statistics() const;
+	void resetStatistics();
+
+	// drops all cached values, e.g. after a device reset
+	void invalidate();
+
+	size_t size() const;
+
+	void read_repeated(unsigned int offset, void* dst, size_t width, size_t count);
+	void write_repeated(unsigned int offset, const void* src, size_t width, size_t count);
+
+private:
+	// shared between all copies of the backend
+	struct State {
+		std::mutex			m_oMutex;
+		Policy				m_oPolicy;
+		std::vector<unsigned char>	m_oData;
+		std::vector<Clock_t::time_point>	m_oExpiry;
+		// per byte, zero for volatile registers
+		std::vector<Duration_t>		m_oTtl;
+		std::vector<unsigned char>	m_oScratch;
+		Statistics			m_oStatistics;
+	};
+
+	void write(unsigned int offset, void* value, size_t size);
+	void read(unsigned int offset, void* value, size_t size);
+
+	bool cacheable(unsigned int offset, size_t size) const;
+	void fetch(unsigned int offset, void* value, size_t size);
+	void invalidate(unsigned int offset, size_t size);
+
+	IRegBackend			*m_pParent;
+	std::shared_ptr<State>		m_pState;
+};
+
+// The registers of a parent map read through a cache, the parent map has
+// to outlive it
+class Cached : public RegMapBase<RegBackendCached> {
+
+public:
+	template <class TBackend>
+	Cached(RegMapBase<TBackend> &parent, const Policy &policy = Policy())
+	: RegMapBase(parent.definition()) {
+
+		this->setBackend(RegBackendCached(parent.getBackend(), *this->definition()->layout(), policy));
+	}
+
+	Statistics statistics() {
+		return m_oRegBackend.statistics();
+	}
+
+	void invalidate() {
+		m_oRegBackend.invalidate();
+	}
+};
+
+}};
+
+#endif
@@ -0,0 +1,158 @@
+/* This file is part of libregmap.
+ *
+ * libregmap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libregmap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libregmap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef __REGMAP_DESCRIPTOR__
+#define __REGMAP_DESCRIPTOR__
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "endian.hpp"
+
+namespace regmap {
+
+// Named bitmasks of a register, sorted by name. A table is immutable once
+// built and shared by all registers with the same bitmasks, its names are
+// stored in a single block along with it.
+class BitmaskTable {
+
+public:
+	struct Bitmask {
+		const char	*m_pName;
+		std::uint32_t	m_uMask;
+	};
+
+	typedef const Bitmask* const_iterator;
+
+	explicit BitmaskTable(std::vector<std::pair<std::string, std::uint32_t> > bitmasks);
+
+	BitmaskTable(const BitmaskTable&) = delete;
+	BitmaskTable& operator=(const BitmaskTable&) = delete;
+
+	const_iterator begin() const {
+		return m_oBitmasks.data();
+	}
+
+	const_iterator end() const {
+		return m_oBitmasks.data() + m_oBitmasks.size();
+	}
+
+	std::size_t size() const {
+		return m_oBitmasks.size();
+	}
+
+	bool empty() const {
+		return m_oBitmasks.empty();
+	}
+
+	// end() if there is no bitmask with the name
+	const_iterator find(const std::string &name) const;
+
+	// a new table with the bitmask added, throws if the name is taken
+	std::shared_ptr<const BitmaskTable> with(const std::string &name, std::uint32_t mask) const;
+
+	// the table of registers without bitmasks
+	static const BitmaskTable& none();
+
+private:
+	std::vector<char>	m_oNames;
+	std::vector<Bitmask>	m_oBitmasks;
+};
+
+typedef std::shared_ptr<const BitmaskTable> Bitmasks_t;
+
+// Copies strings into blocks of up to 64kB, equal strings are stored once.
+// All of them are released with the pool.
+class StringPool {
+
+public:
+	StringPool() : m_pNext(NULL), m_uFree(0) {}
+
+	StringPool(const StringPool&) = delete;
+	StringPool& operator=(const StringPool&) = delete;
+
+	const char* intern(const std::string &string);
+
+	// drops the index used to find equal strings, interned ones stay valid
+	void seal();
+
+	// bytes taken by the blocks
+	std::size_t capacity() const;
+
+private:
+	static const std::size_t BLOCK = 64 * 1024;
+
+	std::vector<std::unique_ptr<char[]> >			m_oBlocks;
+	std::vector<std::size_t>				m_oSizes;
+	char							*m_pNext;
+	std::size_t						m_uFree;
+	std::unordered_map<std::string, const char*>		m_oIndex;
+};
+
+// owner of the memory a register or a reference points into, e.g. the
+// definition with its string pool and blocks
+typedef std::shared_ptr<const void> Owner_t;
+
+// Everything a definition knows about a register, at an offset relative
+// to the start of its block. Registers are created from it on access. The
+// name points into the definition's string pool.
+struct RegisterEntry {
+
+	RegisterEntry()
+	: m_pName(""), m_uOffset(0), m_uSize(0), m_eEndian(HOST_ENDIAN), m_bVolatile(false),
+	  m_uBusyMask(0), m_uReadyMask(0), m_uAccessMask(0xFFFFFFFF), m_uResetMask(0xFFFFFFFF),
+	  m_uStartMask(0xFFFFFFFF), m_uFreezeMask(0xFFFFFFFF), m_uSetAlias(NO_ALIAS),
+	  m_uClearAlias(NO_ALIAS), m_uToggleAlias(NO_ALIAS), m_uTtl(0) {}
+
+	RegisterEntry(const char *name, unsigned int offset, unsigned int size)
+	: RegisterEntry() {
+		m_pName = name;
+		m_uOffset = offset;
+		m_uSize = static_cast<std::uint8_t>(size);
+	}
+
+	static const unsigned int NO_ALIAS = std::numeric_limits<unsigned int>::max();
+
+	const char	*m_pName;
+	unsigned int	m_uOffset;
+	std::uint8_t	m_uSize;
+	eEndian		m_eEndian;
+	// the value changes by itself or reading it has side effects, it is
+	// never served from a cache
+	bool		m_bVolatile;
+	std::uint32_t	m_uBusyMask;
+	std::uint32_t	m_uReadyMask;
+	std::uint32_t	m_uAccessMask;
+	std::uint32_t	m_uResetMask;
+	std::uint32_t	m_uStartMask;
+	std::uint32_t	m_uFreezeMask;
+	unsigned int	m_uSetAlias;
+	unsigned int	m_uClearAlias;
+	unsigned int	m_uToggleAlias;
+	// time to live of cached values in microseconds, 0 for the cache's default
+	std::uint32_t	m_uTtl;
+	// NULL if the register has no bitmasks
+	Bitmasks_t	m_pBitmasks;
+};
+
+};
+
+#endif
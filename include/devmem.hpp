@@ -17,18 +17,54 @@
 #ifndef __REGMAP_DEVMEM__
 #define __REGMAP_DEVMEM__
 
+#include <map>
+#include <mutex>
 #include "IRegBackend.hpp"
 #include "RegMapBase.hpp"
 
 namespace regmap { namespace devmem {
 
+// Maps physical memory in whole pages and shares the mappings: ranges on
+// pages that are already mapped reuse that mapping, overlapping requests
+// are merged into a mapping covering both. The returned pointers keep
+// their mapping alive.
+class MappingManager {
+
+public:
+	explicit MappingManager(const std::string &device = "/dev/mem");
+
+	// the process wide manager on /dev/mem
+	static MappingManager& instance();
+
+	BackendMemory_t map(std::uint64_t physStart, std::size_t size);
+
+	// number of page mappings new requests can be served from
+	std::size_t mappings();
+
+	static std::size_t pageSize();
+
+private:
+	struct Mapping {
+		std::uint64_t		m_uEnd;
+		std::weak_ptr<void>	m_pBase;
+	};
+
+	static void munmapDeleter(void* addr, std::size_t length);
+	void purge();
+
+	std::mutex				m_oMutex;
+	std::string				m_sDevice;
+	// live mappings by their first physical address
+	std::map<std::uint64_t, Mapping>	m_oMappings;
+};
+
 class DevMem : public RegMapBase<RegBackendMemory> {
 
 public:
-	DevMem(std::uint32_t physStart, std::uint32_t physEnd, const std::string &defFile);
+	DevMem(std::uint64_t physStart, std::uint64_t physEnd, const DefinitionRef &definition,
+		MappingManager &manager = MappingManager::instance());
 	
 private:
-	static void munmapDeleter(void* addr, std::size_t length);
 	BackendMemory_t  m_pMemory;
 	RegBackendMemory m_oRegBackendMemory;
 };
@@ -0,0 +1,87 @@
+/* This file is part of libregmap.
+ *
+ * libregmap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libregmap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libregmap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef __REGMAP_ENDIAN__
+#define __REGMAP_ENDIAN__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace regmap {
+
+enum eEndian : std::uint8_t {
+	LITTLE,
+	BIG
+};
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+constexpr eEndian HOST_ENDIAN = BIG;
+#else
+constexpr eEndian HOST_ENDIAN = LITTLE;
+#endif
+
+// reverses the bytes of a register value, the width is selected at compile
+// time
+template <class T>
+inline T byteswap(T value);
+
+template <>
+inline std::uint8_t byteswap(std::uint8_t value) {
+	return value;
+}
+
+template <>
+inline std::uint16_t byteswap(std::uint16_t value) {
+	return __builtin_bswap16(value);
+}
+
+template <>
+inline std::uint32_t byteswap(std::uint32_t value) {
+	return __builtin_bswap32(value);
+}
+
+template <>
+inline std::uint64_t byteswap(std::uint64_t value) {
+	return __builtin_bswap64(value);
+}
+
+// Conversions between the byte order of a device and the host. The order
+// of a register comes from its definition at runtime, so every access
+// compares it with HOST_ENDIAN. The compare is a well predicted branch, it
+// only folds away where the compiler sees a constant order.
+template <class T>
+inline T toHost(T value, eEndian order) {
+	return HOST_ENDIAN == order ? value : byteswap<T>(value);
+}
+
+template <class T>
+inline T toDevice(T value, eEndian order) {
+	return toHost<T>(value, order);
+}
+
+// swaps count words of width 1, 2, 4 or 8 bytes in place. Register values
+// of a snapshot are stored in 32 bit slots, the upper half of the slots of
+// 16 bit registers is zero and they are swapped as pairs of 16 bit words.
+void swapWords(void *data, std::size_t count, unsigned int width);
+
+// parses "little" or "big", throws std::runtime_error otherwise
+eEndian parseEndian(const std::string &order);
+
+};
+
+#endif
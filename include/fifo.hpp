@@ -0,0 +1,82 @@
+/* This file is part of libregmap.
+ *
+ * libregmap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libregmap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libregmap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __REGMAP_FIFO__
+#define __REGMAP_FIFO__
+
+#include <algorithm>
+#include <vector>
+#include "RegisterBase.hpp"
+
+namespace regmap {
+
+// Reads n words from a FIFO data register. Memory backends read the
+// register in a tight loop, i2c reads all words in one transaction.
+template <class T>
+void read_fifo(const RegisterBase<T> &reg, T *buf, std::size_t n) {
+
+	reg.getBackend().read_repeated(reg.getOffset(), buf, sizeof(T), n);
+	if (HOST_ENDIAN != reg.getEndian())
+		swapWords(buf, n, sizeof(T));
+
+	T mask = reg.getAccessMask();
+	if (mask != static_cast<T>(~T(0)))
+		for (std::size_t i = 0; i < n; i++)
+			buf[i] &= mask;
+}
+
+template <class T>
+void write_fifo(const RegisterBase<T> &reg, const T *buf, std::size_t n) {
+
+	T mask = reg.getAccessMask();
+	bool swap = HOST_ENDIAN != reg.getEndian();
+	if (mask == static_cast<T>(~T(0)) && !swap) {
+		reg.getBackend().write_repeated(reg.getOffset(), buf, sizeof(T), n);
+		return;
+	}
+
+	std::vector<T> masked(buf, buf + n);
+	for (auto &word : masked)
+		word &= mask;
+	if (swap)
+		swapWords(masked.data(), n, sizeof(T));
+	reg.getBackend().write_repeated(reg.getOffset(), masked.data(), sizeof(T), n);
+}
+
+// Reads the fill level first and drains up to max words in one batch. The
+// level is taken from the bits of levelMask, returns the number of words read.
+// The mask takes the type of the level register, plain literals convert.
+template <class T, class L>
+std::size_t read_fifo(const RegisterBase<T> &reg, const RegisterBase<L> &level, T *buf, std::size_t max,
+			typename RegisterBase<L>::value_type levelMask = static_cast<L>(~L(0))) {
+
+	if (!levelMask)
+		return 0;
+
+	L shift = 0;
+	while (!((levelMask >> shift) & 1))
+		shift++;
+
+	std::size_t n = std::min<std::size_t>(max, (level.get() & levelMask) >> shift);
+	if (n)
+		read_fifo(reg, buf, n);
+
+	return n;
+}
+
+};
+
+#endif
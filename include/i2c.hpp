@@ -26,7 +26,7 @@ namespace regmap { namespace i2c {
 class I2C : public RegMapBase<RegBackendI2CDev> {
 
 public:
-	I2C(unsigned char bus, unsigned char slave_id, const std::string &defFile);
+	I2C(unsigned char bus, unsigned char slave_id, const DefinitionRef &definition);
 	
 private:
 	static void closeDeleter(int* fd);
@@ -0,0 +1,132 @@
+/* This file is part of libregmap.
+ *
+ * libregmap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libregmap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libregmap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef __REGMAP_INDIRECT__
+#define __REGMAP_INDIRECT__
+
+#include <atomic>
+#include <chrono>
+#include "IRegBackend.hpp"
+#include "RegMapBase.hpp"
+
+namespace regmap { namespace indirect {
+
+// The "handshake" section of a definition whose registers are reached
+// through registers of a parent map, e.g. PHY registers behind an MDIO
+// access register or a firmware mailbox:
+//
+//	"handshake": {
+//		"command": "PHYAR",		parent register taking address and flags
+//		"data": "PHYAR",		parent register holding the data, the command register by default
+//		"address_mask": "0x001F0000",
+//		"data_mask": "0x0000FFFF",
+//		"read_flag": "0",		bits set in the command for reads
+//		"write_flag": "0x80000000",	bits set in the command for writes
+//		"done_mask": "0x80000000",	bits polled for completion
+//		"read_done": "0x80000000",	their value once a read completed
+//		"write_done": "0",		their value once a write completed
+//		"timeout_us": "10000"
+//	}
+//
+// Register offsets of the definition are addresses in the address field.
+struct Handshake {
+
+	static Handshake parse(const std::string &defFile);
+
+	std::string		m_sCommand;
+	std::string		m_sData;
+	std::uint32_t		m_uAddressMask;
+	std::uint32_t		m_uDataMask;
+	std::uint32_t		m_uReadFlag;
+	std::uint32_t		m_uWriteFlag;
+	std::uint32_t		m_uDoneMask;
+	std::uint32_t		m_uReadDone;
+	std::uint32_t		m_uWriteDone;
+	std::chrono::microseconds	m_uTimeout;
+};
+
+struct Statistics {
+	std::uint64_t	m_uHandshakes;
+	// accesses of the parent backend
+	std::uint64_t	m_uParentAccesses;
+};
+
+class RegBackendHandshake : public IRegBackend {
+
+public:
+	RegBackendHandshake() : m_pParent(NULL) {}
+	// the parent backend has to outlive this one
+	RegBackendHandshake(IRegBackend &parent, const RegMapDefinition &parentDefinition, const Handshake &handshake);
+
+	// one handshake per address, without any bookkeeping in between
+	void read_many(const unsigned int *addresses, std::uint32_t *values, std::size_t count);
+
+	Statistics statistics() const;
+
+	// Offsets are addresses, so the map spans the last address plus one
+	// word. Registers wider than a word at the very last addresses are
+	// rejected at load time although words() would accept them.
+	size_t size() const;
+
+private:
+	struct Slot {
+		unsigned int	m_uOffset;
+		unsigned int	m_uSize;
+	};
+
+	void write(unsigned int offset, void* value, size_t size);
+	void read(unsigned int offset, void* value, size_t size);
+	std::error_code try_write(unsigned int offset, void* value, size_t size) noexcept;
+	std::error_code try_read(unsigned int offset, void* value, size_t size) noexcept;
+
+	std::error_code transfer(unsigned int address, std::uint32_t &value, bool write) noexcept;
+	std::error_code poll(std::uint32_t done, std::uint32_t &command, std::uint32_t &data) noexcept;
+	std::error_code parentRead(const Slot &slot, std::uint32_t &value) noexcept;
+	std::error_code parentWrite(const Slot &slot, std::uint32_t value) noexcept;
+	unsigned int words(unsigned int offset, size_t size) const;
+
+	IRegBackend			*m_pParent;
+	Handshake			m_oHandshake;
+	Slot				m_oCommand;
+	Slot				m_oData;
+	bool				m_bShared;	// data and command in one register
+	bool				m_bAdjacent;	// both in one parent transfer
+	unsigned int			m_uAddressShift;
+	unsigned int			m_uDataShift;
+	unsigned int			m_uWordBytes;
+
+	struct Counters {
+		std::atomic<std::uint64_t>	m_uHandshakes;
+		std::atomic<std::uint64_t>	m_uParentAccesses;
+	};
+	std::shared_ptr<Counters>	m_pCounters;
+};
+
+// A register map reached through a handshake on registers of a parent
+// map, the parent map has to outlive it
+class Indirect : public RegMapBase<RegBackendHandshake> {
+
+public:
+	template <class TBackend>
+	Indirect(RegMapBase<TBackend> &parent, const DefinitionRef &definition)
+	: RegMapBase(definition) {
+
+		this->setBackend(RegBackendHandshake(parent.getBackend(), *parent.definition(), Handshake::parse(this->defFile())));
+	}
+};
+
+}};
+
+#endif
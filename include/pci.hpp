@@ -18,6 +18,9 @@
 #define __REGMAP_PCI__
 
 #include <fstream>
+#include <mutex>
+#include <vector>
+#include <unordered_map>
 #include "IRegBackend.hpp"
 #include "RegMapBase.hpp"
 
@@ -54,6 +57,60 @@ enum eBARs {
 	BAR8 = 8
 };
 
+enum eMapping {
+	UNCACHED,	// resourceN
+	WRITE_COMBINED	// resourceN_wc, prefetchable BARs only
+};
+
+struct PCIDevice {
+
+	PCIDevice()
+	: m_uDomain(0), m_oBDF(0, 0, 0), m_uVendor(0), m_uDevice(0), m_uClass(0), m_uInstance(0) {}
+
+	std::string	m_sSysFSPath;
+	std::uint16_t	m_uDomain;
+	BDF		m_oBDF;
+	std::uint16_t	m_uVendor;
+	std::uint16_t	m_uDevice;
+	std::uint32_t	m_uClass;
+	// 1 based count among the devices with the same vendor and device id, in bdf order
+	unsigned int	m_uInstance;
+};
+
+// Index of the devices found in sysfs. The directory is scanned once and
+// the vendor, device and class files of every device are read only then,
+// lookups afterwards don't touch the filesystem until the next refresh.
+class PCIEnumerator {
+
+public:
+	explicit PCIEnumerator(const std::string &sysfsRoot = "/sys/bus/pci/devices/");
+
+	// the process wide enumerator on /sys/bus/pci/devices/
+	static PCIEnumerator& instance();
+
+	// rescan sysfs, e.g. after devices were added or removed
+	void refresh();
+
+	bool find(const PCI_ID &pciID, unsigned int instance, PCIDevice &device);
+	bool find(const BDF &bdf, PCIDevice &device, std::uint16_t domain = 0);
+	// all devices of the given class, e.g. 0x020000 for ethernet controllers
+	std::vector<PCIDevice> findByClass(std::uint32_t classCode, std::uint32_t mask = 0xFFFFFF);
+	std::vector<PCIDevice> devices();
+
+private:
+	static std::uint32_t idKey(std::uint16_t vendor, std::uint16_t device);
+	static std::uint64_t bdfKey(std::uint16_t domain, const BDF &bdf);
+	void scan();
+	void ensureScanned();
+
+	std::mutex					m_oMutex;
+	std::string					m_sSysFSRoot;
+	bool						m_bScanned;
+	std::vector<PCIDevice>				m_oDevices;
+	std::unordered_map<std::uint32_t, std::vector<std::size_t> >	m_oByID;
+	std::unordered_map<std::uint64_t, std::size_t>	m_oByBDF;
+};
+
 class PCICommon {
 
 public:
@@ -68,9 +125,10 @@ public:
 	static void rescanBus();
 
 	std::size_t barSize(const eBARs &bar);
+	bool isPrefetchable(const eBARs &bar);
 
 protected:
-	BackendMemory_t memMapBar(const eBARs &bar);
+	BackendMemory_t memMapBar(const eBARs &bar, eMapping mapping = UNCACHED);
 	BackendFile_t ioMapBar(const eBARs &bar);
 
 private:
@@ -83,9 +141,13 @@ private:
 class MemMapped : public RegMapBase<RegBackendMemory>, public PCICommon {
 
 public:
-	MemMapped(const PCI_ID &pciID, const std::string &defFile, const eBARs &bar, unsigned char instance = 1);
-	MemMapped(const BDF &bdf, const std::string &defFile, const eBARs &bar);
-	
+	MemMapped(const PCI_ID &pciID, const DefinitionRef &definition, const eBARs &bar, unsigned char instance = 1, eMapping mapping = UNCACHED);
+	MemMapped(const BDF &bdf, const DefinitionRef &definition, const eBARs &bar, eMapping mapping = UNCACHED);
+
+	// copies data to the BAR with non-temporal stores and a single fence,
+	// e.g. to fill on-device buffers through a write combined mapping
+	void streamWrite(unsigned int offset, const void* data, std::size_t size);
+
 private:
 	BackendMemory_t  m_pMemory;
 	RegBackendMemory m_oRegBackendMemory;
@@ -94,8 +156,8 @@ private:
 class IOMapped : public RegMapBase<RegBackendFile>, public PCICommon {
 
 public:
-	IOMapped(const PCI_ID &pciID, const std::string &defFile, const eBARs &bar, unsigned char instance = 1);
-	IOMapped(const BDF &bdf, const std::string &defFile, const eBARs &bar);
+	IOMapped(const PCI_ID &pciID, const DefinitionRef &definition, const eBARs &bar, unsigned char instance = 1);
+	IOMapped(const BDF &bdf, const DefinitionRef &definition, const eBARs &bar);
 	
 private:
 	BackendFile_t	m_pFile;
@@ -0,0 +1,131 @@
+/* This file is part of libregmap.
+ *
+ * libregmap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libregmap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libregmap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef __REGMAP_PUBLISH__
+#define __REGMAP_PUBLISH__
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <condition_variable>
+#include "snapshot.hpp"
+
+namespace regmap {
+
+typedef std::chrono::steady_clock PublishClock_t;
+
+// the registers of the layout with the given names, in offset order
+Layout_t select(const Layout_t &layout, const std::vector<std::string> &names);
+
+// Register values of one publication
+struct Sample {
+
+	Sample() : m_uGeneration(0) {}
+
+	// time since the registers were read
+	PublishClock_t::duration age() const {
+		return PublishClock_t::now() - m_tTimestamp;
+	}
+
+	std::vector<std::uint32_t>	m_oValues;
+	PublishClock_t::time_point	m_tTimestamp;
+	// number of the publication, starting at 1
+	std::uint64_t			m_uGeneration;
+};
+
+// Periodically reads a set of registers and publishes their values in a
+// shared memory segment, e.g. a file in /dev/shm. The segment is guarded by
+// a seqlock: readers never block the publisher or each other and never
+// touch the device, so the bus load does not depend on the number of readers.
+class Publisher {
+
+public:
+	// replaces an existing segment, subscribers of an old one have to
+	// reopen. The segment is removed with the publisher.
+	Publisher(const std::string &path, const Layout_t &layout, IRegBackend &backend, unsigned int maxGap = 0);
+	~Publisher();
+
+	Publisher(const Publisher&) = delete;
+	Publisher& operator=(const Publisher&) = delete;
+
+	// reads all registers once and publishes them, calls from several
+	// threads and the periodic publications take turns
+	void publish();
+
+	// publishes every period on a thread of its own
+	void start(PublishClock_t::duration period);
+	void stop();
+
+	// failed periodic publications, the previous values stay published
+	std::uint64_t errors() const {
+		return m_uErrors;
+	}
+
+private:
+	void run(PublishClock_t::duration period);
+
+	std::string			m_sPath;
+	Layout_t			m_pLayout;
+	IRegBackend			&m_oBackend;
+	unsigned int			m_uMaxGap;
+	void				*m_pSegment;
+	std::size_t			m_uSegmentSize;
+
+	std::thread			m_oThread;
+	// the seqlock has a single writer at a time
+	std::mutex			m_oPublishMutex;
+	std::mutex			m_oMutex;
+	std::condition_variable		m_oStop;
+	bool				m_bStop;
+	std::atomic<std::uint64_t>	m_uErrors;
+};
+
+// Lock free reader of a published segment
+class Subscriber {
+
+public:
+	explicit Subscriber(const std::string &path);
+	~Subscriber();
+
+	Subscriber(const Subscriber&) = delete;
+	Subscriber& operator=(const Subscriber&) = delete;
+
+	// the published registers, without their bitmasks
+	const Layout_t& layout() const {
+		return m_pLayout;
+	}
+
+	// index of a register in the values of a sample
+	std::size_t index(const std::string &name) const;
+
+	// copies the latest publication, returns false if there was none yet.
+	// Does not allocate once the sample has the right size.
+	bool read(Sample &sample) const;
+
+	Snapshot snapshot(const Sample &sample) const {
+		return Snapshot(m_pLayout, sample.m_oValues);
+	}
+
+private:
+	void				*m_pSegment;
+	std::size_t			m_uSegmentSize;
+	Layout_t			m_pLayout;
+};
+
+};
+
+#endif
@@ -19,7 +19,11 @@
 
 #include "pci.hpp"
 #include "i2c.hpp"
+#include "spi.hpp"
 #include "devmem.hpp"
+#include "indirect.hpp"
+#include "cache.hpp"
+#include "sequence.hpp"
 #include "regmap_conversions.hpp"
 
 #endif
@@ -18,16 +18,17 @@
 #define __REGMAP_CONVERSIONS__
 
 #include <cstdint>
+#include <type_traits>
 
 namespace regmap { namespace bcd {
 
 template <class T>
-static inline T to_dec(const T& value) {
+static inline typename std::enable_if<std::is_integral<T>::value, T>::type to_dec(const T& value) {
 	return (value) ? ((to_dec(value >> 4) * 10) + (value % 16)) : 0;
 }
 
 template <class T>
-static inline T to_bcd(const T& value) {
+static inline typename std::enable_if<std::is_integral<T>::value, T>::type to_bcd(const T& value) {
 	return (value) ? ((to_bcd(value / 10) << 4) + (value % 10)) : 0;
 }
 
@@ -41,6 +42,16 @@ static inline T to_bcd(const regmap::RegisterBase<T>& obj) {
 	return to_bcd(static_cast<T>(obj));
 }
 
+template <class E, class T>
+static inline T to_dec(const regmap::expr::Expression<E, T>& obj) {
+	return to_dec(obj.evaluate());
+}
+
+template <class E, class T>
+static inline T to_bcd(const regmap::expr::Expression<E, T>& obj) {
+	return to_bcd(obj.evaluate());
+}
+
 }};
 
 #endif
@@ -0,0 +1,141 @@
+/* This file is part of libregmap.
+ *
+ * libregmap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libregmap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libregmap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef __REGMAP_RELOAD__
+#define __REGMAP_RELOAD__
+
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "RegMapDefinition.hpp"
+
+namespace regmap {
+
+// called on the watcher's thread with the new definition, or with an
+// empty one and the error if the changed file was rejected
+typedef std::function<void(const Definition_t&, std::exception_ptr)> ReloadCallback_t;
+
+// The definition currently used by a register map. Readers never block:
+// a read section costs two atomic increments on the reader's phase counter.
+// A new definition is swapped in with a single atomic store, the previous
+// one is released once all read sections that could have seen it ended,
+// like RCU does after a grace period.
+class DefinitionCell {
+
+public:
+	explicit DefinitionCell(const Definition_t &definition);
+	~DefinitionCell();
+
+	DefinitionCell(const DefinitionCell&) = delete;
+	DefinitionCell& operator=(const DefinitionCell&) = delete;
+
+	// read section, the definition stays valid until the reader is gone
+	class Reader {
+
+	public:
+		explicit Reader(const DefinitionCell &cell)
+		: m_pCell(&cell), m_uPhase(cell.m_uPhase.load()) {
+
+			cell.m_aReaders[m_uPhase].m_uCount.fetch_add(1);
+			m_pDefinition = cell.m_pCurrent.load();
+		}
+
+		~Reader() {
+			m_pCell->m_aReaders[m_uPhase].m_uCount.fetch_sub(1);
+		}
+
+		Reader(const Reader&) = delete;
+		Reader& operator=(const Reader&) = delete;
+
+		// a reference taken here keeps the definition beyond the section
+		const Definition_t& get() const {
+			return *m_pDefinition;
+		}
+
+		const RegMapDefinition* operator->() const {
+			return m_pDefinition->get();
+		}
+
+	private:
+		const DefinitionCell	*m_pCell;
+		unsigned int		m_uPhase;
+		const Definition_t	*m_pDefinition;
+	};
+
+	Definition_t get() const {
+		return Reader(*this).get();
+	}
+
+	// swaps in the definition, returns once the previous one is released
+	void publish(const Definition_t &definition);
+
+	// parses the file and publishes it if all registers and regions fit
+	// into size bytes (0 to skip the check). Throws and keeps the current
+	// definition otherwise.
+	Definition_t reload(const std::string &defFile, std::size_t size);
+
+	// number of definitions published after the first one
+	std::uint64_t reloads() const {
+		return m_uReloads;
+	}
+
+private:
+	void synchronize();
+
+	// every reader writes the counters, keep them off the cache line of
+	// the read-mostly members
+	struct alignas(64) Counter {
+		std::atomic<std::uint64_t>	m_uCount;
+	};
+
+	mutable Counter				m_aReaders[2];
+	std::atomic<unsigned int>		m_uPhase;
+	std::atomic<const Definition_t*>	m_pCurrent;
+	std::atomic<std::uint64_t>		m_uReloads;
+	// serializes writers, readers never take it
+	std::mutex				m_oPublishMutex;
+};
+
+// Watches a definition file with inotify and calls changed on a thread of
+// its own whenever the file was written or replaced, e.g. by an editor
+// renaming its temporary copy over the file.
+class DefinitionWatcher {
+
+public:
+	DefinitionWatcher(const std::string &defFile, const std::function<void()> &changed);
+	~DefinitionWatcher();
+
+	DefinitionWatcher(const DefinitionWatcher&) = delete;
+	DefinitionWatcher& operator=(const DefinitionWatcher&) = delete;
+
+private:
+	void run();
+
+	std::string		m_sFile;
+	std::function<void()>	m_oChanged;
+	int			m_iInotify;
+	int			m_aWake[2];
+	std::atomic<bool>	m_bStop;
+	std::thread		m_oThread;
+};
+
+};
+
+#endif
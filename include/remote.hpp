@@ -0,0 +1,207 @@
+/* This file is part of libregmap.
+ *
+ * libregmap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libregmap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libregmap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef __REGMAP_REMOTE__
+#define __REGMAP_REMOTE__
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <sys/types.h>
+#include "IRegBackend.hpp"
+#include "RegMapBase.hpp"
+
+namespace regmap { namespace remote {
+
+// One register access. Submissions and their completions share the slot
+// index in the ring.
+struct Op {
+	std::uint32_t	m_uOffset;
+	std::uint8_t	m_uSize;	// 1, 2, 4 or 8
+	std::uint8_t	m_uWrite;
+	std::uint16_t	m_uReserved;
+	std::uint64_t	m_uValue;
+};
+
+struct Completion {
+	std::int32_t	m_iError;	// errno of the access, 0 on success
+	std::uint32_t	m_uReserved;
+	std::uint64_t	m_uValue;	// the value read
+};
+
+static const std::uint32_t RING_SIZE = 256;
+
+// Shared memory of one client connection. The client produces submissions
+// and advances m_uSubmitHead, the daemon consumes them in order and
+// produces one completion each. Doorbells on the unix socket announce a
+// batch and its completion, the accesses themselves never pass the socket.
+struct Ring {
+	std::atomic<std::uint32_t>	m_uSubmitHead;
+	std::atomic<std::uint32_t>	m_uSubmitTail;
+	std::atomic<std::uint32_t>	m_uCompleteHead;
+	std::atomic<std::uint32_t>	m_uCompleteTail;
+	Op				m_oSubmissions[RING_SIZE];
+	Completion			m_oCompletions[RING_SIZE];
+};
+
+// The daemon side: owns the backends of named register maps and executes
+// the accesses of all clients on a single thread, so accesses of different
+// processes never interleave within a batch.
+class Server {
+
+public:
+	// Clients have access to all served devices, the socket is only
+	// accessible to the owner by default. Give a group to share it.
+	explicit Server(const std::string &socketPath, mode_t mode = 0600, gid_t group = static_cast<gid_t>(-1));
+	~Server();
+
+	// the backend has to outlive the server
+	void add(const std::string &name, IRegBackend &backend);
+
+	// serves clients until stop() is called
+	void run();
+	// run() on a thread of its own
+	void start();
+	// may be called from signal handlers
+	void stop();
+
+	std::uint64_t batches() const {
+		return m_uBatches;
+	}
+
+	std::uint64_t accesses() const {
+		return m_uAccesses;
+	}
+
+private:
+	// Clients send the name of their map after connecting. Until the name
+	// is complete and answered, the client has no ring.
+	struct Client {
+		int				m_iSocket;
+		IRegBackend			*m_pBackend;
+		std::shared_ptr<Ring>		m_pRing;
+		std::string			m_sHello;
+		std::chrono::steady_clock::time_point	m_tAccepted;
+	};
+
+	void accept();
+	bool greet(Client &client);
+	bool serve(Client &client);
+	static Completion execute(IRegBackend &backend, const Op &op);
+
+	std::string				m_sSocketPath;
+	int					m_iListen;
+	int					m_aWake[2];
+	std::atomic<bool>			m_bStop;
+	std::thread				m_oThread;
+	std::map<std::string, IRegBackend*>	m_oBackends;
+	std::vector<Client>			m_oClients;
+	std::atomic<std::uint64_t>		m_uBatches;
+	std::atomic<std::uint64_t>		m_uAccesses;
+};
+
+class Connection;
+
+// Backend of a register map owned by a daemon. Single accesses take one
+// round trip, Batch and the bulk copies put up to RING_SIZE accesses into
+// each round trip.
+class RegBackendRemote : public IRegBackend {
+
+public:
+	RegBackendRemote() {}
+	RegBackendRemote(const std::string &socketPath, const std::string &name);
+
+	size_t size() const;
+
+	// executes count accesses in order, failed ones are reported in their
+	// completion and don't stop the others
+	void submit(const Op *ops, Completion *completions, std::size_t count);
+
+	std::uint64_t roundTrips() const;
+
+	void copy_to_device(unsigned int offset, const void* src, size_t size);
+	void copy_from_device(unsigned int offset, void* dst, size_t size);
+
+private:
+	void write(unsigned int offset, void* value, size_t size);
+	void read(unsigned int offset, void* value, size_t size);
+
+	void transfer(unsigned int offset, unsigned char *data, size_t size, bool write);
+
+	std::shared_ptr<Connection>	m_pConnection;
+};
+
+// Accesses collected for a single round trip
+class Batch {
+
+public:
+	explicit Batch(RegBackendRemote &backend)
+	: m_pBackend(&backend) {}
+
+	// the returned index selects the result after submit()
+	std::size_t read(unsigned int offset, unsigned int size);
+	std::size_t write(unsigned int offset, std::uint64_t value, unsigned int size);
+
+	template <class T>
+	std::size_t read(const RegisterBase<T> &reg) {
+		return this->read(reg.getOffset(), sizeof(T));
+	}
+
+	template <class T>
+	std::size_t write(const RegisterBase<T> &reg, std::uint64_t value) {
+		return this->write(reg.getOffset(), toDevice<T>(static_cast<T>(value) & reg.getAccessMask(), reg.getEndian()), sizeof(T));
+	}
+
+	// throws std::system_error for the first failed access, all others
+	// are executed nevertheless
+	void submit();
+
+	std::error_code error(std::size_t index) const;
+	std::uint64_t value(std::size_t index) const;
+
+	template <class T>
+	T value(const RegisterBase<T> &reg, std::size_t index) const {
+		return toHost<T>(static_cast<T>(this->value(index)), reg.getEndian()) & reg.getAccessMask();
+	}
+
+	std::size_t size() const {
+		return m_oOps.size();
+	}
+
+	void clear();
+
+private:
+	RegBackendRemote		*m_pBackend;
+	std::vector<Op>			m_oOps;
+	std::vector<Completion>		m_oCompletions;
+};
+
+// A register map served by regmapd
+class Remote : public RegMapBase<RegBackendRemote> {
+
+public:
+	Remote(const std::string &socketPath, const std::string &name, const DefinitionRef &definition);
+
+	Batch batch() {
+		return Batch(m_oRegBackend);
+	}
+};
+
+}};
+
+#endif
@@ -0,0 +1,184 @@
+/* This file is part of libregmap.
+ *
+ * libregmap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libregmap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libregmap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef __REGMAP_SEQUENCE__
+#define __REGMAP_SEQUENCE__
+
+#include <chrono>
+#include <exception>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "IRegBackend.hpp"
+#include "RegMapBase.hpp"
+
+namespace regmap { namespace sequence {
+
+typedef std::chrono::nanoseconds Duration_t;
+typedef std::chrono::steady_clock Clock_t;
+
+enum eStep {
+	WRITE,			// writes a value to a register
+	MODIFY,			// read-modify-write of a named bitmask
+	WAIT_READY,		// polls until the ready mask of a register is set
+	WAIT_BUSY_CLEAR,	// polls until the busy mask of a register is cleared
+	DELAY
+};
+
+// A step resolved against the registers of a definition
+struct Step {
+
+	eStep		m_eType;
+	// register, register.field for MODIFY steps
+	std::string	m_sName;
+	unsigned int	m_uOffset;
+	unsigned int	m_uSize;
+	eEndian		m_eEndian;
+	std::uint32_t	m_uAccessMask;
+	// field, ready or busy mask
+	std::uint32_t	m_uMask;
+	// the field value is shifted into place
+	std::uint32_t	m_uValue;
+	// wait timeout, 0 waits forever, or the delay
+	Duration_t	m_uTime;
+};
+
+// A named list of steps from the "sequences" section of a definition, e.g.
+// the bring-up of a device:
+//
+//	"sequences": {
+//		"init": [
+//			{ "write": "control", "value": "0x1" },
+//			{ "modify": "config", "field": "MODE", "value": "2" },
+//			{ "wait_ready": "status", "timeout_us": "10000" },
+//			{ "wait_busy_clear": "control", "timeout_us": "10000" },
+//			{ "delay_us": "500" }
+//		]
+//	}
+//
+// Waits time out after 100ms unless "timeout_us" is given, 0 waits forever.
+class Sequence {
+
+public:
+	// throws if the sequence does not exist or a step refers to an unknown
+	// register or field, or to a register without ready or busy mask
+	static Sequence parse(const RegMapDefinition &definition, const std::string &name);
+
+	const std::string& name() const {
+		return m_sName;
+	}
+
+	const std::vector<Step>& steps() const {
+		return m_oSteps;
+	}
+
+private:
+	std::string		m_sName;
+	std::vector<Step>	m_oSteps;
+};
+
+struct Options {
+
+	Options(std::size_t maxBurst = 0, Duration_t pollInterval = std::chrono::microseconds(100))
+	: m_uMaxBurst(maxBurst), m_uPollInterval(pollInterval) {}
+
+	// Consecutive writes to adjacent registers in ascending order are sent
+	// in one transfer of at most this many bytes, 0 for no limit. Set it to
+	// the register size for devices that need single register accesses.
+	// Memory mapped backends always write each register at its own width.
+	std::size_t	m_uMaxBurst;
+	// time to sleep between two polls of a wait, 0 to only yield
+	Duration_t	m_uPollInterval;
+};
+
+struct StepTiming {
+
+	std::string	m_sName;
+	eStep		m_eType;
+	// relative to the start of the sequence
+	Duration_t	m_uStart;
+	Duration_t	m_uDuration;
+	// number of the step's first transfer, writes sent in one transfer
+	// share it along with start and duration
+	std::size_t	m_uTransfer;
+};
+
+struct Report {
+
+	Report() : m_uStart(0), m_uDuration(0), m_uTransfers(0) {}
+
+	bool ok() const {
+		return !m_pError;
+	}
+
+	std::string		m_sDevice;
+	std::string		m_sSequence;
+	// relative to the start of the engine
+	Duration_t		m_uStart;
+	Duration_t		m_uDuration;
+	// steps done, a failed step is the last one
+	std::vector<StepTiming>	m_oSteps;
+	std::size_t		m_uTransfers;
+	// why the sequence failed or was not started
+	std::exception_ptr	m_pError;
+};
+
+std::ostream& operator<<(std::ostream &os, const Report &report);
+
+// Runs the steps in order on the calling thread. A failed step ends the
+// sequence, the report holds the exception.
+Report run(IRegBackend &backend, const Sequence &sequence, const Options &options = Options());
+
+// Runs the sequences of several devices, each on a thread of its own.
+// Sequences added for the same backend run in the order added, others in
+// parallel unless ordered by after(). A job is skipped if a job it waits
+// for failed. The backends have to outlive the engine's run.
+class Engine {
+
+public:
+	explicit Engine(const Options &options = Options())
+	: m_oOptions(options) {}
+
+	template <class TBackend>
+	std::size_t add(const std::string &device, RegMapBase<TBackend> &map, const std::string &sequence) {
+		return this->add(device, map.getBackend(), Sequence::parse(*map.definition(), sequence));
+	}
+
+	// returns the index of the job
+	std::size_t add(const std::string &device, IRegBackend &backend, const Sequence &sequence);
+
+	// the job does not start before the earlier job dependency succeeded
+	void after(std::size_t job, std::size_t dependency);
+
+	// one report per job in the order added
+	std::vector<Report> run();
+
+private:
+	struct Job {
+		std::string			m_sDevice;
+		IRegBackend			*m_pBackend;
+		Sequence			m_oSequence;
+		std::vector<std::size_t>	m_oAfter;
+	};
+
+	Options			m_oOptions;
+	std::vector<Job>	m_oJobs;
+};
+
+}};
+
+#endif
@@ -0,0 +1,158 @@
+/* This file is part of libregmap.
+ *
+ * libregmap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libregmap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libregmap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __REGMAP_SIM__
+#define __REGMAP_SIM__
+
+#include <chrono>
+#include <mutex>
+#include <vector>
+#include "IRegBackend.hpp"
+#include "RegMapBase.hpp"
+
+namespace regmap { namespace sim {
+
+typedef std::chrono::nanoseconds Duration_t;
+typedef std::chrono::steady_clock Clock_t;
+
+// Cost of a single bus transaction: a fixed setup time, a time per
+// transferred data byte and an additional turnaround for reads.
+struct LatencyModel {
+
+	LatencyModel(Duration_t perAccess = Duration_t(0), Duration_t perByte = Duration_t(0), Duration_t readTurnaround = Duration_t(0))
+	: m_uPerAccess(perAccess), m_uPerByte(perByte), m_uReadTurnaround(readTurnaround) {}
+
+	Duration_t cost(std::size_t bytes, bool read) const;
+
+	// i2c at the given SCL frequency, e.g. 100000 or 400000
+	static LatencyModel i2c(unsigned int sclHz);
+	// memory mapped PCIe: non-posted reads, posted writes
+	static LatencyModel pcieMMIO();
+	// pread/pwrite on a sysfs resource file
+	static LatencyModel sysfs();
+
+	Duration_t m_uPerAccess;
+	Duration_t m_uPerByte;
+	Duration_t m_uReadTurnaround;
+};
+
+enum eBehaviour {
+	SELF_CLEAR,	// bits written as 1 clear themselves after a delay (busy bits)
+	SET_AFTER,	// bits are set after a delay once the register is written (ready bits)
+	CLEAR_ON_READ,	// bits are cleared by reading the register (event counters, irq status)
+	FREE_RUNNING	// the register counts up by itself
+};
+
+struct Behaviour {
+
+	Behaviour(eBehaviour type, unsigned int offset, std::size_t size, std::uint32_t mask,
+		Duration_t delay = Duration_t(0), std::uint32_t trigger = 0)
+	: m_eType(type), m_uOffset(offset), m_uSize(size), m_uMask(mask), m_uDelay(delay), m_uTrigger(trigger) {}
+
+	eBehaviour	m_eType;
+	unsigned int	m_uOffset;
+	std::size_t	m_uSize;
+	// affected bits, the increment for FREE_RUNNING counters
+	std::uint32_t	m_uMask;
+	// delay until the bits change, the increment period for FREE_RUNNING counters
+	Duration_t	m_uDelay;
+	// SET_AFTER: only writes containing these bits start the delay, 0 for any write
+	std::uint32_t	m_uTrigger;
+};
+
+struct Statistics {
+
+	Statistics()
+	: m_uReads(0), m_uWrites(0), m_uBytesRead(0), m_uBytesWritten(0),
+	  m_uBusTime(0), m_uMinLatency(Duration_t::max()), m_uMaxLatency(0) {}
+
+	Duration_t averageLatency() const;
+	// transferred bytes per second of bus time
+	double throughput() const;
+
+	std::uint64_t	m_uReads;
+	std::uint64_t	m_uWrites;
+	std::uint64_t	m_uBytesRead;
+	std::uint64_t	m_uBytesWritten;
+	Duration_t	m_uBusTime;
+	Duration_t	m_uMinLatency;
+	Duration_t	m_uMaxLatency;
+};
+
+class RegBackendSim : public IRegBackend {
+
+public:
+	RegBackendSim() {}
+	RegBackendSim(std::size_t size, const LatencyModel &latency, bool realtime = true);
+
+	void addBehaviour(const Behaviour &behaviour);
+
+	Statistics statistics() const;
+	void resetStatistics();
+
+	const LatencyModel& latency() const;
+	void setLatency(const LatencyModel &latency);
+
+	size_t size() const;
+
+private:
+	struct Pending {
+		Clock_t::time_point	m_tDue;
+		unsigned int		m_uOffset;
+		std::size_t		m_uSize;
+		std::uint32_t		m_uSet;
+		std::uint32_t		m_uClear;
+	};
+
+	// shared between all copies of the backend
+	struct State {
+		std::mutex			m_oMutex;
+		std::vector<unsigned char>	m_oMemory;
+		std::vector<Behaviour>		m_oBehaviours;
+		std::vector<Pending>		m_oPending;
+		std::vector<Clock_t::time_point>	m_oCounterBase;
+		LatencyModel			m_oLatency;
+		bool				m_bRealtime;
+		Statistics			m_oStatistics;
+	};
+
+	void write(unsigned int offset, void* value, size_t size);
+	void read(unsigned int offset, void* value, size_t size);
+
+	void settle(Clock_t::time_point now);
+	void account(std::size_t bytes, bool read);
+	std::uint32_t load(unsigned int offset, std::size_t size) const;
+	void store(unsigned int offset, std::size_t size, std::uint32_t value);
+	static bool overlaps(const Behaviour &behaviour, unsigned int offset, std::size_t size);
+	static void delay(Duration_t latency);
+
+	std::shared_ptr<State> m_pState;
+};
+
+// A register map on top of simulated device memory. Device behaviours are
+// declared per register in the "simulation" node of the definition file.
+class Simulator : public RegMapBase<RegBackendSim> {
+
+public:
+	Simulator(const DefinitionRef &definition, std::size_t size, const LatencyModel &latency = LatencyModel(), bool realtime = true);
+
+private:
+	void parseBehaviours(const std::string &defFile);
+};
+
+}};
+
+#endif
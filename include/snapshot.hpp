@@ -0,0 +1,111 @@
+/* This file is part of libregmap.
+ *
+ * libregmap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libregmap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libregmap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef __REGMAP_SNAPSHOT__
+#define __REGMAP_SNAPSHOT__
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <ostream>
+#include "IRegBackend.hpp"
+#include "RegisterArray.hpp"
+
+namespace regmap {
+
+struct RegisterInfo {
+	// array elements are named NAME[index] and NAME[index].REGISTER
+	std::string	m_sName;
+	unsigned int	m_uOffset;
+	unsigned int	m_uSize;
+	eEndian		m_eEndian;
+	bool		m_bVolatile;
+	// cache time to live in microseconds, 0 for the default
+	std::uint32_t	m_uTtl;
+	// shared with the definition, NULL if the register has no bitmasks
+	Bitmasks_t	m_pBitmasks;
+};
+
+// every register of a definition with all array elements expanded, sorted
+// by offset
+typedef std::vector<RegisterInfo> Layout;
+typedef std::shared_ptr<const Layout> Layout_t;
+
+Layout_t flatten(const RegisterBlock &block);
+
+// The values of all registers of a layout at one point in time
+class Snapshot {
+
+public:
+	Snapshot(const Layout_t &layout, std::vector<std::uint32_t> values);
+
+	const Layout_t& layout() const {
+		return m_pLayout;
+	}
+
+	std::size_t size() const {
+		return m_oValues.size();
+	}
+
+	const RegisterInfo& info(std::size_t index) const {
+		return (*m_pLayout)[index];
+	}
+
+	std::uint32_t value(std::size_t index) const {
+		return m_oValues.at(index);
+	}
+
+	std::uint32_t value(const std::string &name) const;
+
+	// stores the values by register name as json
+	void save(const std::string &file) const;
+	static Snapshot load(const std::string &file, const Layout_t &layout);
+
+private:
+	Layout_t			m_pLayout;
+	std::vector<std::uint32_t>	m_oValues;
+};
+
+struct FieldChange {
+	std::string	m_sName;
+	std::uint32_t	m_uBefore;
+	std::uint32_t	m_uAfter;
+};
+
+struct RegisterChange {
+	std::string			m_sName;
+	unsigned int			m_uOffset;
+	std::uint32_t			m_uBefore;
+	std::uint32_t			m_uAfter;
+	// named bitmasks with changed bits, values shifted down to bit 0
+	std::vector<FieldChange>	m_oFields;
+};
+
+std::ostream& operator<<(std::ostream &os, const RegisterChange &change);
+
+// Reads all registers of the layout in offset order. On backends without a
+// mapping, registers up to maxGap bytes apart are read in one transfer of at
+// most maxBurst bytes, 0 for no limit. Mapped backends are read register by
+// register at each register's width. Gaps are read as well, keep maxGap at
+// 0 if reading them has side effects. Registers not in host byte order are
+// swapped in bulk once all of them were read.
+Snapshot dump(const Layout_t &layout, IRegBackend &backend, unsigned int maxGap = 0, std::size_t maxBurst = 0);
+
+// registers that differ between two snapshots of the same layout
+std::vector<RegisterChange> diff(const Snapshot &before, const Snapshot &after);
+
+};
+
+#endif
@@ -0,0 +1,165 @@
+/* This file is part of libregmap.
+ *
+ * libregmap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libregmap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libregmap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef __REGMAP_SPI__
+#define __REGMAP_SPI__
+
+#include <array>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <vector>
+#include <linux/spi/spidev.h>
+#include "IRegBackend.hpp"
+#include "RegMapBase.hpp"
+
+namespace regmap { namespace spi {
+
+// Command word sent ahead of the data of every register access:
+// (offset << addressShift) | readFlag or writeFlag, most significant byte
+// first, followed by dummyBytes of turnaround for reads. The defaults fit
+// the common 7 bit address with the read flag in the MSB.
+struct Protocol {
+
+	Protocol(unsigned int addressBytes = 1, std::uint32_t readFlag = 0x80, std::uint32_t writeFlag = 0,
+		unsigned int addressShift = 0, unsigned int dummyBytes = 0, bool autoIncrement = true)
+	: m_uAddressBytes(addressBytes), m_uReadFlag(readFlag), m_uWriteFlag(writeFlag),
+	  m_uAddressShift(addressShift), m_uDummyBytes(dummyBytes), m_bAutoIncrement(autoIncrement) {}
+
+	std::uint32_t command(unsigned int offset, bool read) const {
+		return (offset << m_uAddressShift) | (read ? m_uReadFlag : m_uWriteFlag);
+	}
+
+	// number of addressable registers
+	std::size_t registers() const;
+
+	unsigned int	m_uAddressBytes;	// 1 to 4
+	std::uint32_t	m_uReadFlag;
+	std::uint32_t	m_uWriteFlag;
+	unsigned int	m_uAddressShift;
+	unsigned int	m_uDummyBytes;
+	// multi byte accesses continue at the following registers
+	bool		m_bAutoIncrement;
+};
+
+// ioctl(2), replaceable to test against a simulated slave
+typedef std::function<int(int fd, unsigned long request, void *arg)> Ioctl_t;
+
+// bytes spidev accepts per message, its bufsiz module parameter
+static const std::size_t SPIDEV_BUFSIZ = 4096;
+
+class RegBackendSPIDev : public IRegBackend {
+
+public:
+	// one register access of a batch, each is a chip select frame of its own
+	struct Access {
+		unsigned int	m_uOffset;
+		void		*m_pData;
+		std::size_t	m_uSize;
+		bool		m_bWrite;
+	};
+
+	RegBackendSPIDev() : m_uRegisters(0) {}
+	RegBackendSPIDev(BackendFile_t file, const Protocol &protocol, std::uint32_t speedHz, Ioctl_t ioctl = Ioctl_t());
+
+	size_t size() const;
+
+	// all accesses in a single SPI_IOC_MESSAGE, as far as spidev's limits allow
+	void submit(const Access *accesses, std::size_t count);
+
+	// FIFO registers: one frame of count words at the same address
+	void read_repeated(unsigned int offset, void* dst, size_t width, size_t count);
+	void write_repeated(unsigned int offset, const void* src, size_t width, size_t count);
+
+	void copy_to_device(unsigned int offset, const void* src, size_t size);
+	void copy_from_device(unsigned int offset, void* dst, size_t size);
+
+	// ioctls issued by all copies of the backend
+	std::uint64_t messages() const {
+		return m_pMessages ? m_pMessages->load() : 0;
+	}
+
+private:
+	void write(unsigned int offset, void* value, size_t size);
+	void read(unsigned int offset, void* value, size_t size);
+
+	std::error_code try_write(unsigned int offset, void* value, size_t size) noexcept;
+	std::error_code try_read(unsigned int offset, void* value, size_t size) noexcept;
+
+	std::error_code execute(const Access *accesses, std::size_t count) noexcept;
+	bool fits(unsigned int offset, size_t size) const;
+	void copy(unsigned int offset, unsigned char *data, size_t size, bool write);
+
+	BackendFile_t				m_pFile;
+	Protocol				m_oProtocol;
+	std::uint32_t				m_uSpeedHz;
+	Ioctl_t					m_fIoctl;
+	std::size_t				m_uRegisters;
+	std::shared_ptr<std::atomic<std::uint64_t> >	m_pMessages;
+};
+
+class SPI : public RegMapBase<RegBackendSPIDev> {
+
+public:
+	// opens /dev/spidevBUS.CHIPSELECT
+	SPI(unsigned char bus, unsigned char chipSelect, const DefinitionRef &definition,
+		const Protocol &protocol = Protocol(), std::uint32_t speedHz = 1000000, std::uint8_t mode = SPI_MODE_0);
+	SPI(const RegBackendSPIDev &backend, const DefinitionRef &definition);
+
+private:
+	static void closeDeleter(int* fd);
+};
+
+// Register accesses collected for a single ioctl
+class Batch {
+
+public:
+	explicit Batch(RegBackendSPIDev &backend)
+	: m_pBackend(&backend) {}
+
+	// value is written by submit()
+	template <class T>
+	void read(const RegisterBase<T> &reg, T &value) {
+		m_oAccesses.push_back(RegBackendSPIDev::Access{reg.getOffset(), &value, sizeof(T), false});
+		T mask = reg.getAccessMask();
+		eEndian order = reg.getEndian();
+		m_oMasks.push_back([&value, mask, order]() { value = toHost<T>(value, order) & mask; });
+	}
+
+	template <class T>
+	void write(const RegisterBase<T> &reg, std::uint64_t value) {
+		T masked = toDevice<T>(static_cast<T>(value) & reg.getAccessMask(), reg.getEndian());
+		m_oValues.emplace_back();
+		memcpy(m_oValues.back().data(), &masked, sizeof(T));
+		m_oAccesses.push_back(RegBackendSPIDev::Access{reg.getOffset(), m_oValues.back().data(), sizeof(T), true});
+	}
+
+	void submit() {
+		m_pBackend->submit(m_oAccesses.data(), m_oAccesses.size());
+		for (auto &mask : m_oMasks)
+			mask();
+	}
+
+private:
+	RegBackendSPIDev				*m_pBackend;
+	std::vector<RegBackendSPIDev::Access>		m_oAccesses;
+	// stable storage of the written values
+	std::deque<std::array<unsigned char, 8> >	m_oValues;
+	std::vector<std::function<void()> >		m_oMasks;
+};
+
+}};
+
+#endif
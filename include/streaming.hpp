@@ -0,0 +1,31 @@
+/* This file is part of libregmap.
+ *
+ * libregmap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libregmap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libregmap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __REGMAP_STREAMING__
+#define __REGMAP_STREAMING__
+
+#include <cstddef>
+
+namespace regmap {
+
+// Copies size bytes to dst with wide non-temporal stores where available
+// and a single store fence at the end. Meant for write combined device
+// memory, the unaligned head and tail of dst are copied with plain stores.
+void streamCopy(void *dst, const void *src, std::size_t size);
+
+};
+
+#endif
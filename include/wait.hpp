@@ -0,0 +1,137 @@
+/* This file is part of libregmap.
+ *
+ * libregmap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libregmap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libregmap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef __REGMAP_WAIT__
+#define __REGMAP_WAIT__
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+#include "IRegBackend.hpp"
+#include "RegisterBase.hpp"
+
+namespace regmap {
+
+enum eCompare {
+	EQUAL,
+	NOT_EQUAL,
+	LESS,
+	LESS_EQUAL,
+	GREATER,
+	GREATER_EQUAL,
+	ALL_SET,	// all bits of the value are set
+	ANY_SET,	// any bit of the value is set
+	NONE_SET	// no bit of the value is set
+};
+
+// Waits for any or all of several conditions. Conditions are either
+// declarative, a register or field compared with a value, or predicates.
+// All conditions share one polling loop which reads every register taking
+// part in declarative conditions once per iteration.
+//
+// The waiter refers to the registers of expression conditions, they have
+// to outlive it.
+class Waiter {
+
+public:
+	static const int TIMEOUT = -1;
+
+	// time to sleep between two polls, 0 to only yield
+	explicit Waiter(std::chrono::nanoseconds interval = std::chrono::microseconds(100));
+
+	// (reg & mask) shifted down to bit 0 compared with value, returns the
+	// index of the condition
+	template <class T>
+	std::size_t add(const RegisterBase<T> &reg, eCompare compare, T value, T mask = static_cast<T>(~T(0))) {
+		return this->add(reg.getName(), reg.getBackend(), reg.getOffset(), sizeof(T), reg.getEndian(), mask, reg.getAccessMask(), compare, value);
+	}
+
+	// a named bitmask compared with value, the field is shifted down to bit 0
+	template <class T>
+	std::size_t add(const RegisterBase<T> &reg, const std::string &field, eCompare compare, std::uint32_t value) {
+
+		auto it = reg.getBitmasks().find(field);
+		if (reg.getBitmasks().end() == it)
+			throw std::runtime_error("Bitmap not defined: " + field);
+
+		return this->add(reg.getName() + "." + field, reg.getBackend(), reg.getOffset(), sizeof(T), reg.getEndian(), it->m_uMask,
+				reg.getAccessMask(), compare, value);
+	}
+
+	// conditions built from register expressions, e.g. (reg & MASK) == VALUE
+	template <class E, class T>
+	std::size_t add(const expr::Condition<E, T> &condition) {
+		E copy = condition.self();
+		return this->add(std::function<bool()>([copy]() { return copy.evaluate(); }));
+	}
+
+	std::size_t add(const std::function<bool()> &predicate);
+
+	// returns the index of the first condition found satisfied or TIMEOUT,
+	// a timeout of 0 waits forever
+	int any(std::chrono::nanoseconds timeout = std::chrono::nanoseconds(0));
+
+	// returns false on timeout
+	bool all(std::chrono::nanoseconds timeout = std::chrono::nanoseconds(0));
+
+	// state of each condition after the last poll
+	const std::vector<bool>& satisfied() const {
+		return m_oSatisfied;
+	}
+
+	// polls done by the last wait
+	std::size_t iterations() const {
+		return m_uIterations;
+	}
+
+private:
+	struct Slot {
+		IRegBackend	*m_pBackend;
+		unsigned int	m_uOffset;
+		unsigned int	m_uSize;
+		eEndian		m_eEndian;
+		std::uint32_t	m_uValue;
+	};
+
+	struct Check {
+		std::string		m_sName;
+		std::size_t		m_uSlot;
+		std::uint32_t		m_uMask;
+		unsigned int		m_uShift;
+		eCompare		m_eCompare;
+		std::uint32_t		m_uValue;
+		std::function<bool()>	m_oPredicate;
+	};
+
+	// bits outside the access mask read as 0, like RegisterBase::get()
+	std::size_t add(const std::string &name, IRegBackend &backend, unsigned int offset, unsigned int size,
+			eEndian order, std::uint32_t mask, std::uint32_t accessMask, eCompare compare, std::uint32_t value);
+	// one polling iteration, returns the first satisfied condition or TIMEOUT
+	int poll();
+	bool test(const Check &check) const;
+	template <class F>
+	bool loop(std::chrono::nanoseconds timeout, F done);
+
+	std::chrono::nanoseconds	m_uInterval;
+	std::vector<Slot>		m_oSlots;
+	std::vector<Check>		m_oChecks;
+	std::vector<bool>		m_oSatisfied;
+	std::size_t			m_uIterations;
+};
+
+};
+
+#endif
@@ -0,0 +1,155 @@
+/* This file is part of libregmap.
+ *
+ * libregmap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libregmap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libregmap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef __REGMAP_WATCH__
+#define __REGMAP_WATCH__
+
+#include <functional>
+#include <string>
+#include <vector>
+#include "IRegBackend.hpp"
+#include "RegisterBase.hpp"
+
+namespace regmap {
+
+enum eTrigger {
+	CHANGE,		// any watched bit changed
+	RISING,		// a watched bit went from 0 to 1
+	FALLING,	// a watched bit went from 1 to 0
+	LEVEL_HIGH,	// on every poll while a watched bit is set
+	LEVEL_LOW	// on every poll while all watched bits are clear
+};
+
+struct WatchEvent {
+	std::string	m_sName;
+	unsigned int	m_uOffset;
+	std::uint32_t	m_uMask;
+	// the watched bits shifted down to bit 0
+	std::uint32_t	m_uBefore;
+	std::uint32_t	m_uAfter;
+};
+
+typedef std::function<void(const WatchEvent&)> WatchCallback_t;
+
+// Watches registers and fields of one backend for changes. A poll reads
+// all watched registers in coalesced transfers into a snapshot buffer and
+// compares it with the previous one in 16 byte blocks, callbacks are only
+// evaluated for registers in blocks that changed. A new watch takes its
+// baseline on its first poll and fires level triggers only, the other
+// watches keep their state.
+//
+// Callbacks run on the polling thread. They may call watch() and unwatch(),
+// watches added by a callback take effect with the next poll, unwatched
+// ones don't fire anymore. Polling again from a callback throws.
+class Watcher {
+
+public:
+	// registers up to maxGap bytes apart are read in one transfer, mapped
+	// backends are read register by register
+	explicit Watcher(IRegBackend &backend, unsigned int maxGap = 0);
+
+	// a change has to be seen on debounce consecutive polls before it is
+	// reported, returns an id for unwatch()
+	template <class T>
+	std::size_t watch(const RegisterBase<T> &reg, const WatchCallback_t &callback, eTrigger trigger = CHANGE,
+				T mask = static_cast<T>(~T(0)), unsigned int debounce = 0) {
+		this->checkBackend(reg.getBackend());
+		return this->add(reg.getName(), reg.getOffset(), sizeof(T), reg.getEndian(), mask, trigger, debounce, callback);
+	}
+
+	// watch a named bitmask of the register
+	template <class T>
+	std::size_t watch(const RegisterBase<T> &reg, const std::string &field, const WatchCallback_t &callback,
+				eTrigger trigger = CHANGE, unsigned int debounce = 0) {
+
+		auto it = reg.getBitmasks().find(field);
+		if (reg.getBitmasks().end() == it)
+			throw std::runtime_error("Bitmap not defined: " + field);
+
+		this->checkBackend(reg.getBackend());
+		return this->add(reg.getName() + "." + field, reg.getOffset(), sizeof(T), reg.getEndian(), it->m_uMask, trigger, debounce, callback);
+	}
+
+	void unwatch(std::size_t id);
+
+	// reads all watched registers once, returns the number of callbacks fired
+	std::size_t poll();
+
+	// number of transfers per poll
+	std::size_t transfers();
+
+private:
+	struct Watch {
+		std::string	m_sName;
+		unsigned int	m_uOffset;
+		unsigned int	m_uSize;
+		// registers in the other byte order are swapped on load
+		bool		m_bSwap;
+		std::uint32_t	m_uMask;
+		unsigned int	m_uShift;
+		eTrigger	m_eTrigger;
+		unsigned int	m_uDebounce;
+		WatchCallback_t	m_oCallback;
+		bool		m_bActive;
+		// the first value was read
+		bool		m_bBaseline;
+		// position of the register in the snapshot buffers
+		std::size_t	m_uPosition;
+		// last reported value and a change waiting for debouncing
+		std::uint32_t	m_uReported;
+		std::uint32_t	m_uCandidate;
+		unsigned int	m_uStable;
+		// poll the watch was last evaluated in
+		std::uint64_t	m_uPoll;
+	};
+
+	struct Range {
+		unsigned int	m_uOffset;
+		std::size_t	m_uSize;
+		std::size_t	m_uPosition;
+	};
+
+	static const std::size_t BLOCK = 16;
+
+	std::size_t add(const std::string &name, unsigned int offset, unsigned int size, eEndian order, std::uint32_t mask,
+			eTrigger trigger, unsigned int debounce, const WatchCallback_t &callback);
+	void checkBackend(const IRegBackend &backend) const;
+	std::size_t scan();
+	void settle();
+	void build();
+	void read(std::vector<unsigned char> &buffer);
+	std::uint32_t load(const std::vector<unsigned char> &buffer, const Watch &watch) const;
+	bool evaluate(Watch &watch, std::uint32_t before, std::uint32_t after);
+
+	IRegBackend				&m_oBackend;
+	unsigned int				m_uMaxGap;
+	std::vector<Watch>			m_oWatches;
+	// watches added by callbacks during a poll
+	std::vector<Watch>			m_oAdded;
+	std::vector<Range>			m_oRanges;
+	// watches per 16 byte block of the snapshot buffers
+	std::vector<std::vector<std::size_t> >	m_oBlocks;
+	// watches evaluated on every poll: level triggers and debouncing
+	std::vector<std::size_t>		m_oAlways;
+	std::vector<unsigned char>		m_oPrevious;
+	std::vector<unsigned char>		m_oCurrent;
+	std::uint64_t				m_uPoll;
+	bool					m_bDirty;
+	bool					m_bPolling;
+};
+
+};
+
+#endif
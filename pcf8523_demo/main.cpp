@@ -3,6 +3,7 @@
 #include <iostream>
 #include <string>
 #include <iomanip>
+#include <array>
 #include <ctime>
 
 int main(int argc, char** argv) {
@@ -0,0 +1,108 @@
+#include "regmap.hpp"
+#include "remote.hpp"
+
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <grp.h>
+#include <unistd.h>
+
+// Owns the register maps given on the command line and serves them to
+// regmap::remote::Remote clients on a unix socket:
+//
+//   regmapd /run/regmapd.sock nic=pci:0x10ec:0x8168:2:rtl8168.json rtc=i2c:0:0x68:pcf8523.json
+//   regmapd /run/regmapd.sock mmdc=devmem:0x021B0000:0x021B4000:mmdc.json
+
+static regmap::remote::Server *server = NULL;
+
+static void terminate(int) {
+	if (server)
+		server->stop();
+}
+
+static std::vector<std::string> split(const std::string &s, char delimiter) {
+
+	std::vector<std::string> parts;
+	std::stringstream ss(s);
+	std::string part;
+	while (std::getline(ss, part, delimiter))
+		parts.push_back(part);
+	return parts;
+}
+
+static unsigned long long number(const std::string &s) {
+	return strtoull(s.c_str(), NULL, 0);
+}
+
+int main(int argc, char** argv) {
+
+	// the socket is private to the daemon's user unless a group is given
+	mode_t mode = 0600;
+	gid_t group = static_cast<gid_t>(-1);
+	int opt;
+	while (-1 != (opt = getopt(argc, argv, "m:g:"))) {
+		if ('m' == opt) {
+			mode = strtoul(optarg, NULL, 8);
+		} else if ('g' == opt) {
+			struct group *entry = getgrnam(optarg);
+			if (!entry) {
+				std::cerr << "Unknown group: " << optarg << std::endl;
+				return 1;
+			}
+			group = entry->gr_gid;
+		} else {
+			optind = argc;
+			break;
+		}
+	}
+
+	if (argc - optind < 2) {
+		std::cerr << "usage: " << argv[0] << " [-m MODE] [-g GROUP] SOCKET NAME=pci:VENDOR:DEVICE:BAR:DEFINITION|i2c:BUS:ADDRESS:DEFINITION|devmem:START:END:DEFINITION..." << std::endl;
+		return 1;
+	}
+
+	// the maps only need to outlive the server
+	std::vector<std::shared_ptr<void> > maps;
+	regmap::remote::Server daemon(argv[optind], mode, group);
+
+	for (int i = optind + 1; i < argc; i++) {
+		std::string arg(argv[i]);
+		std::size_t eq = arg.find('=');
+		auto spec = split(arg.substr(eq + 1), ':');
+		if (std::string::npos == eq || spec.empty()) {
+			std::cerr << "Invalid map: " << arg << std::endl;
+			return 1;
+		}
+
+		std::string name = arg.substr(0, eq);
+		if (spec[0] == "pci" && spec.size() == 5) {
+			auto map = std::make_shared<regmap::pci::MemMapped>(regmap::pci::PCI_ID(number(spec[1]), number(spec[2])),
+				spec[4], static_cast<regmap::pci::eBARs>(number(spec[3])));
+			daemon.add(name, map->getBackend());
+			maps.push_back(map);
+		} else if (spec[0] == "i2c" && spec.size() == 4) {
+			auto map = std::make_shared<regmap::i2c::I2C>(number(spec[1]), number(spec[2]), spec[3]);
+			daemon.add(name, map->getBackend());
+			maps.push_back(map);
+		} else if (spec[0] == "devmem" && spec.size() == 4) {
+			auto map = std::make_shared<regmap::devmem::DevMem>(number(spec[1]), number(spec[2]), spec[3]);
+			daemon.add(name, map->getBackend());
+			maps.push_back(map);
+		} else {
+			std::cerr << "Invalid map: " << arg << std::endl;
+			return 1;
+		}
+	}
+
+	server = &daemon;
+	signal(SIGINT, terminate);
+	signal(SIGTERM, terminate);
+
+	daemon.run();
+	std::cout << daemon.batches() << " batches, " << daemon.accesses() << " accesses served" << std::endl;
+	return 0;
+}
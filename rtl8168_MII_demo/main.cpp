@@ -22,6 +22,13 @@ int main(int argc, char** argv) {
 	std::cout << "Link status....: " << (phyar.is_set("PMAPMD_STAT1_RECEIVE_LINK") ? "UP" : "DOWN") << std::endl;
 	std::cout << "Fault condition: " << std::boolalpha << phyar.is_set("PMAPMD_STAT1_FAULT_COND")  << std::endl;
 
+	// The same through a map of the PHY's registers, the PHYAR handshake
+	// is declared in rtl8168_phy.json
+	regmap::indirect::Indirect phy(memmap, "rtl8168_phy.json");
+	auto bmsr = phy.get<regmap::Register16_t>("BMSR");
+	std::cout << "PHY ID.........: " << phy.get<regmap::Register16_t>("PHYID1") << ":" << phy.get<regmap::Register16_t>("PHYID2") << std::endl;
+	std::cout << "Link status....: " << (bmsr.is_set("RECEIVE_LINK") ? "UP" : "DOWN") << std::endl;
+
 	return 0;
 }
 
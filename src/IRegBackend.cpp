@@ -0,0 +1,28 @@
+/* This file is part of libregmap.
+ *
+ * libregmap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libregmap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libregmap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <string>
+#include <stdexcept>
+#include "IRegBackend.hpp"
+
+namespace regmap {
+
+__attribute__((noinline, cold))
+void throwOutOfRange(const char *backend, unsigned int offset) {
+
+	throw std::out_of_range(std::string(backend) + ": Given offset is out of range: " + std::to_string(offset));
+}
+
+};
@@ -0,0 +1,277 @@
+/* This file is part of libregmap.
+ *
+ * libregmap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libregmap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libregmap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <mutex>
+#include <map>
+#include <algorithm>
+#include <boost/filesystem.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include "RegMapDefinition.hpp"
+
+namespace regmap {
+
+static unsigned int number(const pt::ptree &node, const std::string &key) {
+	return static_cast<unsigned int>(strtoul(node.get<std::string>(key).c_str(), NULL, 0));
+}
+
+static unsigned int number(const pt::ptree &node, const std::string &key, const std::string &def) {
+	return static_cast<unsigned int>(strtoul(node.get<std::string>(key, def).c_str(), NULL, 0));
+}
+
+// Throws if a register of the block placed at base ends beyond size. Array
+// elements share one layout at ascending offsets, so only the last element
+// is checked, without expanding the array.
+static void check(const RegisterBlock &block, const std::string &prefix, std::uint64_t base, std::size_t size, const std::string &defFile) {
+
+	for (auto &reg : block.m_oRegisters) {
+		if (base + reg.m_uOffset + reg.m_uSize > size)
+			throw std::out_of_range("Register " + prefix + reg.m_pName + " at offset " + std::to_string(base + reg.m_uOffset)
+				+ " exceeds the backend size of " + std::to_string(size) + " bytes: " + defFile);
+	}
+
+	for (auto &array : block.m_oArrays) {
+
+		if (!array.second.m_uCount)
+			continue;
+
+		const RegisterBlock &element = *array.second.m_pElement;
+		unsigned int last = array.second.m_uCount - 1;
+		std::string name = prefix + array.first + "[" + std::to_string(last) + "]";
+		std::uint64_t offset = base + array.second.m_uOffset + static_cast<std::uint64_t>(last) * array.second.m_uStride;
+
+		// arrays of single registers hold just the register named like the array
+		bool single = element.m_oArrays.empty() && element.m_oRegisters.size() == 1 &&
+				element.m_oRegisters.front().m_pName == array.first;
+		if (single && offset + element.m_oRegisters.front().m_uOffset + element.m_oRegisters.front().m_uSize > size)
+			throw std::out_of_range("Register " + name + " at offset " + std::to_string(offset + element.m_oRegisters.front().m_uOffset)
+				+ " exceeds the backend size of " + std::to_string(size) + " bytes: " + defFile);
+
+		check(element, name + ".", offset, size, defFile);
+	}
+}
+
+RegMapDefinition::RegMapDefinition(const std::string &defFile)
+: m_sDefFile(defFile), m_eEndian(HOST_ENDIAN) {
+
+	pt::ptree pTree;
+	try {
+		pt::read_json(defFile, pTree);
+	} catch (...) {
+		throw std::runtime_error("Definition file could not be parsed: " + defFile);
+	}
+
+	// byte order of the whole map, registers may override it
+	auto endian = pTree.get_optional<std::string>("endian");
+	if (endian)
+		m_eEndian = parseEndian(*endian);
+
+	// set/clear/toggle aliases for the whole map, registers may override them
+	auto mapAliases = pTree.get_child_optional("aliases");
+	this->parseRegisters(pTree.get_child("registers"), mapAliases ? &*mapAliases : NULL, m_oRegisters);
+
+	auto regions = pTree.get_child_optional("regions");
+	if (regions)
+		this->parseRegions(*regions);
+
+	m_oNames.seal();
+	m_oBitmaskTables.clear();
+}
+
+Definition_t RegMapDefinition::load(const std::string &defFile) {
+
+	struct Entry {
+		std::weak_ptr<const RegMapDefinition>	m_pDefinition;
+		std::time_t				m_tModified;
+	};
+	static std::mutex mutex;
+	static std::map<std::string, Entry> cache;
+
+	boost::system::error_code ec;
+	boost::filesystem::path path = boost::filesystem::canonical(defFile, ec);
+	if (ec)
+		throw std::runtime_error("Definition file could not be parsed: " + defFile);
+
+	std::time_t modified = boost::filesystem::last_write_time(path, ec);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	Entry &entry = cache[path.string()];
+	Definition_t definition = entry.m_pDefinition.lock();
+	if (!definition || entry.m_tModified != modified) {
+		definition = std::make_shared<const RegMapDefinition>(defFile);
+		entry.m_pDefinition = definition;
+		entry.m_tModified = modified;
+	}
+
+	return definition;
+}
+
+const Layout_t& RegMapDefinition::layout() const {
+
+	std::call_once(m_oLayoutOnce, [this]() { m_pLayout = flatten(m_oRegisters); });
+	return m_pLayout;
+}
+
+void RegMapDefinition::check(std::size_t size) const {
+
+	if (!size)
+		return;
+
+	// arithmetically, the layout is only built for the features using it
+	regmap::check(m_oRegisters, "", 0, size, m_sDefFile);
+
+	for (auto &region : m_oRegions) {
+		if (region.second.m_uOffset + region.second.m_uSize > size)
+			throw std::out_of_range("Region " + region.first + " at offset " + std::to_string(region.second.m_uOffset)
+				+ " exceeds the backend size of " + std::to_string(size) + " bytes: " + m_sDefFile);
+	}
+}
+
+IRegBackend& RegMapDefinition::unbound() {
+
+	static IRegBackend backend;
+	return backend;
+}
+
+// device memory ranges, accessed 4 bytes at a time unless a width is given
+void RegMapDefinition::parseRegions(const pt::ptree &regions) {
+
+	for (auto &node : regions) {
+
+		Region region(number(node.second, "offset"), number(node.second, "size"), number(node.second, "width", "4"));
+		checkAccessWidth(region.m_uWidth);
+		if (region.m_uSize % region.m_uWidth)
+			throw std::runtime_error("Region size is not a multiple of its width: " + node.first);
+
+		m_oRegions.insert(std::make_pair(node.first, region));
+	}
+}
+
+// parse and create all registers of a block, arrays are declared as
+// NAME[count] with a stride and contain either a single register or a
+// nested "registers" block
+void RegMapDefinition::parseRegisters(const pt::ptree &registers, const pt::ptree *mapAliases, RegisterBlock &block) {
+
+	for (auto &node : registers) {
+
+		std::string key = node.first;
+		std::size_t bracket = key.find('[');
+		if (std::string::npos == bracket) {
+			block.insert(this->createRegister(key, node.second, mapAliases));
+			continue;
+		}
+
+		if (key.back() != ']')
+			throw std::runtime_error("Malformed register array " + key);
+
+		unsigned int count = static_cast<unsigned int>(strtoul(key.substr(bracket + 1).c_str(), NULL, 0));
+		key = key.substr(0, bracket);
+		if (!count)
+			throw std::runtime_error("Register array without elements: " + key);
+
+		auto nested = node.second.get_child_optional("registers");
+		unsigned int stride = number(node.second, "stride", nested ? "0" : node.second.get<std::string>("size", "0"));
+		if (!stride)
+			throw std::runtime_error("No stride given for register array " + key);
+
+		RegisterArray array(number(node.second, "offset"), count, stride);
+		if (nested) {
+			this->parseRegisters(*nested, mapAliases, *array.m_pElement);
+		} else {
+			RegisterEntry reg = this->createRegister(key, node.second, mapAliases);
+			// the element's register sits at the start of each element
+			reg.m_uOffset = 0;
+			array.m_pElement->insert(reg);
+			array.m_pElement->seal();
+		}
+
+		block.m_oArrays.insert(std::make_pair(key, array));
+	}
+
+	block.seal();
+}
+
+RegisterEntry RegMapDefinition::createRegister(const std::string &key, const pt::ptree &node, const pt::ptree *mapAliases) {
+
+	unsigned int size = number(node, "size");
+	if (1 != size && 2 != size && 4 != size)
+		throw std::runtime_error("Size out of range for register " + key);
+
+	// masks are cut to the register width
+	std::uint32_t width = 4 == size ? 0xFFFFFFFF : (1u << (8 * size)) - 1;
+	auto mask = [&node, width](const std::string &name, const std::string &def) -> std::uint32_t {
+		return number(node, name, def) & width;
+	};
+
+	RegisterEntry reg(m_oNames.intern(key), number(node, "offset"), size);
+	reg.m_uBusyMask = mask("busy_mask", "0");
+	reg.m_uReadyMask = mask("ready_mask", "0");
+	reg.m_uAccessMask = mask("access_mask", "0xFFFFFFFF");
+	reg.m_uResetMask = mask("reset_mask", "0xFFFFFFFF");
+	reg.m_uStartMask = mask("start_mask", "0xFFFFFFFF");
+	reg.m_uFreezeMask = mask("freeze_mask", "0xFFFFFFFF");
+
+	// parse alias offsets
+	auto regAliases = node.get_child_optional("aliases");
+	const pt::ptree *aliases = regAliases ? &*regAliases : mapAliases;
+	if (aliases) {
+		auto aliasOffset = [aliases](const std::string &name) -> unsigned int {
+			auto value = aliases->get_optional<std::string>(name);
+			return value ? static_cast<unsigned int>(strtoul(value->c_str(), NULL, 0)) : RegisterEntry::NO_ALIAS;
+		};
+		reg.m_uSetAlias = aliasOffset("set");
+		reg.m_uClearAlias = aliasOffset("clear");
+		reg.m_uToggleAlias = aliasOffset("toggle");
+	}
+
+	auto endian = node.get_optional<std::string>("endian");
+	reg.m_eEndian = endian ? parseEndian(*endian) : m_eEndian;
+
+	// hints for caches, see cache.hpp
+	reg.m_bVolatile = "true" == node.get<std::string>("volatile", "false");
+	reg.m_uTtl = number(node, "ttl_us", "0");
+
+	// parse defined bitmasks
+	auto bitmasks = node.get_child_optional("bitmasks");
+	if (bitmasks) {
+		std::vector<std::pair<std::string, std::uint32_t> > masks;
+		for (auto &bitmask : *bitmasks) {
+			for (auto &other : masks) {
+				if (other.first == bitmask.first)
+					throw std::runtime_error("Bitmap already defined: " + bitmask.first);
+			}
+			masks.push_back(std::make_pair(bitmask.first, static_cast<std::uint32_t>(strtoul(bitmask.second.data().c_str(), NULL, 0)) & width));
+		}
+		reg.m_pBitmasks = this->share(std::move(masks));
+	}
+
+	return reg;
+}
+
+// registers with the same bitmasks share one table, e.g. all channels of a bank
+Bitmasks_t RegMapDefinition::share(std::vector<std::pair<std::string, std::uint32_t> > bitmasks) {
+
+	if (bitmasks.empty())
+		return Bitmasks_t();
+
+	std::sort(bitmasks.begin(), bitmasks.end());
+	Bitmasks_t &table = m_oBitmaskTables[bitmasks];
+	if (!table)
+		table = std::make_shared<const BitmaskTable>(bitmasks);
+
+	return table;
+}
+
+};
@@ -25,7 +25,7 @@ template <class U>
 bool RegisterBase<T>::wait(const U &timeout) {
 		
 	if (m_uReadyMask == 0)
-		throw std::runtime_error("No ready mask set for register " + m_sRegName);
+		throw std::runtime_error(std::string("No ready mask set for register ") + m_pName);
 
 	auto start = std::chrono::high_resolution_clock::now();
 	while(!this->is_set(m_uReadyMask)) {
@@ -45,7 +45,7 @@ template <class U>
 bool RegisterBase<T>::work(const U &timeout) {
 
 	if (m_uBusyMask == 0)
-		throw std::runtime_error("No busy mask set for register " + m_sRegName);
+		throw std::runtime_error(std::string("No busy mask set for register ") + m_pName);
 
 	auto start = std::chrono::high_resolution_clock::now();
 	while(this->is_set(m_uBusyMask)) {
@@ -63,19 +63,18 @@ bool RegisterBase<T>::work(const U &timeout) {
 template <class T>
 T RegisterBase<T>::operator[](const std::string &name) {
 
-	if (m_oBitmasks.end() == m_oBitmasks.find(name))
+	const BitmaskTable &bitmasks = this->getBitmasks();
+	auto it = bitmasks.find(name);
+	if (bitmasks.end() == it)
 		throw std::runtime_error("Bitmap not defined: " + name);
 
-	return m_oBitmasks[name];
+	return static_cast<T>(it->m_uMask);
 }
 
 template <class T>
 void RegisterBase<T>::addBitmask(const std::string &name, T mask) {
 		
-	if (m_oBitmasks.end() != m_oBitmasks.find(name))
-		throw std::runtime_error("Bitmap already defined: " + name);
-
-	m_oBitmasks[name] = mask;
+	m_pBitmasks = this->getBitmasks().with(name, mask);
 }
 
 template bool RegisterBase<std::uint8_t>::work(const std::chrono::nanoseconds&);
@@ -0,0 +1,170 @@
+/* This file is part of libregmap.
+ *
+ * libregmap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libregmap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libregmap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "bulk.hpp"
+
+namespace regmap {
+
+namespace {
+
+// Single accesses of exactly W bytes. Volatile keeps the compiler from
+// splitting, merging or widening them, the host side goes through memcpy
+// as it may be unaligned.
+template <unsigned int W> struct Access;
+
+#define __REGMAP_ACCESS(W, T) \
+template <> struct Access<W> { \
+	static void store(volatile unsigned char *dst, const unsigned char *src) { \
+		T value; \
+		memcpy(&value, src, W); \
+		*reinterpret_cast<volatile T*>(dst) = value; \
+	} \
+	static void load(unsigned char *dst, const volatile unsigned char *src) { \
+		T value = *reinterpret_cast<const volatile T*>(src); \
+		memcpy(dst, &value, W); \
+	} \
+};
+
+__REGMAP_ACCESS(1, std::uint8_t)
+__REGMAP_ACCESS(2, std::uint16_t)
+__REGMAP_ACCESS(4, std::uint32_t)
+__REGMAP_ACCESS(8, std::uint64_t)
+
+#if defined(__SSE2__)
+// volatile does not apply to SSE intrinsics, the device side is a single
+// movdqa in asm volatile so it is neither elided nor split
+template <> struct Access<16> {
+	static void store(volatile unsigned char *dst, const unsigned char *src) {
+		__m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+		__asm__ __volatile__("movdqa %1, %0" : "=m"(*reinterpret_cast<volatile __m128i*>(dst)) : "x"(value));
+	}
+	static void load(unsigned char *dst, const volatile unsigned char *src) {
+		__m128i value;
+		__asm__ __volatile__("movdqa %1, %0" : "=x"(value) : "m"(*reinterpret_cast<const volatile __m128i*>(src)));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst), value);
+	}
+};
+#endif
+
+// the widest access up to width the device address is aligned for
+inline unsigned int fit(std::uintptr_t address, std::size_t size, unsigned int width) {
+
+	unsigned int w = width;
+	while (w > 1 && ((address & (w - 1)) || w > size))
+		w >>= 1;
+	return w;
+}
+
+// one access of w bytes, ToDevice selects the direction
+template <bool ToDevice>
+inline void single(volatile unsigned char *device, unsigned char *host, unsigned int w) {
+
+	switch (w) {
+		case 1:
+		ToDevice ? Access<1>::store(device, host) : Access<1>::load(host, device);
+		break;
+		case 2:
+		ToDevice ? Access<2>::store(device, host) : Access<2>::load(host, device);
+		break;
+		case 4:
+		ToDevice ? Access<4>::store(device, host) : Access<4>::load(host, device);
+		break;
+		case 8:
+		ToDevice ? Access<8>::store(device, host) : Access<8>::load(host, device);
+		break;
+#if defined(__SSE2__)
+		case 16:
+		ToDevice ? Access<16>::store(device, host) : Access<16>::load(host, device);
+		break;
+#endif
+	}
+}
+
+template <bool ToDevice, unsigned int W>
+inline void body(volatile unsigned char *&device, unsigned char *&host, std::size_t &size) {
+
+	for (; size >= W; size -= W, device += W, host += W)
+		ToDevice ? Access<W>::store(device, host) : Access<W>::load(host, device);
+}
+
+template <bool ToDevice>
+void copy(volatile unsigned char *device, unsigned char *host, std::size_t size, unsigned int width) {
+
+	checkAccessWidth(width);
+
+	// narrower accesses until the device address is aligned to width
+	while (size && (reinterpret_cast<std::uintptr_t>(device) & (width - 1))) {
+		unsigned int w = fit(reinterpret_cast<std::uintptr_t>(device), size, width);
+		single<ToDevice>(device, host, w);
+		device += w;
+		host += w;
+		size -= w;
+	}
+
+	switch (width) {
+		case 1: body<ToDevice, 1>(device, host, size); break;
+		case 2: body<ToDevice, 2>(device, host, size); break;
+		case 4: body<ToDevice, 4>(device, host, size); break;
+		case 8: body<ToDevice, 8>(device, host, size); break;
+#if defined(__SSE2__)
+		case 16: body<ToDevice, 16>(device, host, size); break;
+#endif
+	}
+
+	// and narrower ones for the tail
+	while (size) {
+		unsigned int w = fit(reinterpret_cast<std::uintptr_t>(device), size, width);
+		single<ToDevice>(device, host, w);
+		device += w;
+		host += w;
+		size -= w;
+	}
+}
+
+}
+
+void checkAccessWidth(unsigned int width) {
+
+	switch (width) {
+		case 1: case 2: case 4: case 8:
+		return;
+#if defined(__SSE2__)
+		case 16:
+		return;
+#endif
+		default:
+		throw std::runtime_error("Unsupported access width: " + std::to_string(width));
+	}
+}
+
+void copyToDevice(volatile void *dst, const void *src, std::size_t size, unsigned int width) {
+
+	copy<true>(static_cast<volatile unsigned char*>(dst), static_cast<unsigned char*>(const_cast<void*>(src)), size, width);
+}
+
+void copyFromDevice(void *dst, const volatile void *src, std::size_t size, unsigned int width) {
+
+	copy<false>(static_cast<volatile unsigned char*>(const_cast<volatile void*>(src)), static_cast<unsigned char*>(dst), size, width);
+}
+
+};
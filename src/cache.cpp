@@ -0,0 +1,196 @@
+/* This file is part of libregmap.
+ *
+ * libregmap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libregmap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libregmap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include "cache.hpp"
+
+namespace regmap { namespace cache {
+
+double Statistics::hitRate() const {
+
+	std::uint64_t reads = m_uHits + m_uMisses;
+	return reads ? static_cast<double>(m_uHits) / reads : 0.0;
+}
+
+Duration_t Statistics::savedTime() const {
+
+	return m_uBusReads ? Duration_t(m_uBusTime.count() / m_uBusReads * m_uHits) : Duration_t(0);
+}
+
+RegBackendCached::RegBackendCached(IRegBackend &parent, const Layout &layout, const Policy &policy)
+: m_pParent(&parent), m_pState(std::make_shared<State>()) {
+
+	if (!policy.m_uWindow || policy.m_uTtl <= Duration_t(0))
+		throw std::runtime_error("RegBackendCached: window and time to live must not be zero");
+
+	// only the extent of the definition is cached, reads beyond the last
+	// register bypass the cache, e.g. the rest of a large memory window
+	std::size_t size = 0;
+	for (auto &info : layout)
+		size = std::max<std::size_t>(size, info.m_uOffset + info.m_uSize);
+
+	State &state = *m_pState;
+	state.m_oPolicy = policy;
+	state.m_oData.resize(size, 0);
+	state.m_oExpiry.resize(size, Clock_t::time_point::min());
+	state.m_oTtl.resize(size, policy.m_uTtl);
+
+	for (auto &info : layout) {
+		Duration_t ttl = info.m_bVolatile ? Duration_t(0)
+				: info.m_uTtl ? Duration_t(std::chrono::microseconds(info.m_uTtl)) : policy.m_uTtl;
+		std::fill(state.m_oTtl.begin() + info.m_uOffset, state.m_oTtl.begin() + info.m_uOffset + info.m_uSize, ttl);
+	}
+}
+
+Statistics RegBackendCached::statistics() const {
+
+	if (!m_pState)
+		return Statistics();
+
+	std::lock_guard<std::mutex> lock(m_pState->m_oMutex);
+	return m_pState->m_oStatistics;
+}
+
+void RegBackendCached::resetStatistics() {
+
+	std::lock_guard<std::mutex> lock(m_pState->m_oMutex);
+	m_pState->m_oStatistics = Statistics();
+}
+
+void RegBackendCached::invalidate() {
+
+	std::lock_guard<std::mutex> lock(m_pState->m_oMutex);
+	std::fill(m_pState->m_oExpiry.begin(), m_pState->m_oExpiry.end(), Clock_t::time_point::min());
+}
+
+size_t RegBackendCached::size() const {
+
+	return m_pParent ? m_pParent->size() : 0;
+}
+
+// FIFO data registers are never cached
+void RegBackendCached::read_repeated(unsigned int offset, void* dst, size_t width, size_t count) {
+
+	std::lock_guard<std::mutex> lock(m_pState->m_oMutex);
+	auto start = Clock_t::now();
+	m_pParent->read_repeated(offset, dst, width, count);
+
+	Statistics &stats = m_pState->m_oStatistics;
+	stats.m_uBusTime += Clock_t::now() - start;
+	stats.m_uBusReads++;
+	stats.m_uBypassed++;
+}
+
+void RegBackendCached::write_repeated(unsigned int offset, const void* src, size_t width, size_t count) {
+
+	std::lock_guard<std::mutex> lock(m_pState->m_oMutex);
+	m_pParent->write_repeated(offset, src, width, count);
+	this->invalidate(offset, width);
+}
+
+void RegBackendCached::write(unsigned int offset, void* value, size_t size) {
+
+	std::lock_guard<std::mutex> lock(m_pState->m_oMutex);
+	switch (size) {
+		case 1: m_pParent->set<std::uint8_t>(offset, *static_cast<std::uint8_t*>(value)); break;
+		case 2: m_pParent->set<std::uint16_t>(offset, *static_cast<std::uint16_t*>(value)); break;
+		case 4: m_pParent->set<std::uint32_t>(offset, *static_cast<std::uint32_t*>(value)); break;
+		default: m_pParent->copy_to_device(offset, value, size); break;
+	}
+
+	// devices don't necessarily read back what was written, e.g. write
+	// one to clear bits, the next read goes to the device
+	this->invalidate(offset, size);
+}
+
+void RegBackendCached::read(unsigned int offset, void* value, size_t size) {
+
+	std::lock_guard<std::mutex> lock(m_pState->m_oMutex);
+	State &state = *m_pState;
+	Statistics &stats = state.m_oStatistics;
+
+	if (!this->cacheable(offset, size)) {
+		stats.m_uBypassed++;
+		return this->fetch(offset, value, size);
+	}
+
+	auto now = Clock_t::now();
+	auto expired = std::find_if(state.m_oExpiry.begin() + offset, state.m_oExpiry.begin() + offset + size,
+		[now](const Clock_t::time_point &expiry) { return expiry <= now; });
+	if (state.m_oExpiry.begin() + offset + size == expired) {
+		memcpy(value, &state.m_oData[offset], size);
+		stats.m_uHits++;
+		return;
+	}
+
+	// read ahead up to the window size, volatile registers are left out
+	unsigned int begin = offset, end = offset + size;
+	while (begin > 0 && offset - (begin - 1) <= state.m_oPolicy.m_uBefore && state.m_oTtl[begin - 1] > Duration_t(0))
+		begin--;
+	while (end < state.m_oData.size() && end - begin < state.m_oPolicy.m_uWindow && state.m_oTtl[end] > Duration_t(0))
+		end++;
+
+	// a failed transfer leaves the cache untouched
+	state.m_oScratch.resize(end - begin);
+	this->fetch(begin, state.m_oScratch.data(), end - begin);
+	memcpy(&state.m_oData[begin], state.m_oScratch.data(), end - begin);
+	for (unsigned int i = begin; i < end; i++)
+		state.m_oExpiry[i] = now + state.m_oTtl[i];
+
+	memcpy(value, &state.m_oData[offset], size);
+	stats.m_uMisses++;
+}
+
+bool RegBackendCached::cacheable(unsigned int offset, size_t size) const {
+
+	const State &state = *m_pState;
+	if (this->isIndirect() || offset + size > state.m_oData.size())
+		return false;
+
+	return std::all_of(state.m_oTtl.begin() + offset, state.m_oTtl.begin() + offset + size,
+		[](const Duration_t &ttl) { return ttl > Duration_t(0); });
+}
+
+// a single transfer of the parent, timed
+void RegBackendCached::fetch(unsigned int offset, void* value, size_t size) {
+
+	auto start = Clock_t::now();
+	switch (size) {
+		case 1: *static_cast<std::uint8_t*>(value) = m_pParent->get<std::uint8_t>(offset); break;
+		case 2: *static_cast<std::uint16_t*>(value) = m_pParent->get<std::uint16_t>(offset); break;
+		case 4: *static_cast<std::uint32_t*>(value) = m_pParent->get<std::uint32_t>(offset); break;
+		default: m_pParent->copy_from_device(offset, value, size); break;
+	}
+
+	Statistics &stats = m_pState->m_oStatistics;
+	stats.m_uBusTime += Clock_t::now() - start;
+	stats.m_uBusReads++;
+}
+
+void RegBackendCached::invalidate(unsigned int offset, size_t size) {
+
+	State &state = *m_pState;
+	if (offset >= state.m_oExpiry.size())
+		return;
+
+	size = std::min<size_t>(size, state.m_oExpiry.size() - offset);
+	std::fill(state.m_oExpiry.begin() + offset, state.m_oExpiry.begin() + offset + size, Clock_t::time_point::min());
+}
+
+}};
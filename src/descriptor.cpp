@@ -0,0 +1,116 @@
+/* This file is part of libregmap.
+ *
+ * libregmap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libregmap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libregmap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include "descriptor.hpp"
+
+namespace regmap {
+
+const unsigned int RegisterEntry::NO_ALIAS;
+const std::size_t StringPool::BLOCK;
+
+BitmaskTable::BitmaskTable(std::vector<std::pair<std::string, std::uint32_t> > bitmasks) {
+
+	std::sort(bitmasks.begin(), bitmasks.end());
+
+	std::size_t bytes = 0;
+	for (auto &bitmask : bitmasks)
+		bytes += bitmask.first.size() + 1;
+
+	// the names are placed first, the pointers into them once they are all stored
+	m_oNames.reserve(bytes);
+	for (auto &bitmask : bitmasks)
+		m_oNames.insert(m_oNames.end(), bitmask.first.c_str(), bitmask.first.c_str() + bitmask.first.size() + 1);
+
+	m_oBitmasks.reserve(bitmasks.size());
+	const char *name = m_oNames.data();
+	for (auto &bitmask : bitmasks) {
+		m_oBitmasks.push_back(Bitmask{name, bitmask.second});
+		name += bitmask.first.size() + 1;
+	}
+}
+
+BitmaskTable::const_iterator BitmaskTable::find(const std::string &name) const {
+
+	auto it = std::lower_bound(this->begin(), this->end(), name, [](const Bitmask &bitmask, const std::string &name) {
+		return name.compare(bitmask.m_pName) > 0;
+	});
+
+	return (this->end() != it && name == it->m_pName) ? it : this->end();
+}
+
+Bitmasks_t BitmaskTable::with(const std::string &name, std::uint32_t mask) const {
+
+	if (this->end() != this->find(name))
+		throw std::runtime_error("Bitmap already defined: " + name);
+
+	std::vector<std::pair<std::string, std::uint32_t> > bitmasks;
+	bitmasks.reserve(this->size() + 1);
+	for (auto &bitmask : *this)
+		bitmasks.push_back(std::make_pair(std::string(bitmask.m_pName), bitmask.m_uMask));
+	bitmasks.push_back(std::make_pair(name, mask));
+
+	return std::make_shared<const BitmaskTable>(std::move(bitmasks));
+}
+
+const BitmaskTable& BitmaskTable::none() {
+
+	static const BitmaskTable table((std::vector<std::pair<std::string, std::uint32_t> >()));
+	return table;
+}
+
+const char* StringPool::intern(const std::string &string) {
+
+	auto it = m_oIndex.find(string);
+	if (m_oIndex.end() != it)
+		return it->second;
+
+	std::size_t size = string.size() + 1;
+	if (size > m_uFree) {
+		// small definitions take small blocks
+		std::size_t block = std::max(size, m_oSizes.empty() ? std::size_t(1024) : std::min(BLOCK, 2 * m_oSizes.back()));
+		m_oBlocks.emplace_back(new char[block]);
+		m_oSizes.push_back(block);
+		m_pNext = m_oBlocks.back().get();
+		m_uFree = block;
+	}
+
+	char *copy = m_pNext;
+	memcpy(copy, string.c_str(), size);
+	m_pNext += size;
+	m_uFree -= size;
+
+	m_oIndex.insert(std::make_pair(string, copy));
+	return copy;
+}
+
+void StringPool::seal() {
+
+	std::unordered_map<std::string, const char*>().swap(m_oIndex);
+}
+
+std::size_t StringPool::capacity() const {
+
+	std::size_t bytes = 0;
+	for (auto size : m_oSizes)
+		bytes += size;
+	return bytes;
+}
+
+};
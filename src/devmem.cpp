@@ -15,37 +15,114 @@
  */
 
 #include <stdexcept>
+#include <vector>
 #include <sys/mman.h>
 #include "devmem.hpp"
 
 namespace regmap { namespace devmem {
 
-DevMem::DevMem(std::uint32_t physStart, std::uint32_t physEnd, const std::string &defFile)
-: RegMapBase(defFile) {
+MappingManager::MappingManager(const std::string &device)
+: m_sDevice(device) {}
 
-	if (physEnd - physStart <= 0)
-		std::runtime_error("DevMem: Illegal physical adresses given");
+MappingManager& MappingManager::instance() {
 
-	std::uint32_t regionSize = physEnd - physStart;
+	static MappingManager manager;
+	return manager;
+}
+
+std::size_t MappingManager::pageSize() {
+
+	static const std::size_t size = sysconf(_SC_PAGESIZE);
+	return size;
+}
+
+std::size_t MappingManager::mappings() {
+
+	std::lock_guard<std::mutex> lock(m_oMutex);
+	this->purge();
+	return m_oMappings.size();
+}
+
+void MappingManager::purge() {
+
+	for (auto it = m_oMappings.begin(); it != m_oMappings.end();) {
+		if (it->second.m_pBase.expired())
+			it = m_oMappings.erase(it);
+		else
+			++it;
+	}
+}
+
+BackendMemory_t MappingManager::map(std::uint64_t physStart, std::size_t size) {
+
+	if (!size)
+		throw std::runtime_error("DevMem: Illegal physical adresses given");
+
+	std::uint64_t page = pageSize();
+	std::uint64_t start = physStart & ~(page - 1);
+	std::uint64_t end = (physStart + size + page - 1) & ~(page - 1);
+
+	std::lock_guard<std::mutex> lock(m_oMutex);
+	this->purge();
+
+	// a mapping containing the whole range, or all mappings overlapping or
+	// touching it which get merged into a new one
+	std::vector<std::map<std::uint64_t, Mapping>::iterator> merge;
+	for (auto it = m_oMappings.begin(); it != m_oMappings.end() && it->first <= end; ++it) {
 
-	int fd = open("/dev/mem", O_RDWR);
+		if (it->second.m_uEnd < start)
+			continue;
+
+		if (it->first <= start && end <= it->second.m_uEnd) {
+			BackendMemory_t base = it->second.m_pBase.lock();
+			if (base)
+				return BackendMemory_t(base, static_cast<unsigned char*>(base.get()) + (physStart - it->first));
+		}
+
+		merge.push_back(it);
+	}
+
+	for (auto it : merge) {
+		start = std::min(start, it->first);
+		end = std::max(end, it->second.m_uEnd);
+	}
+
+	int fd = open(m_sDevice.c_str(), O_RDWR);
 	if (-1 == fd)
-		throw std::runtime_error("Unable to open /dev/mem");
+		throw std::runtime_error("Unable to open " + m_sDevice);
 
-	void *ptr = mmap(NULL, regionSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, physStart);
+	std::size_t length = end - start;
+	void *ptr = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, start);
 	close(fd);
 	if (MAP_FAILED == ptr)
-		throw std::runtime_error("Could not memmap given devmem region " + std::to_string(physStart) + "-" + std::to_string(physEnd));
+		throw std::runtime_error("Could not memmap given devmem region " + std::to_string(physStart) + "-" + std::to_string(physStart + size));
 
-	m_pMemory = std::shared_ptr<void>(ptr, std::bind(&DevMem::munmapDeleter, std::placeholders::_1, regionSize));
-	m_oRegBackendMemory = RegBackendMemory(m_pMemory, regionSize);
-	m_oRegBackend = m_oRegBackendMemory;
+	// merged mappings stay valid for their current users
+	for (auto it : merge)
+		m_oMappings.erase(it);
+
+	BackendMemory_t base(ptr, std::bind(&MappingManager::munmapDeleter, std::placeholders::_1, length));
+	m_oMappings[start] = Mapping{end, base};
+
+	return BackendMemory_t(base, static_cast<unsigned char*>(ptr) + (physStart - start));
 }
 
-void DevMem::munmapDeleter(void* addr, std::size_t length) {
+void MappingManager::munmapDeleter(void* addr, std::size_t length) {
 
 	munmap(addr, length);
 }
 
-}};
+DevMem::DevMem(std::uint64_t physStart, std::uint64_t physEnd, const DefinitionRef &definition, MappingManager &manager)
+: RegMapBase(definition) {
+
+	if (physEnd <= physStart)
+		throw std::runtime_error("DevMem: Illegal physical adresses given");
 
+	std::size_t regionSize = physEnd - physStart;
+
+	m_pMemory = manager.map(physStart, regionSize);
+	m_oRegBackendMemory = RegBackendMemory(m_pMemory, regionSize);
+	this->setBackend(m_oRegBackendMemory);
+}
+
+}};
@@ -0,0 +1,96 @@
+/* This file is part of libregmap.
+ *
+ * libregmap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libregmap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libregmap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdexcept>
+#include <cstring>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "endian.hpp"
+
+namespace regmap {
+
+#if defined(__SSE2__)
+static inline __m128i swap16(__m128i v) {
+	return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+
+static inline __m128i swap32(__m128i v) {
+	v = swap16(v);
+	v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+	return _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+}
+
+static inline __m128i swap64(__m128i v) {
+	v = swap16(v);
+	v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+	return _mm_shufflehi_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+}
+#endif
+
+template <class T>
+static void swapScalar(unsigned char *p, std::size_t count) {
+
+	for (std::size_t i = 0; i < count; i++, p += sizeof(T)) {
+		T value;
+		memcpy(&value, p, sizeof(T));
+		value = byteswap<T>(value);
+		memcpy(p, &value, sizeof(T));
+	}
+}
+
+void swapWords(void *data, std::size_t count, unsigned int width) {
+
+	unsigned char *p = static_cast<unsigned char*>(data);
+	std::size_t bytes = count * width;
+	std::size_t done = 0;
+
+	if (1 == width)
+		return;
+	if (2 != width && 4 != width && 8 != width)
+		throw std::runtime_error("swapWords: Unsupported word width " + std::to_string(width));
+
+#if defined(__SSE2__)
+	for (; done + 16 <= bytes; done += 16) {
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + done));
+		switch (width) {
+			case 2: v = swap16(v); break;
+			case 4: v = swap32(v); break;
+			default: v = swap64(v); break;
+		}
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(p + done), v);
+	}
+#endif
+
+	switch (width) {
+		case 2: swapScalar<std::uint16_t>(p + done, (bytes - done) / 2); break;
+		case 4: swapScalar<std::uint32_t>(p + done, (bytes - done) / 4); break;
+		default: swapScalar<std::uint64_t>(p + done, (bytes - done) / 8); break;
+	}
+}
+
+eEndian parseEndian(const std::string &order) {
+
+	if ("little" == order)
+		return LITTLE;
+	if ("big" == order)
+		return BIG;
+
+	throw std::runtime_error("Invalid byte order: " + order);
+}
+
+};
@@ -20,8 +20,8 @@
 
 namespace regmap { namespace i2c {
 
-I2C::I2C(unsigned char bus, unsigned char slave_addr, const std::string &defFile)
-: RegMapBase(defFile) {
+I2C::I2C(unsigned char bus, unsigned char slave_addr, const DefinitionRef &definition)
+: RegMapBase(definition) {
 
 	BackendFile_t file(new int(), &I2C::closeDeleter);
 	*file = open(std::string("/dev/i2c-" + std::to_string(bus)).c_str(), O_RDWR);
@@ -32,7 +32,7 @@ I2C::I2C(unsigned char bus, unsigned char slave_addr, const std::string &defFile
 		throw std::runtime_error("Could not access slave with address" + std::to_string(slave_addr));
 
 	m_oRegBackendI2CDev = RegBackendI2CDev(file, slave_addr);
-	m_oRegBackend = m_oRegBackendI2CDev;
+	this->setBackend(m_oRegBackendI2CDev);
 }
 
 void I2C::closeDeleter(int* fd) {
@@ -0,0 +1,273 @@
+/* This file is part of libregmap.
+ *
+ * libregmap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libregmap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libregmap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <thread>
+#include <stdexcept>
+#include <boost/property_tree/json_parser.hpp>
+#include "indirect.hpp"
+
+namespace regmap { namespace indirect {
+
+namespace {
+
+std::uint32_t number(const pt::ptree &node, const std::string &key, const std::string &def) {
+	return static_cast<std::uint32_t>(strtoul(node.get<std::string>(key, def).c_str(), NULL, 0));
+}
+
+unsigned int lowestBit(std::uint32_t mask) {
+	return mask ? __builtin_ctz(mask) : 0;
+}
+
+// polls answered without sleeping, most handshakes complete within a few
+// bus accesses
+const unsigned int SPIN_POLLS = 16;
+
+};
+
+Handshake Handshake::parse(const std::string &defFile) {
+
+	pt::ptree pTree;
+	try {
+		pt::read_json(defFile, pTree);
+	} catch (...) {
+		throw std::runtime_error("Definition file could not be parsed: " + defFile);
+	}
+
+	auto node = pTree.get_child_optional("handshake");
+	if (!node)
+		throw std::runtime_error("No handshake section in " + defFile);
+
+	Handshake handshake;
+	handshake.m_sCommand = node->get<std::string>("command", "");
+	handshake.m_sData = node->get<std::string>("data", handshake.m_sCommand);
+	handshake.m_uAddressMask = number(*node, "address_mask", "0");
+	handshake.m_uDataMask = number(*node, "data_mask", "0");
+	handshake.m_uReadFlag = number(*node, "read_flag", "0");
+	handshake.m_uWriteFlag = number(*node, "write_flag", "0");
+	handshake.m_uDoneMask = number(*node, "done_mask", "0");
+	handshake.m_uReadDone = number(*node, "read_done", "0");
+	handshake.m_uWriteDone = number(*node, "write_done", "0");
+	handshake.m_uTimeout = std::chrono::microseconds(number(*node, "timeout_us", "10000"));
+
+	if (handshake.m_sCommand.empty() || !handshake.m_uAddressMask || !handshake.m_uDataMask || !handshake.m_uDoneMask)
+		throw std::runtime_error("Handshake needs a command register, address, data and done masks: " + defFile);
+
+	return handshake;
+}
+
+RegBackendHandshake::RegBackendHandshake(IRegBackend &parent, const RegMapDefinition &parentDefinition, const Handshake &handshake)
+: m_pParent(&parent), m_oHandshake(handshake), m_pCounters(std::make_shared<Counters>()) {
+
+	auto slot = [&parentDefinition](const std::string &name) -> Slot {
+		const RegisterEntry *entry = parentDefinition.registers().find(name);
+		if (!entry)
+			throw std::runtime_error("No register found with name " + name);
+		if (entry->m_uSize != 1 && entry->m_uSize != 2 && entry->m_uSize != 4)
+			throw std::runtime_error("Invalid register size for " + name);
+		return Slot{entry->m_uOffset, entry->m_uSize};
+	};
+
+	m_oCommand = slot(handshake.m_sCommand);
+	m_oData = slot(handshake.m_sData);
+	m_bShared = m_oCommand.m_uOffset == m_oData.m_uOffset;
+	m_bAdjacent = !m_bShared && (m_oCommand.m_uOffset + m_oCommand.m_uSize == m_oData.m_uOffset
+		|| m_oData.m_uOffset + m_oData.m_uSize == m_oCommand.m_uOffset);
+
+	m_uAddressShift = lowestBit(handshake.m_uAddressMask);
+	m_uDataShift = lowestBit(handshake.m_uDataMask);
+	unsigned int bits = __builtin_popcount(handshake.m_uDataMask);
+	m_uWordBytes = bits <= 8 ? 1 : bits <= 16 ? 2 : 4;
+
+	m_pCounters->m_uHandshakes = 0;
+	m_pCounters->m_uParentAccesses = 0;
+}
+
+void RegBackendHandshake::read_many(const unsigned int *addresses, std::uint32_t *values, std::size_t count) {
+
+	for (std::size_t i = 0; i < count; i++) {
+		std::error_code error = this->transfer(addresses[i], values[i], false);
+		if (error)
+			throw std::system_error(error, "Handshake read of address " + std::to_string(addresses[i]) + " failed");
+	}
+}
+
+Statistics RegBackendHandshake::statistics() const {
+
+	if (!m_pCounters)
+		return Statistics{0, 0};
+
+	return Statistics{m_pCounters->m_uHandshakes.load(), m_pCounters->m_uParentAccesses.load()};
+}
+
+size_t RegBackendHandshake::size() const {
+
+	if (!m_pParent)
+		return 0;
+
+	return (m_oHandshake.m_uAddressMask >> m_uAddressShift) + m_uWordBytes;
+}
+
+void RegBackendHandshake::write(unsigned int offset, void* value, size_t size) {
+
+	std::error_code error = this->try_write(offset, value, size);
+	if (error == std::errc::result_out_of_range)
+		throwOutOfRange("RegBackendHandshake", offset);
+	if (error)
+		throw std::system_error(error, "Handshake write of address " + std::to_string(offset) + " failed");
+}
+
+void RegBackendHandshake::read(unsigned int offset, void* value, size_t size) {
+
+	std::error_code error = this->try_read(offset, value, size);
+	if (error == std::errc::result_out_of_range)
+		throwOutOfRange("RegBackendHandshake", offset);
+	if (error)
+		throw std::system_error(error, "Handshake read of address " + std::to_string(offset) + " failed");
+}
+
+unsigned int RegBackendHandshake::words(unsigned int offset, size_t size) const {
+
+	// registers wider than the data field span consecutive addresses
+	unsigned int words = (size + m_uWordBytes - 1) / m_uWordBytes;
+	std::uint64_t last = std::uint64_t(offset) + words - 1;
+	return (last << m_uAddressShift) & ~std::uint64_t(m_oHandshake.m_uAddressMask) ? 0 : words;
+}
+
+std::error_code RegBackendHandshake::try_write(unsigned int offset, void* value, size_t size) noexcept {
+
+	unsigned int words = this->words(offset, size);
+	if (!words || !m_pParent)
+		return std::make_error_code(std::errc::result_out_of_range);
+
+	for (unsigned int i = 0; i < words; i++) {
+		std::uint32_t word = 0;
+		memcpy(&word, static_cast<unsigned char*>(value) + i * m_uWordBytes, std::min<size_t>(m_uWordBytes, size - i * m_uWordBytes));
+		std::error_code error = this->transfer(offset + i, word, true);
+		if (error)
+			return error;
+	}
+	return std::error_code();
+}
+
+std::error_code RegBackendHandshake::try_read(unsigned int offset, void* value, size_t size) noexcept {
+
+	unsigned int words = this->words(offset, size);
+	if (!words || !m_pParent)
+		return std::make_error_code(std::errc::result_out_of_range);
+
+	for (unsigned int i = 0; i < words; i++) {
+		std::uint32_t word = 0;
+		std::error_code error = this->transfer(offset + i, word, false);
+		if (error)
+			return error;
+		memcpy(static_cast<unsigned char*>(value) + i * m_uWordBytes, &word, std::min<size_t>(m_uWordBytes, size - i * m_uWordBytes));
+	}
+	return std::error_code();
+}
+
+std::error_code RegBackendHandshake::transfer(unsigned int address, std::uint32_t &value, bool write) noexcept {
+
+	const Handshake &h = m_oHandshake;
+	std::uint32_t command = ((address << m_uAddressShift) & h.m_uAddressMask) | (write ? h.m_uWriteFlag : h.m_uReadFlag);
+	std::uint32_t data = (value << m_uDataShift) & h.m_uDataMask;
+	std::error_code error;
+
+	m_pCounters->m_uHandshakes++;
+	if (write && !m_bShared)
+		error = this->parentWrite(m_oData, data);
+	else if (write)
+		command |= data;
+
+	if (!error)
+		error = this->parentWrite(m_oCommand, command);
+	if (!error)
+		error = this->poll(write ? h.m_uWriteDone : h.m_uReadDone, command, data);
+	if (!error && !write)
+		value = (data & h.m_uDataMask) >> m_uDataShift;
+
+	return error;
+}
+
+std::error_code RegBackendHandshake::poll(std::uint32_t done, std::uint32_t &command, std::uint32_t &data) noexcept {
+
+	const Handshake &h = m_oHandshake;
+	auto deadline = std::chrono::steady_clock::now() + h.m_uTimeout;
+	std::chrono::microseconds pause(1);
+
+	for (unsigned int polls = 0; ; polls++) {
+
+		// the completion poll brings the data along: it is the command
+		// register itself, or read in the same parent transfer
+		std::error_code error;
+		if (m_bAdjacent) {
+			unsigned char both[8] = {0};
+			bool commandFirst = m_oCommand.m_uOffset < m_oData.m_uOffset;
+			unsigned int first = commandFirst ? m_oCommand.m_uOffset : m_oData.m_uOffset;
+			try {
+				m_pParent->copy_from_device(first, both, m_oCommand.m_uSize + m_oData.m_uSize);
+			} catch (...) {
+				error = std::make_error_code(std::errc::io_error);
+			}
+			m_pCounters->m_uParentAccesses++;
+
+			command = 0;
+			data = 0;
+			memcpy(&command, both + (commandFirst ? 0 : m_oData.m_uSize), m_oCommand.m_uSize);
+			memcpy(&data, both + (commandFirst ? m_oCommand.m_uSize : 0), m_oData.m_uSize);
+		} else {
+			error = this->parentRead(m_oCommand, command);
+			data = command;
+		}
+		if (error)
+			return error;
+
+		if ((command & h.m_uDoneMask) == done) {
+			if (!m_bShared && !m_bAdjacent)
+				return this->parentRead(m_oData, data);
+			return std::error_code();
+		}
+
+		// spin first, then back off exponentially up to the timeout
+		if (polls < SPIN_POLLS)
+			continue;
+		auto now = std::chrono::steady_clock::now();
+		if (now > deadline)
+			return std::make_error_code(std::errc::timed_out);
+		std::this_thread::sleep_for(std::min(pause, std::chrono::duration_cast<std::chrono::microseconds>(deadline - now)));
+		pause = std::min(pause * 2, std::chrono::microseconds(1000));
+	}
+}
+
+std::error_code RegBackendHandshake::parentRead(const Slot &slot, std::uint32_t &value) noexcept {
+
+	m_pCounters->m_uParentAccesses++;
+	switch (slot.m_uSize) {
+		case 1: { Result<std::uint8_t> r = m_pParent->try_get<std::uint8_t>(slot.m_uOffset); value = r.value_or(0); return r.error(); }
+		case 2: { Result<std::uint16_t> r = m_pParent->try_get<std::uint16_t>(slot.m_uOffset); value = r.value_or(0); return r.error(); }
+		default: { Result<std::uint32_t> r = m_pParent->try_get<std::uint32_t>(slot.m_uOffset); value = r.value_or(0); return r.error(); }
+	}
+}
+
+std::error_code RegBackendHandshake::parentWrite(const Slot &slot, std::uint32_t value) noexcept {
+
+	m_pCounters->m_uParentAccesses++;
+	switch (slot.m_uSize) {
+		case 1: return m_pParent->try_set<std::uint8_t>(slot.m_uOffset, value);
+		case 2: return m_pParent->try_set<std::uint16_t>(slot.m_uOffset, value);
+		default: return m_pParent->try_set<std::uint32_t>(slot.m_uOffset, value);
+	}
+}
+
+}};
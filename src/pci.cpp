@@ -17,84 +17,212 @@
 #include <stdexcept>
 #include <boost/filesystem.hpp>
 #include <boost/range/iterator_range.hpp>
+#include <algorithm>
 #include <sys/mman.h>
 #include "pci.hpp"
 
 namespace regmap { namespace pci {
 
-MemMapped::MemMapped(const PCI_ID &pciID, const std::string &defFile, const eBARs &bar, unsigned char instance)
-: RegMapBase(defFile), PCICommon(pciID) {
+MemMapped::MemMapped(const PCI_ID &pciID, const DefinitionRef &definition, const eBARs &bar, unsigned char instance, eMapping mapping)
+: RegMapBase(definition), PCICommon(pciID, instance) {
 
-	m_oRegBackendMemory = RegBackendMemory(PCICommon::memMapBar(bar), PCICommon::barSize(bar));
-	m_oRegBackend = m_oRegBackendMemory;
+	m_oRegBackendMemory = RegBackendMemory(PCICommon::memMapBar(bar, mapping), PCICommon::barSize(bar));
+	this->setBackend(m_oRegBackendMemory);
 }
 
-MemMapped::MemMapped(const BDF &bdf, const std::string &defFile, const eBARs &bar)
-: RegMapBase(defFile), PCICommon(bdf) {
+MemMapped::MemMapped(const BDF &bdf, const DefinitionRef &definition, const eBARs &bar, eMapping mapping)
+: RegMapBase(definition), PCICommon(bdf) {
 	
-	m_oRegBackendMemory = RegBackendMemory(PCICommon::memMapBar(bar), PCICommon::barSize(bar));
-	m_oRegBackend = m_oRegBackendMemory;
+	m_oRegBackendMemory = RegBackendMemory(PCICommon::memMapBar(bar, mapping), PCICommon::barSize(bar));
+	this->setBackend(m_oRegBackendMemory);
 }
 
-IOMapped::IOMapped(const PCI_ID &pciID, const std::string &defFile, const eBARs &bar, unsigned char instance)
-: RegMapBase(defFile), PCICommon(pciID) {
+void MemMapped::streamWrite(unsigned int offset, const void* data, std::size_t size) {
+
+	m_oRegBackend.stream(offset, data, size);
+}
+
+IOMapped::IOMapped(const PCI_ID &pciID, const DefinitionRef &definition, const eBARs &bar, unsigned char instance)
+: RegMapBase(definition), PCICommon(pciID, instance) {
 
 	m_oRegBackendFile = RegBackendFile(PCICommon::ioMapBar(bar), PCICommon::barSize(bar));
-	m_oRegBackend = m_oRegBackendFile;
+	this->setBackend(m_oRegBackendFile);
 }
 
-IOMapped::IOMapped(const BDF &bdf, const std::string &defFile, const eBARs &bar)
-: RegMapBase(defFile), PCICommon(bdf) {
+IOMapped::IOMapped(const BDF &bdf, const DefinitionRef &definition, const eBARs &bar)
+: RegMapBase(definition), PCICommon(bdf) {
 	
 	m_oRegBackendFile = RegBackendFile(PCICommon::ioMapBar(bar), PCICommon::barSize(bar));
-	m_oRegBackend = m_oRegBackendFile;
+	this->setBackend(m_oRegBackendFile);
 }
 
 
-PCICommon::PCICommon(const PCI_ID &pciID, unsigned char instance) {
+PCIEnumerator::PCIEnumerator(const std::string &sysfsRoot)
+: m_sSysFSRoot(sysfsRoot), m_bScanned(false) {
+
+	if (m_sSysFSRoot.empty() || m_sSysFSRoot.back() != '/')
+		m_sSysFSRoot += "/";
+}
+
+PCIEnumerator& PCIEnumerator::instance() {
+
+	static PCIEnumerator enumerator;
+	return enumerator;
+}
+
+void PCIEnumerator::refresh() {
+
+	std::lock_guard<std::mutex> lock(m_oMutex);
+	this->scan();
+}
+
+bool PCIEnumerator::find(const PCI_ID &pciID, unsigned int instance, PCIDevice &device) {
+
+	std::lock_guard<std::mutex> lock(m_oMutex);
+	this->ensureScanned();
+
+	auto it = m_oByID.find(idKey(pciID.m_uVendor, pciID.m_uDevice));
+	if (m_oByID.end() == it || 0 == instance || instance > it->second.size())
+		return false;
+
+	device = m_oDevices[it->second[instance - 1]];
+	return true;
+}
+
+bool PCIEnumerator::find(const BDF &bdf, PCIDevice &device, std::uint16_t domain) {
+
+	std::lock_guard<std::mutex> lock(m_oMutex);
+	this->ensureScanned();
+
+	auto it = m_oByBDF.find(bdfKey(domain, bdf));
+	if (m_oByBDF.end() == it)
+		return false;
+
+	device = m_oDevices[it->second];
+	return true;
+}
+
+std::vector<PCIDevice> PCIEnumerator::findByClass(std::uint32_t classCode, std::uint32_t mask) {
+
+	std::lock_guard<std::mutex> lock(m_oMutex);
+	this->ensureScanned();
+
+	std::vector<PCIDevice> devices;
+	for (auto &device : m_oDevices)
+		if ((device.m_uClass & mask) == (classCode & mask))
+			devices.push_back(device);
+
+	return devices;
+}
 
-	boost::filesystem::path p("/sys/bus/pci/devices/");
+std::vector<PCIDevice> PCIEnumerator::devices() {
 
-	for (auto &entry : boost::make_iterator_range(boost::filesystem::directory_iterator(p), {})) {
+	std::lock_guard<std::mutex> lock(m_oMutex);
+	this->ensureScanned();
 
-		boost::filesystem::path vendor(entry.path().string() + "/vendor");	
-		boost::filesystem::path device(entry.path().string() + "/device");	
+	return m_oDevices;
+}
+
+std::uint32_t PCIEnumerator::idKey(std::uint16_t vendor, std::uint16_t device) {
+
+	return (static_cast<std::uint32_t>(vendor) << 16) | device;
+}
+
+std::uint64_t PCIEnumerator::bdfKey(std::uint16_t domain, const BDF &bdf) {
+
+	return (static_cast<std::uint64_t>(domain) << 24) | (bdf.m_uBus << 16) | (bdf.m_uDevice << 8) | bdf.m_uFunction;
+}
 
-		auto comp = [](boost::filesystem::path path, std::uint16_t value) -> bool {
-			std::uint16_t file_value;
-			std::ifstream f(path.string(), std::fstream::in);
-			f >> std::hex >> file_value;
+void PCIEnumerator::ensureScanned() {
 
-			return file_value == value;
-		};
+	if (!m_bScanned)
+		this->scan();
+}
+
+void PCIEnumerator::scan() {
+
+	m_oDevices.clear();
+	m_oByID.clear();
+	m_oByBDF.clear();
+	m_bScanned = true;
+
+	boost::system::error_code ec;
+	boost::filesystem::directory_iterator dir(m_sSysFSRoot, ec);
+	if (ec)
+		return;
 
-		if (!boost::filesystem::is_regular_file(vendor) || !comp(vendor, pciID.m_uVendor))
+	auto readHex = [](const std::string &path, std::uint32_t &value) -> bool {
+		std::ifstream f(path, std::fstream::in);
+		return static_cast<bool>(f >> std::hex >> value);
+	};
+
+	for (auto &entry : boost::make_iterator_range(dir, {})) {
+
+		// entries are named domain:bus:device.function
+		unsigned int domain, bus, dev, function;
+		std::string name = entry.path().filename().string();
+		if (4 != sscanf(name.c_str(), "%x:%x:%x.%x", &domain, &bus, &dev, &function))
 			continue;
-		if (!boost::filesystem::is_regular_file(device) || !comp(device, pciID.m_uDevice))
-			continue;	
 
-		if (--instance > 0)
+		PCIDevice device;
+		std::uint32_t vendorID, deviceID;
+		device.m_sSysFSPath = m_sSysFSRoot + name + "/";
+		if (!readHex(device.m_sSysFSPath + "vendor", vendorID) || !readHex(device.m_sSysFSPath + "device", deviceID))
 			continue;
+		if (!readHex(device.m_sSysFSPath + "class", device.m_uClass))
+			device.m_uClass = 0;
+
+		device.m_uDomain = domain;
+		device.m_oBDF = BDF(bus, dev, function);
+		device.m_uVendor = vendorID;
+		device.m_uDevice = deviceID;
+		m_oDevices.push_back(device);
+	}
 
-		m_sSysFSPath = entry.path().string() + "/";
+	// instances are counted in bdf order, independent of the directory order
+	std::sort(m_oDevices.begin(), m_oDevices.end(), [](const PCIDevice &a, const PCIDevice &b) {
+		return bdfKey(a.m_uDomain, a.m_oBDF) < bdfKey(b.m_uDomain, b.m_oBDF);
+	});
+
+	for (std::size_t i = 0; i < m_oDevices.size(); i++) {
+		auto &device = m_oDevices[i];
+		auto &instances = m_oByID[idKey(device.m_uVendor, device.m_uDevice)];
+		instances.push_back(i);
+		device.m_uInstance = instances.size();
+		m_oByBDF[bdfKey(device.m_uDomain, device.m_oBDF)] = i;
 	}
+}
+
+PCICommon::PCICommon(const PCI_ID &pciID, unsigned char instance) {
 
-	if(!m_sSysFSPath.length())
-		throw std::runtime_error("Could not find PCI device with id " +
-					std::to_string(pciID.m_uVendor) + ":"
-					+ std::to_string(pciID.m_uDevice));
+	// the index may be outdated if the device showed up later
+	PCIDevice device;
+	PCIEnumerator &enumerator = PCIEnumerator::instance();
+	if (!enumerator.find(pciID, instance, device)) {
+		enumerator.refresh();
+		if (!enumerator.find(pciID, instance, device))
+			throw std::runtime_error("Could not find PCI device with id " +
+						std::to_string(pciID.m_uVendor) + ":"
+						+ std::to_string(pciID.m_uDevice));
+	}
+
+	m_sSysFSPath = device.m_sSysFSPath;
 }
 
 PCICommon::PCICommon(const BDF &bdf) {
 
-	char sBDF[20];
-	sprintf(sBDF, "0000:%0.2d:%0.2d.%d", bdf.m_uBus, bdf.m_uDevice, bdf.m_uFunction);
-	boost::filesystem::path p("/sys/bus/pci/devices/" + std::string(sBDF));
-
-	if (!boost::filesystem::is_directory(p))
-		throw std::runtime_error("SysyFS path does not exist for bdf " + std::string(sBDF));
+	PCIDevice device;
+	PCIEnumerator &enumerator = PCIEnumerator::instance();
+	if (!enumerator.find(bdf, device)) {
+		enumerator.refresh();
+		if (!enumerator.find(bdf, device)) {
+			char sBDF[20];
+			snprintf(sBDF, sizeof(sBDF), "0000:%02x:%02x.%x", bdf.m_uBus, bdf.m_uDevice, bdf.m_uFunction);
+			throw std::runtime_error("SysyFS path does not exist for bdf " + std::string(sBDF));
+		}
+	}
 
-	m_sSysFSPath = p.string() + "/";
+	m_sSysFSPath = device.m_sSysFSPath;
 }
 
 void PCICommon::munmapDeleter(void* addr, std::size_t length) {
@@ -141,6 +269,7 @@ void PCICommon::disableDevice() {
 void PCICommon::removeDevice() {
 
 	*PCICommon::sysfsEntry("remove", std::ios_base::out) << std::string("1");
+	PCIEnumerator::instance().refresh();
 }
 
 void PCICommon::rescanDevice() {
@@ -160,23 +289,45 @@ void PCICommon::rescanBus() {
 		throw std::runtime_error("Unable to rescan the pci bus");
 
 	f << std::string("1");
+	f.close();
+	PCIEnumerator::instance().refresh();
 }
 
 std::size_t PCICommon::barSize(const eBARs &bar) {
 	
 	boost::filesystem::path p(m_sSysFSPath + std::string("resource" + std::to_string(bar)));
 	if (!boost::filesystem::is_regular_file(p))
-		throw std::runtime_error("BAR does not exist: " + bar);
+		throw std::runtime_error("BAR does not exist: " + std::to_string(bar));
 
 	return boost::filesystem::file_size(p);
 
 }
 
-BackendMemory_t PCICommon::memMapBar(const eBARs &bar) {
+bool PCICommon::isPrefetchable(const eBARs &bar) {
+
+	// one line per resource: start, end and flags
+	auto resources = PCICommon::sysfsEntry("resource");
+	std::string start, end, flags;
+	for (int i = 0; i <= bar; i++)
+		if (!(*resources >> start >> end >> flags))
+			throw std::runtime_error("BAR does not exist: " + std::to_string(bar));
+
+	// IORESOURCE_PREFETCH
+	return strtoull(flags.c_str(), NULL, 16) & 0x2000;
+}
+
+BackendMemory_t PCICommon::memMapBar(const eBARs &bar, eMapping mapping) {
 
 	std::size_t uBarSize = PCICommon::barSize(bar);
 
-	int fd = open((m_sSysFSPath + std::string("resource") + std::to_string(bar)).c_str(), O_RDWR);
+	std::string resource = "resource" + std::to_string(bar);
+	if (WRITE_COMBINED == mapping) {
+		if (!PCICommon::isPrefetchable(bar))
+			throw std::runtime_error("Write combining needs a prefetchable BAR: bar" + std::to_string(bar));
+		resource += "_wc";
+	}
+
+	int fd = open((m_sSysFSPath + resource).c_str(), O_RDWR);
 	if (-1 == fd)
 		throw std::runtime_error("Unable to open bar" + std::to_string(bar));
 
@@ -0,0 +1,297 @@
+/* This file is part of libregmap.
+ *
+ * libregmap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libregmap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libregmap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstring>
+#include <stdexcept>
+#include <algorithm>
+#include <unordered_set>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "publish.hpp"
+
+namespace regmap {
+
+namespace {
+
+const std::uint32_t MAGIC = 0x52454750;	// "REGP"
+
+// Segment layout: the header, the values, one entry per register and the
+// names of the registers.
+struct Header {
+	std::atomic<std::uint32_t>	m_uMagic;
+	std::uint32_t			m_uCount;
+	std::uint32_t			m_uNames;
+	std::atomic<std::uint32_t>	m_uSequence;
+	std::atomic<std::int64_t>	m_iTimestamp;
+	std::atomic<std::uint64_t>	m_uGeneration;
+};
+
+struct Entry {
+	std::uint32_t	m_uName;
+	std::uint32_t	m_uNameLength;
+	std::uint32_t	m_uOffset;
+	std::uint32_t	m_uSize;
+};
+
+typedef std::atomic<std::uint32_t> Value_t;
+
+Header* header(void *segment) {
+	return static_cast<Header*>(segment);
+}
+
+Value_t* values(void *segment) {
+	return reinterpret_cast<Value_t*>(static_cast<unsigned char*>(segment) + sizeof(Header));
+}
+
+Entry* entries(void *segment, std::uint32_t count) {
+	return reinterpret_cast<Entry*>(values(segment) + count + (count & 1));
+}
+
+char* names(void *segment, std::uint32_t count) {
+	return reinterpret_cast<char*>(entries(segment, count) + count);
+}
+
+std::size_t segmentSize(std::uint32_t count, std::uint32_t nameBytes) {
+	return sizeof(Header) + sizeof(Value_t) * (count + (count & 1)) + sizeof(Entry) * count + nameBytes;
+}
+
+};
+
+Layout_t select(const Layout_t &layout, const std::vector<std::string> &names) {
+
+	std::unordered_set<std::string> wanted(names.begin(), names.end());
+	auto selected = std::make_shared<Layout>();
+	for (auto &info : *layout) {
+		if (wanted.erase(info.m_sName))
+			selected->push_back(info);
+	}
+
+	if (!wanted.empty())
+		throw std::runtime_error("No register found with name " + *wanted.begin());
+
+	return selected;
+}
+
+Publisher::Publisher(const std::string &path, const Layout_t &layout, IRegBackend &backend, unsigned int maxGap)
+: m_sPath(path), m_pLayout(layout), m_oBackend(backend), m_uMaxGap(maxGap), m_bStop(false), m_uErrors(0) {
+
+	std::uint32_t count = m_pLayout->size();
+	std::uint32_t nameBytes = 0;
+	for (auto &info : *m_pLayout)
+		nameBytes += info.m_sName.size();
+
+	// a new file, readers of a previous segment keep their mapping
+	unlink(path.c_str());
+	int fd = open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+	if (0 > fd)
+		throw std::runtime_error("Unable to create the segment " + path);
+
+	m_uSegmentSize = segmentSize(count, nameBytes);
+	if (0 > ftruncate(fd, m_uSegmentSize)) {
+		close(fd);
+		throw std::runtime_error("Unable to size the segment " + path);
+	}
+
+	m_pSegment = mmap(NULL, m_uSegmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (MAP_FAILED == m_pSegment)
+		throw std::runtime_error("Unable to map the segment " + path);
+
+	Header *h = header(m_pSegment);
+	h->m_uCount = count;
+	h->m_uNames = nameBytes;
+
+	Entry *e = entries(m_pSegment, count);
+	char *n = names(m_pSegment, count);
+	std::uint32_t pos = 0;
+	for (std::uint32_t i = 0; i < count; i++) {
+		auto &info = (*m_pLayout)[i];
+		e[i] = Entry{pos, static_cast<std::uint32_t>(info.m_sName.size()), info.m_uOffset, info.m_uSize};
+		memcpy(n + pos, info.m_sName.data(), info.m_sName.size());
+		pos += info.m_sName.size();
+	}
+
+	// subscribers only accept the segment once it is complete
+	h->m_uMagic.store(MAGIC, std::memory_order_release);
+}
+
+Publisher::~Publisher() {
+
+	this->stop();
+	munmap(m_pSegment, m_uSegmentSize);
+	unlink(m_sPath.c_str());
+}
+
+void Publisher::publish() {
+
+	std::lock_guard<std::mutex> lock(m_oPublishMutex);
+
+	// read outside of the write section, readers only wait for the copy
+	Snapshot snapshot = dump(m_pLayout, m_oBackend, m_uMaxGap);
+	std::int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(PublishClock_t::now().time_since_epoch()).count();
+
+	Header *h = header(m_pSegment);
+	Value_t *v = values(m_pSegment);
+	std::uint32_t sequence = h->m_uSequence.load(std::memory_order_relaxed);
+
+	h->m_uSequence.store(sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	for (std::size_t i = 0; i < snapshot.size(); i++)
+		v[i].store(snapshot.value(i), std::memory_order_relaxed);
+	h->m_iTimestamp.store(now, std::memory_order_relaxed);
+	h->m_uGeneration.store(h->m_uGeneration.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+	h->m_uSequence.store(sequence + 2, std::memory_order_release);
+}
+
+void Publisher::start(PublishClock_t::duration period) {
+
+	this->stop();
+	m_bStop = false;
+	m_oThread = std::thread(&Publisher::run, this, period);
+}
+
+void Publisher::stop() {
+
+	{
+		std::lock_guard<std::mutex> lock(m_oMutex);
+		m_bStop = true;
+	}
+	m_oStop.notify_all();
+
+	if (m_oThread.joinable())
+		m_oThread.join();
+}
+
+void Publisher::run(PublishClock_t::duration period) {
+
+	auto next = PublishClock_t::now();
+	std::unique_lock<std::mutex> lock(m_oMutex);
+	while (!m_bStop) {
+		lock.unlock();
+		try {
+			this->publish();
+		} catch (...) {
+			m_uErrors++;
+		}
+		lock.lock();
+
+		// fixed rate, periods missed on a slow bus are skipped
+		next += period;
+		auto now = PublishClock_t::now();
+		if (next < now)
+			next = now;
+		m_oStop.wait_until(lock, next, [this]() { return m_bStop; });
+	}
+}
+
+Subscriber::Subscriber(const std::string &path) {
+
+	int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (0 > fd)
+		throw std::runtime_error("Unable to open the segment " + path);
+
+	struct stat st;
+	if (0 > fstat(fd, &st) || static_cast<std::size_t>(st.st_size) < sizeof(Header)) {
+		close(fd);
+		throw std::runtime_error("Not a register segment: " + path);
+	}
+
+	m_uSegmentSize = st.st_size;
+	m_pSegment = mmap(NULL, m_uSegmentSize, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (MAP_FAILED == m_pSegment)
+		throw std::runtime_error("Unable to map the segment " + path);
+
+	Header *h = header(m_pSegment);
+	if (MAGIC != h->m_uMagic.load(std::memory_order_acquire)
+		|| m_uSegmentSize < segmentSize(h->m_uCount, h->m_uNames)) {
+		munmap(m_pSegment, m_uSegmentSize);
+		throw std::runtime_error("Not a register segment: " + path);
+	}
+
+	auto layout = std::make_shared<Layout>();
+	Entry *e = entries(m_pSegment, h->m_uCount);
+	char *n = names(m_pSegment, h->m_uCount);
+	for (std::uint32_t i = 0; i < h->m_uCount; i++) {
+		if (e[i].m_uName + e[i].m_uNameLength > h->m_uNames) {
+			munmap(m_pSegment, m_uSegmentSize);
+			throw std::runtime_error("Corrupt register segment: " + path);
+		}
+		RegisterInfo info;
+		info.m_sName.assign(n + e[i].m_uName, e[i].m_uNameLength);
+		info.m_uOffset = e[i].m_uOffset;
+		info.m_uSize = e[i].m_uSize;
+		// published values are converted already
+		info.m_eEndian = HOST_ENDIAN;
+		info.m_bVolatile = false;
+		info.m_uTtl = 0;
+		layout->push_back(info);
+	}
+	m_pLayout = layout;
+}
+
+Subscriber::~Subscriber() {
+
+	munmap(m_pSegment, m_uSegmentSize);
+}
+
+std::size_t Subscriber::index(const std::string &name) const {
+
+	auto it = std::find_if(m_pLayout->begin(), m_pLayout->end(), [&name](const RegisterInfo &info) {
+		return info.m_sName == name;
+	});
+
+	if (m_pLayout->end() == it)
+		throw std::runtime_error("No register found with name " + name);
+
+	return it - m_pLayout->begin();
+}
+
+bool Subscriber::read(Sample &sample) const {
+
+	Header *h = header(m_pSegment);
+	Value_t *v = values(m_pSegment);
+	std::size_t count = m_pLayout->size();
+	sample.m_oValues.resize(count);
+
+	for (unsigned int spins = 0; ; spins++) {
+		std::uint32_t before = h->m_uSequence.load(std::memory_order_acquire);
+		if (!(before & 1)) {
+			for (std::size_t i = 0; i < count; i++)
+				sample.m_oValues[i] = v[i].load(std::memory_order_relaxed);
+			std::int64_t timestamp = h->m_iTimestamp.load(std::memory_order_relaxed);
+			std::uint64_t generation = h->m_uGeneration.load(std::memory_order_relaxed);
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (before == h->m_uSequence.load(std::memory_order_relaxed)) {
+				sample.m_tTimestamp = PublishClock_t::time_point(std::chrono::nanoseconds(timestamp));
+				sample.m_uGeneration = generation;
+				return generation != 0;
+			}
+		}
+
+		// the publisher may have died in the middle of an update
+		if (spins > (1u << 20))
+			throw std::runtime_error("Register segment is not consistent, the publisher stalled");
+		if (spins > 64)
+			std::this_thread::yield();
+	}
+}
+
+};
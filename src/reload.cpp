@@ -0,0 +1,151 @@
+/* This file is part of libregmap.
+ *
+ * libregmap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libregmap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libregmap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdexcept>
+#include <cstring>
+#include <climits>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <boost/filesystem.hpp>
+#include "reload.hpp"
+
+namespace regmap {
+
+DefinitionCell::DefinitionCell(const Definition_t &definition)
+: m_uPhase(0), m_pCurrent(new Definition_t(definition)), m_uReloads(0) {
+
+	if (!definition)
+		throw std::runtime_error("No register map definition given");
+
+	m_aReaders[0].m_uCount = 0;
+	m_aReaders[1].m_uCount = 0;
+}
+
+DefinitionCell::~DefinitionCell() {
+
+	delete m_pCurrent.load();
+}
+
+void DefinitionCell::publish(const Definition_t &definition) {
+
+	if (!definition)
+		throw std::runtime_error("No register map definition given");
+
+	std::lock_guard<std::mutex> lock(m_oPublishMutex);
+	const Definition_t *previous = m_pCurrent.exchange(new Definition_t(definition));
+	this->synchronize();
+	delete previous;
+	m_uReloads++;
+}
+
+// Waits until every reader that may still use the previous definition is
+// gone. Readers count themselves in the phase they saw on entry, new ones
+// go to the other phase after the flip. Both phases are drained in turn,
+// so a steady stream of new readers never holds up the writer.
+void DefinitionCell::synchronize() {
+
+	for (int i = 0; i < 2; i++) {
+		unsigned int phase = m_uPhase.load();
+		m_uPhase.store(phase ^ 1);
+		while (m_aReaders[phase].m_uCount.load())
+			std::this_thread::yield();
+	}
+}
+
+Definition_t DefinitionCell::reload(const std::string &defFile, std::size_t size) {
+
+	// parsed directly, the cache of RegMapDefinition::load only notices
+	// modifications a second apart
+	Definition_t definition = std::make_shared<const RegMapDefinition>(defFile);
+	definition->check(size);
+
+	this->publish(definition);
+	return definition;
+}
+
+DefinitionWatcher::DefinitionWatcher(const std::string &defFile, const std::function<void()> &changed)
+: m_oChanged(changed), m_bStop(false) {
+
+	boost::system::error_code ec;
+	boost::filesystem::path path = boost::filesystem::canonical(defFile, ec);
+	if (ec)
+		throw std::runtime_error("Definition file not found: " + defFile);
+	m_sFile = path.filename().string();
+
+	// editors replace the file, watch its directory instead of the inode
+	m_iInotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (0 > m_iInotify)
+		throw std::runtime_error("Unable to initialize inotify");
+
+	if (0 > inotify_add_watch(m_iInotify, path.parent_path().c_str(), IN_CLOSE_WRITE | IN_MOVED_TO)) {
+		close(m_iInotify);
+		throw std::runtime_error("Unable to watch " + path.parent_path().string());
+	}
+
+	if (0 > pipe2(m_aWake, O_CLOEXEC | O_NONBLOCK)) {
+		close(m_iInotify);
+		throw std::runtime_error("Unable to create the wakeup pipe");
+	}
+
+	m_oThread = std::thread(&DefinitionWatcher::run, this);
+}
+
+DefinitionWatcher::~DefinitionWatcher() {
+
+	m_bStop = true;
+	char wake = 0;
+	if (::write(m_aWake[1], &wake, 1)) {}
+	m_oThread.join();
+
+	close(m_aWake[0]);
+	close(m_aWake[1]);
+	close(m_iInotify);
+}
+
+void DefinitionWatcher::run() {
+
+	alignas(inotify_event) char buffer[16 * (sizeof(inotify_event) + NAME_MAX + 1)];
+	pollfd fds[2] = { pollfd{m_aWake[0], POLLIN, 0}, pollfd{m_iInotify, POLLIN, 0} };
+
+	while (!m_bStop) {
+
+		if (0 > poll(fds, 2, -1))
+			continue;
+
+		if (!(fds[1].revents & POLLIN))
+			continue;
+
+		// several events of one save are handled by a single reload
+		bool changed = false;
+		ssize_t length;
+		while (0 < (length = ::read(m_iInotify, buffer, sizeof(buffer)))) {
+			for (char *p = buffer; p < buffer + length; ) {
+				const inotify_event *event = reinterpret_cast<const inotify_event*>(p);
+				if (event->len && m_sFile == event->name)
+					changed = true;
+				p += sizeof(inotify_event) + event->len;
+			}
+		}
+
+		if (changed && !m_bStop)
+			m_oChanged();
+	}
+}
+
+};
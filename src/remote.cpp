@@ -0,0 +1,611 @@
+/* This file is part of libregmap.
+ *
+ * libregmap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libregmap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libregmap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "remote.hpp"
+
+namespace regmap { namespace remote {
+
+namespace {
+
+// answer of the daemon to the name a client sends on connecting
+struct Hello {
+	std::int32_t	m_iError;
+	std::uint32_t	m_uReserved;
+	std::uint64_t	m_uSize;
+};
+
+sockaddr_un address(const std::string &socketPath) {
+
+	sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	if (socketPath.size() >= sizeof(addr.sun_path))
+		throw std::runtime_error("Socket path too long: " + socketPath);
+
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1);
+	return addr;
+}
+
+bool sendAll(int fd, const void *data, std::size_t size) {
+
+	const char *p = static_cast<const char*>(data);
+	while (size) {
+		ssize_t sent = ::send(fd, p, size, MSG_NOSIGNAL);
+		if (sent < 0 && errno == EINTR)
+			continue;
+		if (sent <= 0)
+			return false;
+		p += sent;
+		size -= sent;
+	}
+	return true;
+}
+
+bool recvAll(int fd, void *data, std::size_t size) {
+
+	char *p = static_cast<char*>(data);
+	while (size) {
+		ssize_t got = ::recv(fd, p, size, 0);
+		if (got < 0 && errno == EINTR)
+			continue;
+		if (got <= 0)
+			return false;
+		p += got;
+		size -= got;
+	}
+	return true;
+}
+
+// clients that don't complete their handshake in time are dropped
+const std::chrono::seconds HANDSHAKE_TIMEOUT(1);
+
+std::shared_ptr<Ring> mapRing(int fd) {
+
+	void *ring = mmap(NULL, sizeof(Ring), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (MAP_FAILED == ring)
+		return std::shared_ptr<Ring>();
+
+	return std::shared_ptr<Ring>(static_cast<Ring*>(ring), [](Ring *ring) { munmap(ring, sizeof(Ring)); });
+}
+
+template <class T>
+std::error_code access(IRegBackend &backend, const Op &op, std::uint64_t &value) {
+
+	if (op.m_uWrite)
+		return backend.try_set<T>(op.m_uOffset, static_cast<T>(op.m_uValue));
+
+	Result<T> result = backend.try_get<T>(op.m_uOffset);
+	value = result.value_or(0);
+	return result.error();
+}
+
+// register values travel as integers, so both sides agree on their byte order
+template <class T>
+std::uint64_t pack(const unsigned char *data) {
+	T value;
+	memcpy(&value, data, sizeof(T));
+	return value;
+}
+
+template <class T>
+void unpack(unsigned char *data, std::uint64_t value) {
+	T v = static_cast<T>(value);
+	memcpy(data, &v, sizeof(T));
+}
+
+};
+
+Server::Server(const std::string &socketPath, mode_t mode, gid_t group)
+: m_sSocketPath(socketPath), m_bStop(false), m_uBatches(0), m_uAccesses(0) {
+
+	sockaddr_un addr = address(socketPath);
+	m_iListen = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (0 > m_iListen)
+		throw std::runtime_error("Unable to create the socket " + socketPath);
+
+	unlink(socketPath.c_str());
+	if (0 > bind(m_iListen, reinterpret_cast<sockaddr*>(&addr), sizeof(addr))) {
+		close(m_iListen);
+		throw std::runtime_error("Unable to listen on " + socketPath);
+	}
+
+	// connecting needs write access, nobody can connect before listen()
+	if (0 > chmod(socketPath.c_str(), mode) || (static_cast<gid_t>(-1) != group && 0 > chown(socketPath.c_str(), -1, group))) {
+		close(m_iListen);
+		unlink(socketPath.c_str());
+		throw std::runtime_error("Unable to set the permissions of " + socketPath);
+	}
+
+	if (0 > listen(m_iListen, 16)) {
+		close(m_iListen);
+		unlink(socketPath.c_str());
+		throw std::runtime_error("Unable to listen on " + socketPath);
+	}
+
+	if (0 > pipe2(m_aWake, O_CLOEXEC | O_NONBLOCK)) {
+		close(m_iListen);
+		throw std::runtime_error("Unable to create the wakeup pipe");
+	}
+}
+
+Server::~Server() {
+
+	this->stop();
+	if (m_oThread.joinable())
+		m_oThread.join();
+
+	for (auto &client : m_oClients)
+		close(client.m_iSocket);
+
+	close(m_aWake[0]);
+	close(m_aWake[1]);
+	close(m_iListen);
+	unlink(m_sSocketPath.c_str());
+}
+
+void Server::add(const std::string &name, IRegBackend &backend) {
+
+	if (name.empty() || name.size() > 255)
+		throw std::runtime_error("Invalid register map name: " + name);
+
+	if (!m_oBackends.insert(std::make_pair(name, &backend)).second)
+		throw std::runtime_error("Register map already served: " + name);
+}
+
+void Server::start() {
+
+	m_oThread = std::thread(&Server::run, this);
+}
+
+void Server::stop() {
+
+	m_bStop = true;
+	char wake = 0;
+	if (::write(m_aWake[1], &wake, 1)) {}
+}
+
+void Server::run() {
+
+	std::vector<pollfd> fds;
+	while (!m_bStop) {
+
+		bool greeting = false;
+		fds.clear();
+		fds.push_back(pollfd{m_aWake[0], POLLIN, 0});
+		fds.push_back(pollfd{m_iListen, POLLIN, 0});
+		for (auto &client : m_oClients) {
+			fds.push_back(pollfd{client.m_iSocket, POLLIN, 0});
+			greeting |= !client.m_pRing;
+		}
+
+		// wake up to drop handshakes that stalled
+		int timeout = greeting ? static_cast<int>(std::chrono::milliseconds(HANDSHAKE_TIMEOUT).count()) : -1;
+		if (0 > poll(fds.data(), fds.size(), timeout)) {
+			if (errno == EINTR)
+				continue;
+			throw std::runtime_error("Polling the clients failed");
+		}
+
+		auto now = std::chrono::steady_clock::now();
+		// clients accepted below are not part of fds yet
+		for (std::size_t i = fds.size() - 2; i-- > 0; ) {
+			Client &client = m_oClients[i];
+			bool alive = true;
+			if (fds[i + 2].revents)
+				alive = client.m_pRing ? this->serve(client) : this->greet(client);
+			else if (!client.m_pRing)
+				alive = now - client.m_tAccepted < HANDSHAKE_TIMEOUT;
+
+			if (!alive) {
+				close(client.m_iSocket);
+				m_oClients.erase(m_oClients.begin() + i);
+			}
+		}
+
+		if (fds[1].revents & POLLIN)
+			this->accept();
+	}
+
+	char drain[16];
+	while (0 < ::read(m_aWake[0], drain, sizeof(drain)));
+	m_bStop = false;
+}
+
+void Server::accept() {
+
+	// the handshake is completed by the polling loop, a client that is slow
+	// to send its name does not hold up the others
+	int fd = accept4(m_iListen, NULL, NULL, SOCK_CLOEXEC | SOCK_NONBLOCK);
+	if (0 > fd)
+		return;
+
+	m_oClients.push_back(Client{fd, NULL, std::shared_ptr<Ring>(), std::string(), std::chrono::steady_clock::now()});
+}
+
+// collects the name of the map, answers once it is complete, returns false
+// to drop the client
+bool Server::greet(Client &client) {
+
+	char buffer[256];
+	ssize_t got = recv(client.m_iSocket, buffer, sizeof(buffer), MSG_DONTWAIT);
+	if (0 == got)
+		return false;
+	if (0 > got)
+		return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+
+	client.m_sHello.append(buffer, got);
+	std::size_t length = static_cast<unsigned char>(client.m_sHello[0]);
+	if (client.m_sHello.size() < 1 + length)
+		return true;
+	// nothing is sent before the answer
+	if (client.m_sHello.size() > 1 + length)
+		return false;
+
+	Hello hello = {0, 0, 0};
+	int memfd = -1;
+
+	auto it = m_oBackends.find(client.m_sHello.substr(1));
+	if (m_oBackends.end() == it) {
+		hello.m_iError = ENOENT;
+	} else {
+		client.m_pBackend = it->second;
+		hello.m_uSize = it->second->size();
+		memfd = memfd_create("regmapd", MFD_CLOEXEC);
+		if (0 > memfd || 0 > ftruncate(memfd, sizeof(Ring)) || !(client.m_pRing = mapRing(memfd)))
+			hello.m_iError = ENOMEM;
+	}
+
+	// the ring travels as file descriptor along with the answer
+	iovec iov = {&hello, sizeof(hello)};
+	char control[CMSG_SPACE(sizeof(int))];
+	msghdr msg;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+
+	if (!hello.m_iError) {
+		memset(control, 0, sizeof(control));
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof(control);
+		cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+		memcpy(CMSG_DATA(cmsg), &memfd, sizeof(int));
+	}
+
+	// the socket buffer of a fresh connection takes the answer at once
+	bool sent = sizeof(hello) == sendmsg(client.m_iSocket, &msg, MSG_NOSIGNAL);
+	if (0 <= memfd)
+		close(memfd);
+
+	client.m_sHello.clear();
+	if (!sent || hello.m_iError) {
+		client.m_pRing.reset();
+		return false;
+	}
+
+	return true;
+}
+
+bool Server::serve(Client &client) {
+
+	char doorbells[64];
+	ssize_t got = recv(client.m_iSocket, doorbells, sizeof(doorbells), MSG_DONTWAIT);
+	if (0 == got)
+		return false;
+	if (0 > got)
+		return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+
+	Ring &ring = *client.m_pRing;
+	std::uint32_t head = ring.m_uSubmitHead.load(std::memory_order_acquire);
+	std::uint32_t tail = ring.m_uSubmitTail.load(std::memory_order_relaxed);
+	if (head - tail > RING_SIZE)
+		return false;
+
+	for (; tail != head; tail++) {
+		Op op = ring.m_oSubmissions[tail % RING_SIZE];
+		ring.m_oCompletions[tail % RING_SIZE] = execute(*client.m_pBackend, op);
+	}
+
+	m_uAccesses += head - ring.m_uSubmitTail.load(std::memory_order_relaxed);
+	m_uBatches++;
+	ring.m_uSubmitTail.store(tail, std::memory_order_release);
+	ring.m_uCompleteHead.store(tail, std::memory_order_release);
+
+	// the socket stays non-blocking, a client that rings without reading
+	// its answers is dropped once they fill its buffer
+	char done = 0;
+	ssize_t sent;
+	do {
+		sent = ::send(client.m_iSocket, &done, 1, MSG_NOSIGNAL);
+	} while (0 > sent && errno == EINTR);
+	return 1 == sent;
+}
+
+Completion Server::execute(IRegBackend &backend, const Op &op) {
+
+	Completion completion = {0, 0, 0};
+	std::error_code error;
+
+	switch (op.m_uSize) {
+		case 1: error = access<std::uint8_t>(backend, op, completion.m_uValue); break;
+		case 2: error = access<std::uint16_t>(backend, op, completion.m_uValue); break;
+		case 4: error = access<std::uint32_t>(backend, op, completion.m_uValue); break;
+		case 8: error = access<std::uint64_t>(backend, op, completion.m_uValue); break;
+		default: error = std::make_error_code(std::errc::invalid_argument); break;
+	}
+
+	if (error) {
+		bool posix = error.category() == std::generic_category() || error.category() == std::system_category();
+		completion.m_iError = posix ? error.value() : EIO;
+	}
+
+	return completion;
+}
+
+// The client end of a daemon connection, shared by all copies of a backend
+class Connection {
+
+public:
+	Connection(const std::string &socketPath, const std::string &name)
+	: m_uRoundTrips(0) {
+
+		if (name.empty() || name.size() > 255)
+			throw std::runtime_error("Invalid register map name: " + name);
+
+		sockaddr_un addr = address(socketPath);
+		m_iSocket = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+		if (0 > m_iSocket)
+			throw std::runtime_error("Unable to create a socket for " + socketPath);
+
+		unsigned char length = name.size();
+		if (0 > connect(m_iSocket, reinterpret_cast<sockaddr*>(&addr), sizeof(addr))
+			|| !sendAll(m_iSocket, &length, 1) || !sendAll(m_iSocket, name.data(), length)) {
+			close(m_iSocket);
+			throw std::runtime_error("Unable to connect to regmapd at " + socketPath);
+		}
+
+		Hello hello = {EPROTO, 0, 0};
+		iovec iov = {&hello, sizeof(hello)};
+		char control[CMSG_SPACE(sizeof(int))];
+		msghdr msg;
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof(control);
+
+		int memfd = -1;
+		ssize_t got = recvmsg(m_iSocket, &msg, MSG_CMSG_CLOEXEC);
+		cmsghdr *cmsg = got == sizeof(hello) ? CMSG_FIRSTHDR(&msg) : NULL;
+		if (cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+			memcpy(&memfd, CMSG_DATA(cmsg), sizeof(int));
+
+		if (got == sizeof(hello) && 0 <= memfd && !hello.m_iError)
+			m_pRing = mapRing(memfd);
+		if (0 <= memfd)
+			close(memfd);
+
+		if (!m_pRing) {
+			close(m_iSocket);
+			if (got == sizeof(hello) && hello.m_iError == ENOENT)
+				throw std::runtime_error("regmapd does not serve a register map named " + name);
+			throw std::runtime_error("Handshake with regmapd at " + socketPath + " failed");
+		}
+
+		m_uSize = hello.m_uSize;
+	}
+
+	~Connection() {
+		close(m_iSocket);
+	}
+
+	void submit(const Op *ops, Completion *completions, std::size_t count) {
+
+		std::lock_guard<std::mutex> lock(m_oMutex);
+		Ring &ring = *m_pRing;
+
+		while (count) {
+			std::uint32_t head = ring.m_uSubmitHead.load(std::memory_order_relaxed);
+			std::uint32_t n = std::min<std::size_t>(count, RING_SIZE);
+			for (std::uint32_t i = 0; i < n; i++)
+				ring.m_oSubmissions[(head + i) % RING_SIZE] = ops[i];
+			ring.m_uSubmitHead.store(head + n, std::memory_order_release);
+
+			char doorbell = 0;
+			if (!sendAll(m_iSocket, &doorbell, 1) || !recvAll(m_iSocket, &doorbell, 1))
+				throw std::runtime_error("Connection to regmapd lost");
+			m_uRoundTrips++;
+
+			std::uint32_t tail = ring.m_uCompleteTail.load(std::memory_order_relaxed);
+			if (ring.m_uCompleteHead.load(std::memory_order_acquire) - tail != n)
+				throw std::runtime_error("regmapd completed an unexpected number of accesses");
+
+			for (std::uint32_t i = 0; i < n; i++)
+				completions[i] = ring.m_oCompletions[(tail + i) % RING_SIZE];
+			ring.m_uCompleteTail.store(tail + n, std::memory_order_release);
+
+			ops += n;
+			completions += n;
+			count -= n;
+		}
+	}
+
+	std::uint64_t		m_uSize;
+	std::atomic<std::uint64_t>	m_uRoundTrips;
+
+private:
+	std::mutex		m_oMutex;
+	int			m_iSocket;
+	std::shared_ptr<Ring>	m_pRing;
+};
+
+RegBackendRemote::RegBackendRemote(const std::string &socketPath, const std::string &name)
+: m_pConnection(std::make_shared<Connection>(socketPath, name)) {}
+
+size_t RegBackendRemote::size() const {
+
+	return m_pConnection ? m_pConnection->m_uSize : 0;
+}
+
+void RegBackendRemote::submit(const Op *ops, Completion *completions, std::size_t count) {
+
+	if (!m_pConnection)
+		throw std::runtime_error("RegBackendRemote: Not connected");
+
+	m_pConnection->submit(ops, completions, count);
+}
+
+std::uint64_t RegBackendRemote::roundTrips() const {
+
+	return m_pConnection ? m_pConnection->m_uRoundTrips.load() : 0;
+}
+
+void RegBackendRemote::copy_to_device(unsigned int offset, const void* src, size_t size) {
+
+	if (this->isIndirect())
+		return IRegBackend::copy_to_device(offset, src, size);
+
+	this->transfer(offset, static_cast<unsigned char*>(const_cast<void*>(src)), size, true);
+}
+
+void RegBackendRemote::copy_from_device(unsigned int offset, void* dst, size_t size) {
+
+	if (this->isIndirect())
+		return IRegBackend::copy_from_device(offset, dst, size);
+
+	this->transfer(offset, static_cast<unsigned char*>(dst), size, false);
+}
+
+void RegBackendRemote::write(unsigned int offset, void* value, size_t size) {
+
+	this->transfer(offset, static_cast<unsigned char*>(value), size, true);
+}
+
+void RegBackendRemote::read(unsigned int offset, void* value, size_t size) {
+
+	this->transfer(offset, static_cast<unsigned char*>(value), size, false);
+}
+
+void RegBackendRemote::transfer(unsigned int offset, unsigned char *data, size_t size, bool write) {
+
+	// single registers keep their width, longer ranges go in naturally
+	// aligned accesses of up to 8 bytes
+	std::vector<Op> ops;
+	for (size_t done = 0; done < size; ) {
+		unsigned int width = 8;
+		if (!(size == 1 || size == 2 || size == 4 || size == 8))
+			while (width > 1 && (((offset + done) & (width - 1)) || width > size - done))
+				width >>= 1;
+		else
+			width = size;
+
+		Op op = {static_cast<std::uint32_t>(offset + done), static_cast<std::uint8_t>(width), write, 0, 0};
+		if (write) {
+			switch (width) {
+				case 1: op.m_uValue = pack<std::uint8_t>(data + done); break;
+				case 2: op.m_uValue = pack<std::uint16_t>(data + done); break;
+				case 4: op.m_uValue = pack<std::uint32_t>(data + done); break;
+				default: op.m_uValue = pack<std::uint64_t>(data + done); break;
+			}
+		}
+		ops.push_back(op);
+		done += width;
+	}
+
+	std::vector<Completion> completions(ops.size());
+	this->submit(ops.data(), completions.data(), ops.size());
+
+	for (std::size_t i = 0; i < ops.size(); i++) {
+		if (completions[i].m_iError)
+			throw std::system_error(completions[i].m_iError, std::generic_category(),
+				"RegBackendRemote: Access at offset " + std::to_string(ops[i].m_uOffset) + " failed");
+		if (write)
+			continue;
+
+		unsigned char *dst = data + (ops[i].m_uOffset - offset);
+		switch (ops[i].m_uSize) {
+			case 1: unpack<std::uint8_t>(dst, completions[i].m_uValue); break;
+			case 2: unpack<std::uint16_t>(dst, completions[i].m_uValue); break;
+			case 4: unpack<std::uint32_t>(dst, completions[i].m_uValue); break;
+			default: unpack<std::uint64_t>(dst, completions[i].m_uValue); break;
+		}
+	}
+}
+
+std::size_t Batch::read(unsigned int offset, unsigned int size) {
+
+	Op op = {offset, static_cast<std::uint8_t>(size), 0, 0, 0};
+	m_oOps.push_back(op);
+	return m_oOps.size() - 1;
+}
+
+std::size_t Batch::write(unsigned int offset, std::uint64_t value, unsigned int size) {
+
+	Op op = {offset, static_cast<std::uint8_t>(size), 1, 0, value};
+	m_oOps.push_back(op);
+	return m_oOps.size() - 1;
+}
+
+void Batch::submit() {
+
+	m_oCompletions.assign(m_oOps.size(), Completion{0, 0, 0});
+	m_pBackend->submit(m_oOps.data(), m_oCompletions.data(), m_oOps.size());
+
+	for (std::size_t i = 0; i < m_oCompletions.size(); i++) {
+		if (m_oCompletions[i].m_iError)
+			throw std::system_error(m_oCompletions[i].m_iError, std::generic_category(),
+				"Batch: Access at offset " + std::to_string(m_oOps[i].m_uOffset) + " failed");
+	}
+}
+
+std::error_code Batch::error(std::size_t index) const {
+
+	if (index >= m_oCompletions.size())
+		throw std::out_of_range("Batch: No result for access " + std::to_string(index));
+
+	return std::error_code(m_oCompletions[index].m_iError, std::generic_category());
+}
+
+std::uint64_t Batch::value(std::size_t index) const {
+
+	if (index >= m_oCompletions.size())
+		throw std::out_of_range("Batch: No result for access " + std::to_string(index));
+
+	return m_oCompletions[index].m_uValue;
+}
+
+void Batch::clear() {
+
+	m_oOps.clear();
+	m_oCompletions.clear();
+}
+
+Remote::Remote(const std::string &socketPath, const std::string &name, const DefinitionRef &definition)
+: RegMapBase(definition) {
+
+	this->setBackend(RegBackendRemote(socketPath, name));
+}
+
+}};
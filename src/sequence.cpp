@@ -0,0 +1,411 @@
+/* This file is part of libregmap.
+ *
+ * libregmap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libregmap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libregmap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <cstring>
+#include <future>
+#include <stdexcept>
+#include <thread>
+#include <boost/property_tree/json_parser.hpp>
+#include "sequence.hpp"
+
+namespace regmap { namespace sequence {
+
+namespace {
+
+std::uint32_t number(const pt::ptree &node, const std::string &key, const std::string &def) {
+	return static_cast<std::uint32_t>(strtoul(node.get<std::string>(key, def).c_str(), NULL, 0));
+}
+
+unsigned int lowestBit(std::uint32_t mask) {
+	return mask ? __builtin_ctz(mask) : 0;
+}
+
+const char* describe(eStep type) {
+
+	switch (type) {
+		case WRITE: return "write";
+		case MODIFY: return "modify";
+		case WAIT_READY: return "wait_ready";
+		case WAIT_BUSY_CLEAR: return "wait_busy_clear";
+		default: return "delay";
+	}
+}
+
+std::uint32_t load(IRegBackend &backend, const Step &step) {
+
+	switch (step.m_uSize) {
+		case 1: return backend.get<std::uint8_t>(step.m_uOffset, step.m_eEndian);
+		case 2: return backend.get<std::uint16_t>(step.m_uOffset, step.m_eEndian);
+		default: return backend.get<std::uint32_t>(step.m_uOffset, step.m_eEndian);
+	}
+}
+
+void store(IRegBackend &backend, const Step &step, std::uint32_t value) {
+
+	switch (step.m_uSize) {
+		case 1: return backend.set<std::uint8_t>(step.m_uOffset, value, step.m_eEndian);
+		case 2: return backend.set<std::uint16_t>(step.m_uOffset, value, step.m_eEndian);
+		default: return backend.set<std::uint32_t>(step.m_uOffset, value, step.m_eEndian);
+	}
+}
+
+// appends the value in device byte order
+void encode(const Step &step, std::uint32_t value, std::vector<unsigned char> &dst) {
+
+	unsigned char bytes[sizeof(std::uint32_t)];
+	switch (step.m_uSize) {
+		case 1: { std::uint8_t v = value; memcpy(bytes, &v, 1); break; }
+		case 2: { std::uint16_t v = toDevice<std::uint16_t>(value, step.m_eEndian); memcpy(bytes, &v, 2); break; }
+		default: { std::uint32_t v = toDevice<std::uint32_t>(value, step.m_eEndian); memcpy(bytes, &v, 4); break; }
+	}
+	dst.insert(dst.end(), bytes, bytes + step.m_uSize);
+}
+
+// Executes the steps of one sequence. Writes are held back until a step
+// that is not a write to the next register follows or the burst is full.
+class Runner {
+
+public:
+	Runner(IRegBackend &backend, const Options &options, Report &report)
+	: m_oBackend(backend), m_oOptions(options), m_oReport(report), m_tStart(Clock_t::now()),
+	  m_bCoalesce(!backend.isIndirect() && !backend.mapping(0, 0)) {}
+
+	void step(const Step &step) {
+
+		if (WRITE == step.m_eType)
+			return this->write(step);
+
+		this->flush();
+		auto begin = Clock_t::now();
+		std::size_t transfer = m_oReport.m_uTransfers;
+		std::exception_ptr error;
+		try {
+			switch (step.m_eType) {
+				case MODIFY: {
+					std::uint32_t value = load(m_oBackend, step) & step.m_uAccessMask;
+					store(m_oBackend, step, ((value & ~step.m_uMask) | step.m_uValue) & step.m_uAccessMask);
+					break;
+				}
+				case WAIT_READY:
+				case WAIT_BUSY_CLEAR:
+					this->poll(step);
+					break;
+				default:
+					std::this_thread::sleep_for(step.m_uTime);
+					break;
+			}
+		} catch (...) {
+			error = std::current_exception();
+		}
+
+		this->record(step, begin, transfer);
+		if (MODIFY == step.m_eType)
+			m_oReport.m_uTransfers += 2;
+		if (error)
+			std::rethrow_exception(error);
+	}
+
+	void flush() {
+
+		if (m_oBurst.empty())
+			return;
+
+		auto begin = Clock_t::now();
+		std::exception_ptr error;
+		try {
+			if (1 == m_oBurstSteps.size())
+				store(m_oBackend, *m_oBurstSteps.front(), m_oBurstSteps.front()->m_uValue & m_oBurstSteps.front()->m_uAccessMask);
+			else
+				m_oBackend.copy_to_device(m_oBurstSteps.front()->m_uOffset, m_oBurst.data(), m_oBurst.size());
+		} catch (...) {
+			error = std::current_exception();
+		}
+
+		for (auto step : m_oBurstSteps)
+			this->record(*step, begin, m_oReport.m_uTransfers);
+		m_oReport.m_uTransfers++;
+		m_oBurst.clear();
+		m_oBurstSteps.clear();
+
+		if (error)
+			std::rethrow_exception(error);
+	}
+
+private:
+	void write(const Step &step) {
+
+		// indirect backends have no transfers of several registers, mapped
+		// ones would copy with a wider access than the registers have
+		bool adjacent = !m_oBurstSteps.empty() && m_bCoalesce
+			&& m_oBurstSteps.front()->m_uOffset + m_oBurst.size() == step.m_uOffset
+			&& (!m_oOptions.m_uMaxBurst || m_oBurst.size() + step.m_uSize <= m_oOptions.m_uMaxBurst);
+		if (!adjacent)
+			this->flush();
+
+		encode(step, step.m_uValue & step.m_uAccessMask, m_oBurst);
+		m_oBurstSteps.push_back(&step);
+	}
+
+	// both masks behave like RegisterBase::wait() and work()
+	void poll(const Step &step) {
+
+		auto deadline = Clock_t::now() + step.m_uTime;
+		for (;;) {
+			std::uint32_t value = load(m_oBackend, step) & step.m_uAccessMask;
+			m_oReport.m_uTransfers++;
+			if (((value & step.m_uMask) == step.m_uMask) == (WAIT_READY == step.m_eType))
+				return;
+
+			if (step.m_uTime.count() && Clock_t::now() >= deadline)
+				throw std::runtime_error("Timeout in " + std::string(describe(step.m_eType)) + " of " + step.m_sName);
+
+			if (m_oOptions.m_uPollInterval.count())
+				std::this_thread::sleep_for(m_oOptions.m_uPollInterval);
+			else
+				std::this_thread::yield();
+		}
+	}
+
+	void record(const Step &step, Clock_t::time_point begin, std::size_t transfer) {
+		m_oReport.m_oSteps.push_back(StepTiming{step.m_sName, step.m_eType, begin - m_tStart, Clock_t::now() - begin, transfer});
+	}
+
+	IRegBackend			&m_oBackend;
+	const Options			&m_oOptions;
+	Report				&m_oReport;
+	Clock_t::time_point		m_tStart;
+	bool				m_bCoalesce;
+	std::vector<unsigned char>	m_oBurst;
+	std::vector<const Step*>	m_oBurstSteps;
+};
+
+};
+
+Sequence Sequence::parse(const RegMapDefinition &definition, const std::string &name) {
+
+	const std::string &defFile = definition.file();
+	pt::ptree pTree;
+	try {
+		pt::read_json(defFile, pTree);
+	} catch (...) {
+		throw std::runtime_error("Definition file could not be parsed: " + defFile);
+	}
+
+	auto node = pTree.get_child_optional(pt::ptree::path_type("sequences/" + name, '/'));
+	if (!node)
+		throw std::runtime_error("No sequence found with name " + name + " in " + defFile);
+
+	auto entry = [&definition](const std::string &reg) -> const RegisterEntry& {
+		const RegisterEntry *entry = definition.registers().find(reg);
+		if (!entry)
+			throw std::runtime_error("No register found with name " + reg);
+		if (entry->m_uSize != 1 && entry->m_uSize != 2 && entry->m_uSize != 4)
+			throw std::runtime_error("Invalid register size for " + reg);
+		return *entry;
+	};
+
+	Sequence sequence;
+	sequence.m_sName = name;
+	for (auto &item : *node) {
+
+		const pt::ptree &config = item.second;
+		Step step = Step();
+		step.m_uTime = std::chrono::microseconds(number(config, "timeout_us", "100000"));
+
+		std::string reg;
+		if (config.count("write")) {
+			step.m_eType = WRITE;
+			reg = config.get<std::string>("write");
+		} else if (config.count("modify")) {
+			step.m_eType = MODIFY;
+			reg = config.get<std::string>("modify");
+		} else if (config.count("wait_ready")) {
+			step.m_eType = WAIT_READY;
+			reg = config.get<std::string>("wait_ready");
+		} else if (config.count("wait_busy_clear")) {
+			step.m_eType = WAIT_BUSY_CLEAR;
+			reg = config.get<std::string>("wait_busy_clear");
+		} else if (config.count("delay_us")) {
+			step.m_eType = DELAY;
+			step.m_sName = "delay";
+			step.m_uTime = std::chrono::microseconds(number(config, "delay_us", "0"));
+			sequence.m_oSteps.push_back(step);
+			continue;
+		} else {
+			throw std::runtime_error("Unknown step " + std::to_string(sequence.m_oSteps.size()) + " in sequence " + name);
+		}
+
+		const RegisterEntry &info = entry(reg);
+		step.m_sName = reg;
+		step.m_uOffset = info.m_uOffset;
+		step.m_uSize = info.m_uSize;
+		step.m_eEndian = info.m_eEndian;
+		step.m_uAccessMask = info.m_uAccessMask;
+		step.m_uValue = number(config, "value", "0");
+
+		switch (step.m_eType) {
+			case MODIFY: {
+				std::string field = config.get<std::string>("field", "");
+				const BitmaskTable &bitmasks = info.m_pBitmasks ? *info.m_pBitmasks : BitmaskTable::none();
+				auto it = bitmasks.find(field);
+				if (bitmasks.end() == it)
+					throw std::runtime_error("Bitmap not defined: " + reg + "." + field);
+
+				step.m_sName += "." + field;
+				step.m_uMask = it->m_uMask;
+				std::uint64_t value = static_cast<std::uint64_t>(step.m_uValue) << lowestBit(step.m_uMask);
+				if (value & ~static_cast<std::uint64_t>(step.m_uMask))
+					throw std::runtime_error("Value does not fit into " + step.m_sName + " in sequence " + name);
+				step.m_uValue = static_cast<std::uint32_t>(value);
+				break;
+			}
+			case WAIT_READY:
+				step.m_uMask = info.m_uReadyMask;
+				if (!step.m_uMask)
+					throw std::runtime_error("No ready mask set for register " + reg);
+				break;
+			case WAIT_BUSY_CLEAR:
+				step.m_uMask = info.m_uBusyMask;
+				if (!step.m_uMask)
+					throw std::runtime_error("No busy mask set for register " + reg);
+				break;
+			default:
+				break;
+		}
+
+		sequence.m_oSteps.push_back(step);
+	}
+
+	return sequence;
+}
+
+std::ostream& operator<<(std::ostream &os, const Report &report) {
+
+	os << report.m_sDevice << " " << report.m_sSequence << ": " << (report.ok() ? "done" : "failed")
+	   << " after " << std::chrono::duration_cast<std::chrono::microseconds>(report.m_uDuration).count()
+	   << "us, " << report.m_uTransfers << " transfers";
+
+	if (!report.ok()) {
+		try {
+			std::rethrow_exception(report.m_pError);
+		} catch (const std::exception &e) {
+			os << ", " << e.what();
+		} catch (...) {
+		}
+	}
+
+	for (auto &step : report.m_oSteps)
+		os << std::endl << "  +" << std::chrono::duration_cast<std::chrono::microseconds>(step.m_uStart).count()
+		   << "us " << describe(step.m_eType) << " " << step.m_sName << ": "
+		   << std::chrono::duration_cast<std::chrono::microseconds>(step.m_uDuration).count() << "us";
+
+	return os;
+}
+
+Report run(IRegBackend &backend, const Sequence &sequence, const Options &options) {
+
+	Report report;
+	report.m_sSequence = sequence.name();
+
+	auto start = Clock_t::now();
+	try {
+		Runner runner(backend, options, report);
+		for (auto &step : sequence.steps())
+			runner.step(step);
+		runner.flush();
+	} catch (...) {
+		report.m_pError = std::current_exception();
+	}
+
+	report.m_uDuration = Clock_t::now() - start;
+	return report;
+}
+
+std::size_t Engine::add(const std::string &device, IRegBackend &backend, const Sequence &sequence) {
+
+	Job job = {device, &backend, sequence, std::vector<std::size_t>()};
+	for (std::size_t i = m_oJobs.size(); i-- > 0;) {
+		if (m_oJobs[i].m_pBackend == &backend) {
+			job.m_oAfter.push_back(i);
+			break;
+		}
+	}
+
+	m_oJobs.push_back(job);
+	return m_oJobs.size() - 1;
+}
+
+void Engine::after(std::size_t job, std::size_t dependency) {
+
+	if (job >= m_oJobs.size() || dependency >= job)
+		throw std::out_of_range("Engine: a job can only wait for an earlier job");
+
+	m_oJobs[job].m_oAfter.push_back(dependency);
+}
+
+std::vector<Report> Engine::run() {
+
+	std::vector<Report> reports(m_oJobs.size());
+	std::vector<std::promise<bool> > done(m_oJobs.size());
+	std::vector<std::shared_future<bool> > finished;
+	for (auto &promise : done)
+		finished.push_back(promise.get_future().share());
+
+	auto start = Clock_t::now();
+	auto work = [&](std::size_t i) {
+		const Job &job = m_oJobs[i];
+		Report &report = reports[i];
+
+		bool ready = true;
+		for (auto dependency : job.m_oAfter)
+			ready = finished[dependency].get() && ready;
+
+		auto begin = Clock_t::now();
+		if (ready) {
+			report = regmap::sequence::run(*job.m_pBackend, job.m_oSequence, m_oOptions);
+		} else {
+			report.m_sSequence = job.m_oSequence.name();
+			report.m_pError = std::make_exception_ptr(std::runtime_error("Skipped, a sequence it waits for failed"));
+		}
+
+		report.m_sDevice = job.m_sDevice;
+		report.m_uStart = begin - start;
+		done[i].set_value(report.ok());
+	};
+
+	std::vector<std::thread> threads;
+	std::exception_ptr error;
+	for (std::size_t i = 0; i < m_oJobs.size(); i++) {
+		try {
+			threads.emplace_back(work, i);
+		} catch (...) {
+			// jobs without a thread count as failed, so no thread waits forever
+			error = std::current_exception();
+			for (; i < m_oJobs.size(); i++)
+				done[i].set_value(false);
+		}
+	}
+
+	for (auto &thread : threads)
+		thread.join();
+
+	if (error)
+		std::rethrow_exception(error);
+	return reports;
+}
+
+}};
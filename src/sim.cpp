@@ -0,0 +1,318 @@
+/* This file is part of libregmap.
+ *
+ * libregmap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libregmap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libregmap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdexcept>
+#include <thread>
+#include <algorithm>
+#include "sim.hpp"
+
+namespace regmap { namespace sim {
+
+Duration_t LatencyModel::cost(std::size_t bytes, bool read) const {
+
+	return m_uPerAccess + m_uPerByte * bytes + (read ? m_uReadTurnaround : Duration_t(0));
+}
+
+LatencyModel LatencyModel::i2c(unsigned int sclHz) {
+
+	if (0 == sclHz)
+		throw std::runtime_error("LatencyModel: i2c clock must not be zero");
+
+	// every byte takes 8 data bits plus ACK, start and stop condition take
+	// about one clock each. Each transaction carries the slave and register
+	// address, reads add a repeated start and the slave address again.
+	Duration_t bit(1000000000ull / sclHz);
+	return LatencyModel(bit * (2 * 9 + 2), bit * 9, bit * (9 + 1));
+}
+
+LatencyModel LatencyModel::pcieMMIO() {
+
+	// writes are posted, reads wait for the completion
+	return LatencyModel(std::chrono::nanoseconds(100), Duration_t(0), std::chrono::nanoseconds(900));
+}
+
+LatencyModel LatencyModel::sysfs() {
+
+	// lseek + read/write syscall pair on a resource file
+	return LatencyModel(std::chrono::nanoseconds(1500), Duration_t(0), Duration_t(0));
+}
+
+Duration_t Statistics::averageLatency() const {
+
+	std::uint64_t accesses = m_uReads + m_uWrites;
+	return accesses ? Duration_t(m_uBusTime.count() / accesses) : Duration_t(0);
+}
+
+double Statistics::throughput() const {
+
+	if (!m_uBusTime.count())
+		return 0.0;
+
+	return static_cast<double>(m_uBytesRead + m_uBytesWritten) * 1e9 / static_cast<double>(m_uBusTime.count());
+}
+
+RegBackendSim::RegBackendSim(std::size_t size, const LatencyModel &latency, bool realtime)
+: m_pState(std::make_shared<State>()) {
+
+	m_pState->m_oMemory.resize(size, 0);
+	m_pState->m_oLatency = latency;
+	m_pState->m_bRealtime = realtime;
+}
+
+void RegBackendSim::addBehaviour(const Behaviour &behaviour) {
+
+	if (behaviour.m_uSize == 0 || behaviour.m_uSize > sizeof(std::uint32_t))
+		throw std::runtime_error("RegBackendSim: Unsupported register size for behaviour at offset " + std::to_string(behaviour.m_uOffset));
+
+	if (behaviour.m_eType == FREE_RUNNING && behaviour.m_uDelay.count() <= 0)
+		throw std::runtime_error("RegBackendSim: Free running counter needs a period at offset " + std::to_string(behaviour.m_uOffset));
+
+	std::lock_guard<std::mutex> lock(m_pState->m_oMutex);
+	if (behaviour.m_uOffset + behaviour.m_uSize > m_pState->m_oMemory.size())
+		throw std::out_of_range("RegBackendSim: Behaviour offset is out of range: " + std::to_string(behaviour.m_uOffset));
+
+	m_pState->m_oBehaviours.push_back(behaviour);
+	m_pState->m_oCounterBase.push_back(Clock_t::now());
+}
+
+Statistics RegBackendSim::statistics() const {
+
+	std::lock_guard<std::mutex> lock(m_pState->m_oMutex);
+	return m_pState->m_oStatistics;
+}
+
+void RegBackendSim::resetStatistics() {
+
+	std::lock_guard<std::mutex> lock(m_pState->m_oMutex);
+	m_pState->m_oStatistics = Statistics();
+}
+
+const LatencyModel& RegBackendSim::latency() const {
+
+	return m_pState->m_oLatency;
+}
+
+void RegBackendSim::setLatency(const LatencyModel &latency) {
+
+	std::lock_guard<std::mutex> lock(m_pState->m_oMutex);
+	m_pState->m_oLatency = latency;
+}
+
+size_t RegBackendSim::size() const {
+
+	return m_pState ? m_pState->m_oMemory.size() : 0;
+}
+
+void RegBackendSim::write(unsigned int offset, void* value, size_t size) {
+
+	Duration_t latency;
+	{
+		std::lock_guard<std::mutex> lock(m_pState->m_oMutex);
+		if (offset + size > m_pState->m_oMemory.size())
+			throw std::out_of_range("RegBackendSim: Given offset is out of range: " + std::to_string(offset));
+
+		auto now = Clock_t::now();
+		this->settle(now);
+		memcpy(&m_pState->m_oMemory[offset], value, size);
+
+		for (auto &behaviour : m_pState->m_oBehaviours) {
+			if (!overlaps(behaviour, offset, size))
+				continue;
+
+			std::uint32_t written = this->load(behaviour.m_uOffset, behaviour.m_uSize);
+			Pending pending = { now + behaviour.m_uDelay, behaviour.m_uOffset, behaviour.m_uSize, 0, 0 };
+
+			switch (behaviour.m_eType) {
+				case SELF_CLEAR:
+				if (written & behaviour.m_uMask) {
+					pending.m_uClear = written & behaviour.m_uMask;
+					m_pState->m_oPending.push_back(pending);
+				}
+				break;
+
+				case SET_AFTER:
+				if (!behaviour.m_uTrigger || (written & behaviour.m_uTrigger)) {
+					this->store(behaviour.m_uOffset, behaviour.m_uSize, written & ~behaviour.m_uMask);
+					pending.m_uSet = behaviour.m_uMask;
+					m_pState->m_oPending.push_back(pending);
+				}
+				break;
+
+				default:
+				break;
+			}
+		}
+
+		this->settle(now);
+		this->account(size, false);
+		latency = m_pState->m_oLatency.cost(size, false);
+	}
+
+	if (m_pState->m_bRealtime)
+		this->delay(latency);
+}
+
+void RegBackendSim::read(unsigned int offset, void* value, size_t size) {
+
+	Duration_t latency;
+	{
+		std::lock_guard<std::mutex> lock(m_pState->m_oMutex);
+		if (offset + size > m_pState->m_oMemory.size())
+			throw std::out_of_range("RegBackendSim: Given offset is out of range: " + std::to_string(offset));
+
+		this->settle(Clock_t::now());
+		memcpy(value, &m_pState->m_oMemory[offset], size);
+
+		for (auto &behaviour : m_pState->m_oBehaviours) {
+			if (behaviour.m_eType == CLEAR_ON_READ && overlaps(behaviour, offset, size))
+				this->store(behaviour.m_uOffset, behaviour.m_uSize, this->load(behaviour.m_uOffset, behaviour.m_uSize) & ~behaviour.m_uMask);
+		}
+
+		this->account(size, true);
+		latency = m_pState->m_oLatency.cost(size, true);
+	}
+
+	if (m_pState->m_bRealtime)
+		this->delay(latency);
+}
+
+void RegBackendSim::settle(Clock_t::time_point now) {
+
+	auto &pending = m_pState->m_oPending;
+	std::stable_sort(pending.begin(), pending.end(), [](const Pending &a, const Pending &b) {
+		return a.m_tDue < b.m_tDue;
+	});
+
+	auto it = pending.begin();
+	for (; it != pending.end() && it->m_tDue <= now; ++it) {
+		std::uint32_t value = this->load(it->m_uOffset, it->m_uSize);
+		this->store(it->m_uOffset, it->m_uSize, (value & ~it->m_uClear) | it->m_uSet);
+	}
+	pending.erase(pending.begin(), it);
+
+	// free running counters advance by whole periods only
+	for (std::size_t i = 0; i < m_pState->m_oBehaviours.size(); i++) {
+		auto &behaviour = m_pState->m_oBehaviours[i];
+		if (behaviour.m_eType != FREE_RUNNING)
+			continue;
+
+		auto &base = m_pState->m_oCounterBase[i];
+		auto ticks = (now - base) / behaviour.m_uDelay;
+		if (ticks <= 0)
+			continue;
+
+		base += behaviour.m_uDelay * ticks;
+		std::uint32_t value = this->load(behaviour.m_uOffset, behaviour.m_uSize);
+		this->store(behaviour.m_uOffset, behaviour.m_uSize, value + behaviour.m_uMask * static_cast<std::uint32_t>(ticks));
+	}
+}
+
+void RegBackendSim::account(std::size_t bytes, bool read) {
+
+	auto &stats = m_pState->m_oStatistics;
+	Duration_t cost = m_pState->m_oLatency.cost(bytes, read);
+
+	if (read) {
+		stats.m_uReads++;
+		stats.m_uBytesRead += bytes;
+	} else {
+		stats.m_uWrites++;
+		stats.m_uBytesWritten += bytes;
+	}
+
+	stats.m_uBusTime += cost;
+	stats.m_uMinLatency = std::min(stats.m_uMinLatency, cost);
+	stats.m_uMaxLatency = std::max(stats.m_uMaxLatency, cost);
+}
+
+void RegBackendSim::delay(Duration_t latency) {
+
+	// sleeping is far too coarse for bus latencies, spin for short ones
+	auto until = Clock_t::now() + latency;
+	if (latency > std::chrono::microseconds(200))
+		std::this_thread::sleep_for(latency);
+
+	while (Clock_t::now() < until);
+}
+
+std::uint32_t RegBackendSim::load(unsigned int offset, std::size_t size) const {
+
+	std::uint32_t value = 0;
+	memcpy(&value, &m_pState->m_oMemory[offset], size);
+	return value;
+}
+
+void RegBackendSim::store(unsigned int offset, std::size_t size, std::uint32_t value) {
+
+	memcpy(&m_pState->m_oMemory[offset], &value, size);
+}
+
+bool RegBackendSim::overlaps(const Behaviour &behaviour, unsigned int offset, std::size_t size) {
+
+	return behaviour.m_uOffset < offset + size && offset < behaviour.m_uOffset + behaviour.m_uSize;
+}
+
+Simulator::Simulator(const DefinitionRef &definition, std::size_t size, const LatencyModel &latency, bool realtime)
+: RegMapBase(definition) {
+
+	this->setBackend(RegBackendSim(size, latency, realtime));
+	this->parseBehaviours(this->defFile());
+}
+
+void Simulator::parseBehaviours(const std::string &defFile) {
+
+	pt::ptree pTree;
+	try {
+		pt::read_json(defFile, pTree);
+	} catch (...) {
+		throw std::runtime_error("Definition file could not be parsed: " + defFile);
+	}
+
+	auto number = [](const pt::ptree &node, const std::string &key, const std::string &def) -> std::uint32_t {
+		return static_cast<std::uint32_t>(strtoul(node.get<std::string>(key, def).c_str(), NULL, 0));
+	};
+
+	for (auto &node : pTree.get_child("registers")) {
+
+		auto sim = node.second.get_child_optional("simulation");
+		if (!sim)
+			continue;
+
+		unsigned int offset = number(node.second, "offset", "0");
+		std::size_t size = number(node.second, "size", "0");
+
+		auto selfClear = sim->get_child_optional("self_clear");
+		if (selfClear)
+			m_oRegBackend.addBehaviour(Behaviour(SELF_CLEAR, offset, size, number(*selfClear, "mask", "0"),
+				std::chrono::microseconds(number(*selfClear, "delay_us", "0"))));
+
+		auto setAfter = sim->get_child_optional("set_after");
+		if (setAfter)
+			m_oRegBackend.addBehaviour(Behaviour(SET_AFTER, offset, size, number(*setAfter, "mask", "0"),
+				std::chrono::microseconds(number(*setAfter, "delay_us", "0")), number(*setAfter, "trigger", "0")));
+
+		auto clearOnRead = sim->get_optional<std::string>("clear_on_read");
+		if (clearOnRead)
+			m_oRegBackend.addBehaviour(Behaviour(CLEAR_ON_READ, offset, size, number(*sim, "clear_on_read", "0")));
+
+		auto freeRunning = sim->get_child_optional("free_running");
+		if (freeRunning)
+			m_oRegBackend.addBehaviour(Behaviour(FREE_RUNNING, offset, size, number(*freeRunning, "increment", "1"),
+				std::chrono::microseconds(number(*freeRunning, "period_us", "1"))));
+	}
+}
+
+}};
@@ -0,0 +1,244 @@
+/* This file is part of libregmap.
+ *
+ * libregmap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libregmap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libregmap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include "snapshot.hpp"
+
+namespace regmap {
+namespace pt = boost::property_tree;
+
+static void collect(const RegisterEntry &reg, const std::string &name, unsigned int base, Layout &layout) {
+
+	RegisterInfo info;
+	info.m_sName = name;
+	info.m_uOffset = base + reg.m_uOffset;
+	info.m_uSize = reg.m_uSize;
+	info.m_eEndian = reg.m_eEndian;
+	info.m_bVolatile = reg.m_bVolatile;
+	info.m_uTtl = reg.m_uTtl;
+	info.m_pBitmasks = reg.m_pBitmasks;
+	layout.push_back(info);
+}
+
+static void flatten(const RegisterBlock &block, const std::string &prefix, unsigned int base, Layout &layout) {
+
+	for (auto &reg : block.m_oRegisters)
+		collect(reg, prefix + reg.m_pName, base, layout);
+
+	for (auto &array : block.m_oArrays) {
+
+		const RegisterBlock &element = *array.second.m_pElement;
+		// arrays of single registers hold just the register named like the array
+		bool single = element.m_oArrays.empty() && element.m_oRegisters.size() == 1 &&
+				element.m_oRegisters.front().m_pName == array.first;
+
+		for (unsigned int i = 0; i < array.second.m_uCount; i++) {
+			std::string name = prefix + array.first + "[" + std::to_string(i) + "]";
+			unsigned int offset = base + array.second.m_uOffset + i * array.second.m_uStride;
+
+			if (single) {
+				std::size_t first = layout.size();
+				flatten(element, prefix, offset, layout);
+				layout[first].m_sName = name;
+			} else {
+				flatten(element, name + ".", offset, layout);
+			}
+		}
+	}
+}
+
+Layout_t flatten(const RegisterBlock &block) {
+
+	auto layout = std::make_shared<Layout>();
+	flatten(block, "", 0, *layout);
+
+	std::stable_sort(layout->begin(), layout->end(), [](const RegisterInfo &a, const RegisterInfo &b) {
+		return a.m_uOffset < b.m_uOffset;
+	});
+
+	return layout;
+}
+
+Snapshot::Snapshot(const Layout_t &layout, std::vector<std::uint32_t> values)
+: m_pLayout(layout), m_oValues(std::move(values)) {
+
+	if (!m_pLayout || m_pLayout->size() != m_oValues.size())
+		throw std::runtime_error("Snapshot does not match its layout");
+}
+
+std::uint32_t Snapshot::value(const std::string &name) const {
+
+	auto it = std::find_if(m_pLayout->begin(), m_pLayout->end(), [&name](const RegisterInfo &info) {
+		return info.m_sName == name;
+	});
+	if (m_pLayout->end() == it)
+		throw std::runtime_error("No register found with name " + name);
+
+	return m_oValues[it - m_pLayout->begin()];
+}
+
+void Snapshot::save(const std::string &file) const {
+
+	pt::ptree pTree;
+	for (std::size_t i = 0; i < m_oValues.size(); i++) {
+		std::ostringstream value;
+		value << "0x" << std::hex << m_oValues[i];
+		// register names contain dots, use another path separator
+		pTree.put(pt::ptree::path_type("registers/" + (*m_pLayout)[i].m_sName, '/'), value.str());
+	}
+
+	pt::write_json(file, pTree);
+}
+
+Snapshot Snapshot::load(const std::string &file, const Layout_t &layout) {
+
+	pt::ptree pTree;
+	try {
+		pt::read_json(file, pTree);
+	} catch (...) {
+		throw std::runtime_error("Snapshot could not be parsed: " + file);
+	}
+
+	std::vector<std::uint32_t> values;
+	values.reserve(layout->size());
+	for (auto &info : *layout) {
+		auto value = pTree.get_optional<std::string>(pt::ptree::path_type("registers/" + info.m_sName, '/'));
+		if (!value)
+			throw std::runtime_error("Snapshot is missing register " + info.m_sName);
+		values.push_back(static_cast<std::uint32_t>(strtoul(value->c_str(), NULL, 0)));
+	}
+
+	return Snapshot(layout, std::move(values));
+}
+
+// converts runs of registers of the same width to host byte order. The
+// upper half of the slots of 16 bit registers is zero, so their slots are
+// swapped as two 16 bit words.
+static void swap(const Layout &regs, std::vector<std::uint32_t> &values) {
+
+	for (std::size_t i = 0; i < regs.size();) {
+
+		std::size_t j = i + 1;
+		bool swapped = regs[i].m_uSize > 1 && HOST_ENDIAN != regs[i].m_eEndian;
+		for (; j < regs.size(); j++) {
+			bool next = regs[j].m_uSize > 1 && HOST_ENDIAN != regs[j].m_eEndian;
+			if (next != swapped || (swapped && regs[j].m_uSize != regs[i].m_uSize))
+				break;
+		}
+
+		if (swapped) {
+			if (2 == regs[i].m_uSize)
+				swapWords(&values[i], 2 * (j - i), 2);
+			else
+				swapWords(&values[i], j - i, 4);
+		}
+		i = j;
+	}
+}
+
+Snapshot dump(const Layout_t &layout, IRegBackend &backend, unsigned int maxGap, std::size_t maxBurst) {
+
+	const Layout &regs = *layout;
+	std::vector<std::uint32_t> values(regs.size(), 0);
+
+	// Indirect registers can only be read one by one. Mapped device memory
+	// is read one register at a time as well, with loads of the register's
+	// own width: bulk copies use wider loads, which MMIO does not tolerate
+	// and which would gain nothing there.
+	if (backend.isIndirect() || backend.mapping(0, 0)) {
+		for (std::size_t i = 0; i < regs.size(); i++) {
+			switch (regs[i].m_uSize) {
+				case 1: values[i] = backend.get<std::uint8_t>(regs[i].m_uOffset); break;
+				case 2: values[i] = backend.get<std::uint16_t>(regs[i].m_uOffset, regs[i].m_eEndian); break;
+				default: values[i] = backend.get<std::uint32_t>(regs[i].m_uOffset, regs[i].m_eEndian); break;
+			}
+		}
+		return Snapshot(layout, std::move(values));
+	}
+
+	std::vector<unsigned char> buffer;
+	for (std::size_t i = 0; i < regs.size();) {
+
+		unsigned int start = regs[i].m_uOffset;
+		unsigned int end = start + regs[i].m_uSize;
+		std::size_t j = i + 1;
+		for (; j < regs.size() && regs[j].m_uOffset <= end + maxGap; j++) {
+			unsigned int next = std::max(end, regs[j].m_uOffset + regs[j].m_uSize);
+			if (maxBurst && next - start > maxBurst)
+				break;
+			end = next;
+		}
+
+		buffer.resize(end - start);
+		backend.copy_from_device(start, buffer.data(), buffer.size());
+		for (; i < j; i++)
+			memcpy(&values[i], &buffer[regs[i].m_uOffset - start], regs[i].m_uSize);
+	}
+
+	swap(regs, values);
+	return Snapshot(layout, std::move(values));
+}
+
+std::vector<RegisterChange> diff(const Snapshot &before, const Snapshot &after) {
+
+	if (before.layout() != after.layout())
+		throw std::runtime_error("Snapshots of different layouts can not be compared");
+
+	std::vector<RegisterChange> changes;
+	for (std::size_t i = 0; i < before.size(); i++) {
+
+		std::uint32_t old = before.value(i), now = after.value(i);
+		if (old == now)
+			continue;
+
+		const RegisterInfo &info = before.info(i);
+		RegisterChange change = { info.m_sName, info.m_uOffset, old, now, {} };
+		const BitmaskTable &bitmasks = info.m_pBitmasks ? *info.m_pBitmasks : BitmaskTable::none();
+		for (auto &bitmask : bitmasks) {
+			std::uint32_t mask = bitmask.m_uMask;
+			if (!mask || !((old ^ now) & mask))
+				continue;
+
+			unsigned int shift = 0;
+			while (!((mask >> shift) & 1))
+				shift++;
+			change.m_oFields.push_back(FieldChange{bitmask.m_pName, (old & mask) >> shift, (now & mask) >> shift});
+		}
+
+		changes.push_back(change);
+	}
+
+	return changes;
+}
+
+std::ostream& operator<<(std::ostream &os, const RegisterChange &change) {
+
+	std::ios_base::fmtflags flags(os.flags());
+	os << change.m_sName << " @0x" << std::hex << change.m_uOffset
+	   << ": 0x" << change.m_uBefore << " -> 0x" << change.m_uAfter;
+
+	for (auto &field : change.m_oFields)
+		os << ", " << field.m_sName << ": 0x" << field.m_uBefore << " -> 0x" << field.m_uAfter;
+
+	os.flags(flags);
+	return os;
+}
+
+};
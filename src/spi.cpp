@@ -0,0 +1,267 @@
+/* This file is part of libregmap.
+ *
+ * libregmap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libregmap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libregmap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cerrno>
+#include <stdexcept>
+#include "spi.hpp"
+
+namespace regmap { namespace spi {
+
+namespace {
+
+// SPI_MSGSIZE is 0 from 512 transfers on, the ioctl size field overflows
+const std::size_t MAX_TRANSFERS = 510;
+
+};
+
+std::size_t Protocol::registers() const {
+
+	unsigned int bits = 8 * m_uAddressBytes;
+	std::uint64_t address = ((std::uint64_t(1) << bits) - 1) & ~std::uint64_t(m_uReadFlag | m_uWriteFlag);
+
+	// the address field are the contiguous bits from addressShift upwards
+	unsigned int n = 0;
+	while (m_uAddressShift + n < bits && ((address >> (m_uAddressShift + n)) & 1))
+		n++;
+
+	return std::size_t(1) << n;
+}
+
+RegBackendSPIDev::RegBackendSPIDev(BackendFile_t file, const Protocol &protocol, std::uint32_t speedHz, Ioctl_t ioctl)
+: m_pFile(file), m_oProtocol(protocol), m_uSpeedHz(speedHz), m_fIoctl(ioctl),
+  m_uRegisters(protocol.registers()), m_pMessages(std::make_shared<std::atomic<std::uint64_t> >(0)) {
+
+	if (m_oProtocol.m_uAddressBytes < 1 || m_oProtocol.m_uAddressBytes > 4)
+		throw std::runtime_error("RegBackendSPIDev: Unsupported address width " + std::to_string(m_oProtocol.m_uAddressBytes));
+}
+
+size_t RegBackendSPIDev::size() const {
+
+	return m_pFile ? m_uRegisters : 0;
+}
+
+void RegBackendSPIDev::submit(const Access *accesses, std::size_t count) {
+
+	std::error_code error = this->execute(accesses, count);
+	if (error)
+		throw std::system_error(error, "SPI transfer unsuccessful");
+}
+
+void RegBackendSPIDev::read_repeated(unsigned int offset, void* dst, size_t width, size_t count) {
+
+	if (this->isIndirect())
+		return IRegBackend::read_repeated(offset, dst, width, count);
+
+	// whole words per frame, as many as spidev takes
+	std::size_t words = std::max<std::size_t>(1, (SPIDEV_BUFSIZ - m_oProtocol.m_uAddressBytes - m_oProtocol.m_uDummyBytes) / width);
+	std::vector<Access> accesses;
+	for (std::size_t i = 0; i < count; i += words)
+		accesses.push_back(Access{offset, static_cast<unsigned char*>(dst) + i * width, std::min(words, count - i) * width, false});
+
+	this->submit(accesses.data(), accesses.size());
+}
+
+void RegBackendSPIDev::write_repeated(unsigned int offset, const void* src, size_t width, size_t count) {
+
+	if (this->isIndirect())
+		return IRegBackend::write_repeated(offset, src, width, count);
+
+	std::size_t words = std::max<std::size_t>(1, (SPIDEV_BUFSIZ - m_oProtocol.m_uAddressBytes) / width);
+	std::vector<Access> accesses;
+	for (std::size_t i = 0; i < count; i += words)
+		accesses.push_back(Access{offset, const_cast<unsigned char*>(static_cast<const unsigned char*>(src)) + i * width,
+			std::min(words, count - i) * width, true});
+
+	this->submit(accesses.data(), accesses.size());
+}
+
+void RegBackendSPIDev::copy_to_device(unsigned int offset, const void* src, size_t size) {
+
+	if (this->isIndirect())
+		return IRegBackend::copy_to_device(offset, src, size);
+
+	this->copy(offset, static_cast<unsigned char*>(const_cast<void*>(src)), size, true);
+}
+
+void RegBackendSPIDev::copy_from_device(unsigned int offset, void* dst, size_t size) {
+
+	if (this->isIndirect())
+		return IRegBackend::copy_from_device(offset, dst, size);
+
+	this->copy(offset, static_cast<unsigned char*>(dst), size, false);
+}
+
+bool RegBackendSPIDev::fits(unsigned int offset, size_t size) const {
+
+	return offset + (m_oProtocol.m_bAutoIncrement ? size : 1) <= m_uRegisters;
+}
+
+void RegBackendSPIDev::copy(unsigned int offset, unsigned char *data, size_t size, bool write) {
+
+	// auto incrementing slaves take bursts, others one frame per register
+	std::size_t burst = m_oProtocol.m_bAutoIncrement ? SPIDEV_BUFSIZ - m_oProtocol.m_uAddressBytes - m_oProtocol.m_uDummyBytes : 1;
+	std::vector<Access> accesses;
+	for (std::size_t done = 0; done < size; done += burst)
+		accesses.push_back(Access{static_cast<unsigned int>(offset + done), data + done, std::min(burst, size - done), write});
+
+	this->submit(accesses.data(), accesses.size());
+}
+
+void RegBackendSPIDev::write(unsigned int offset, void* value, size_t size) {
+
+	if (!this->fits(offset, size))
+		throwOutOfRange("RegBackendSPIDev", offset);
+
+	Access access = {offset, value, size, true};
+	this->submit(&access, 1);
+}
+
+void RegBackendSPIDev::read(unsigned int offset, void* value, size_t size) {
+
+	if (!this->fits(offset, size))
+		throwOutOfRange("RegBackendSPIDev", offset);
+
+	Access access = {offset, value, size, false};
+	this->submit(&access, 1);
+}
+
+std::error_code RegBackendSPIDev::try_write(unsigned int offset, void* value, size_t size) noexcept {
+
+	Access access = {offset, value, size, true};
+	return this->execute(&access, 1);
+}
+
+std::error_code RegBackendSPIDev::try_read(unsigned int offset, void* value, size_t size) noexcept {
+
+	Access access = {offset, value, size, false};
+	return this->execute(&access, 1);
+}
+
+std::error_code RegBackendSPIDev::execute(const Access *accesses, std::size_t count) noexcept {
+
+	if (!m_pFile)
+		return std::make_error_code(std::errc::bad_file_descriptor);
+
+	// addresses beyond the field would end up in the command's flags
+	for (std::size_t i = 0; i < count; i++) {
+		if (!this->fits(accesses[i].m_uOffset, accesses[i].m_uSize))
+			return std::make_error_code(std::errc::result_out_of_range);
+	}
+
+	const unsigned int header = m_oProtocol.m_uAddressBytes;
+	std::vector<unsigned char> buffer;
+	std::vector<spi_ioc_transfer> transfers;
+
+	try {
+		for (std::size_t done = 0; done < count; ) {
+
+			// as many accesses as one message takes, but at least one
+			std::size_t n = 0, bytes = 0;
+			for (; done + n < count; n++) {
+				const Access &access = accesses[done + n];
+				std::size_t frame = header + (access.m_bWrite ? 0 : m_oProtocol.m_uDummyBytes) + access.m_uSize;
+				if (n && (bytes + frame > SPIDEV_BUFSIZ || 2 * (n + 1) > MAX_TRANSFERS))
+					break;
+				bytes += frame;
+			}
+
+			// commands and write data, sized up front as the transfers point
+			// into it. Reads leave their data's share of the space unused.
+			buffer.assign(bytes, 0);
+			transfers.clear();
+			std::size_t pos = 0;
+
+			for (std::size_t i = 0; i < n; i++) {
+				const Access &access = accesses[done + i];
+				std::uint32_t command = m_oProtocol.command(access.m_uOffset, !access.m_bWrite);
+				for (unsigned int b = 0; b < header; b++)
+					buffer[pos + b] = command >> (8 * (header - 1 - b));
+
+				spi_ioc_transfer transfer;
+				memset(&transfer, 0, sizeof(transfer));
+				transfer.tx_buf = reinterpret_cast<std::uintptr_t>(&buffer[pos]);
+				transfer.speed_hz = m_uSpeedHz;
+				transfer.bits_per_word = 8;
+
+				if (access.m_bWrite) {
+					memcpy(&buffer[pos + header], access.m_pData, access.m_uSize);
+					transfer.len = header + access.m_uSize;
+					pos += transfer.len;
+					transfers.push_back(transfer);
+				} else {
+					transfer.len = header + m_oProtocol.m_uDummyBytes;
+					pos += transfer.len + access.m_uSize;
+					transfers.push_back(transfer);
+
+					transfer.tx_buf = 0;
+					transfer.rx_buf = reinterpret_cast<std::uintptr_t>(access.m_pData);
+					transfer.len = access.m_uSize;
+					transfers.push_back(transfer);
+				}
+
+				// deselect between the accesses, spidev keeps the chip
+				// selected after the last transfer if cs_change is set there
+				transfers.back().cs_change = i + 1 < n;
+			}
+
+			unsigned long request = _IOC(_IOC_WRITE, SPI_IOC_MAGIC, 0, SPI_MSGSIZE(transfers.size()));
+			int ret = m_fIoctl ? m_fIoctl(*m_pFile, request, transfers.data()) : ::ioctl(*m_pFile, request, transfers.data());
+			(*m_pMessages)++;
+			if (0 > ret)
+				return std::error_code(errno, std::generic_category());
+
+			done += n;
+		}
+	} catch (const std::bad_alloc&) {
+		return std::make_error_code(std::errc::not_enough_memory);
+	} catch (...) {
+		return std::make_error_code(std::errc::io_error);
+	}
+
+	return std::error_code();
+}
+
+SPI::SPI(unsigned char bus, unsigned char chipSelect, const DefinitionRef &definition,
+	const Protocol &protocol, std::uint32_t speedHz, std::uint8_t mode)
+: RegMapBase(definition) {
+
+	std::string device("/dev/spidev" + std::to_string(bus) + "." + std::to_string(chipSelect));
+	BackendFile_t file(new int(), &SPI::closeDeleter);
+	*file = open(device.c_str(), O_RDWR);
+	if (0 > *file)
+		throw std::runtime_error("Unable to open " + device);
+
+	std::uint8_t bits = 8;
+	if (0 > ioctl(*file, SPI_IOC_WR_MODE, &mode) || 0 > ioctl(*file, SPI_IOC_WR_BITS_PER_WORD, &bits)
+		|| 0 > ioctl(*file, SPI_IOC_WR_MAX_SPEED_HZ, &speedHz))
+		throw std::runtime_error("Could not configure " + device);
+
+	this->setBackend(RegBackendSPIDev(file, protocol, speedHz));
+}
+
+SPI::SPI(const RegBackendSPIDev &backend, const DefinitionRef &definition)
+: RegMapBase(definition) {
+
+	this->setBackend(backend);
+}
+
+void SPI::closeDeleter(int* fd) {
+
+	if (0 <= *fd)
+		close(*fd);
+	delete fd;
+}
+
+}};
@@ -0,0 +1,64 @@
+/* This file is part of libregmap.
+ *
+ * libregmap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libregmap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libregmap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+#include <cstdint>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "streaming.hpp"
+
+namespace regmap {
+
+void streamCopy(void *dst, const void *src, std::size_t size) {
+
+	unsigned char *d = static_cast<unsigned char*>(dst);
+	const unsigned char *s = static_cast<const unsigned char*>(src);
+
+#if defined(__SSE2__)
+	std::size_t head = (16 - (reinterpret_cast<std::uintptr_t>(d) & 15)) & 15;
+	if (head > size)
+		head = size;
+
+	memcpy(d, s, head);
+	d += head;
+	s += head;
+	size -= head;
+
+	// 64 bytes per iteration fill a whole write combining buffer
+	for (; size >= 64; size -= 64, d += 64, s += 64) {
+		__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+		__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 16));
+		__m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 32));
+		__m128i e = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 48));
+		_mm_stream_si128(reinterpret_cast<__m128i*>(d), a);
+		_mm_stream_si128(reinterpret_cast<__m128i*>(d + 16), b);
+		_mm_stream_si128(reinterpret_cast<__m128i*>(d + 32), c);
+		_mm_stream_si128(reinterpret_cast<__m128i*>(d + 48), e);
+	}
+
+	for (; size >= 16; size -= 16, d += 16, s += 16)
+		_mm_stream_si128(reinterpret_cast<__m128i*>(d), _mm_loadu_si128(reinterpret_cast<const __m128i*>(s)));
+
+	memcpy(d, s, size);
+	_mm_sfence();
+#else
+	memcpy(d, s, size);
+	__sync_synchronize();
+#endif
+}
+
+};
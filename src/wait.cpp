@@ -0,0 +1,146 @@
+/* This file is part of libregmap.
+ *
+ * libregmap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libregmap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libregmap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <thread>
+#include <stdexcept>
+#include "wait.hpp"
+
+namespace regmap {
+
+const int Waiter::TIMEOUT;
+
+Waiter::Waiter(std::chrono::nanoseconds interval)
+: m_uInterval(interval), m_uIterations(0) {}
+
+std::size_t Waiter::add(const std::string &name, IRegBackend &backend, unsigned int offset, unsigned int size,
+			eEndian order, std::uint32_t mask, std::uint32_t accessMask, eCompare compare, std::uint32_t value) {
+
+	if (!mask)
+		throw std::runtime_error("Waiter: empty mask for " + name);
+
+	// registers used by several conditions are read once
+	std::size_t slot = 0;
+	for (; slot < m_oSlots.size(); slot++)
+		if (m_oSlots[slot].m_pBackend == &backend && m_oSlots[slot].m_uOffset == offset && m_oSlots[slot].m_uSize == size)
+			break;
+	if (slot == m_oSlots.size())
+		m_oSlots.push_back(Slot{&backend, offset, size, order, 0});
+
+	unsigned int shift = 0;
+	while (!((mask >> shift) & 1))
+		shift++;
+
+	// the field keeps its position, hidden bits of it are cleared
+	m_oChecks.push_back(Check{name, slot, mask & accessMask, shift, compare, value, std::function<bool()>()});
+	m_oSatisfied.push_back(false);
+	return m_oChecks.size() - 1;
+}
+
+std::size_t Waiter::add(const std::function<bool()> &predicate) {
+
+	if (!predicate)
+		throw std::runtime_error("Waiter: empty predicate");
+
+	m_oChecks.push_back(Check{"", 0, 0, 0, EQUAL, 0, predicate});
+	m_oSatisfied.push_back(false);
+	return m_oChecks.size() - 1;
+}
+
+bool Waiter::test(const Check &check) const {
+
+	if (check.m_oPredicate)
+		return check.m_oPredicate();
+
+	std::uint32_t field = (m_oSlots[check.m_uSlot].m_uValue & check.m_uMask) >> check.m_uShift;
+	switch (check.m_eCompare) {
+		case EQUAL:		return field == check.m_uValue;
+		case NOT_EQUAL:		return field != check.m_uValue;
+		case LESS:		return field < check.m_uValue;
+		case LESS_EQUAL:	return field <= check.m_uValue;
+		case GREATER:		return field > check.m_uValue;
+		case GREATER_EQUAL:	return field >= check.m_uValue;
+		case ALL_SET:		return (field & check.m_uValue) == check.m_uValue;
+		case ANY_SET:		return (field & check.m_uValue) != 0;
+		case NONE_SET:		return (field & check.m_uValue) == 0;
+	}
+
+	return false;
+}
+
+int Waiter::poll() {
+
+	for (auto &slot : m_oSlots) {
+		switch (slot.m_uSize) {
+			case 1: slot.m_uValue = slot.m_pBackend->get<std::uint8_t>(slot.m_uOffset); break;
+			case 2: slot.m_uValue = slot.m_pBackend->get<std::uint16_t>(slot.m_uOffset, slot.m_eEndian); break;
+			default: slot.m_uValue = slot.m_pBackend->get<std::uint32_t>(slot.m_uOffset, slot.m_eEndian); break;
+		}
+	}
+
+	int first = TIMEOUT;
+	for (std::size_t i = 0; i < m_oChecks.size(); i++) {
+		m_oSatisfied[i] = this->test(m_oChecks[i]);
+		if (m_oSatisfied[i] && TIMEOUT == first)
+			first = static_cast<int>(i);
+	}
+
+	m_uIterations++;
+	return first;
+}
+
+template <class F>
+bool Waiter::loop(std::chrono::nanoseconds timeout, F done) {
+
+	if (m_oChecks.empty())
+		throw std::runtime_error("Waiter: no conditions to wait for");
+
+	m_uIterations = 0;
+	auto start = std::chrono::steady_clock::now();
+	while (true) {
+		if (done(this->poll()))
+			return true;
+
+		if (timeout.count() && std::chrono::steady_clock::now() - start > timeout)
+			return false;
+
+		if (m_uInterval.count())
+			std::this_thread::sleep_for(m_uInterval);
+		else
+			std::this_thread::yield();
+	}
+}
+
+int Waiter::any(std::chrono::nanoseconds timeout) {
+
+	int fired = TIMEOUT;
+	this->loop(timeout, [&fired](int first) {
+		fired = first;
+		return TIMEOUT != first;
+	});
+
+	return fired;
+}
+
+bool Waiter::all(std::chrono::nanoseconds timeout) {
+
+	return this->loop(timeout, [this](int) {
+		for (bool satisfied : m_oSatisfied)
+			if (!satisfied)
+				return false;
+		return true;
+	});
+}
+
+};
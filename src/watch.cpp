@@ -0,0 +1,331 @@
+/* This file is part of libregmap.
+ *
+ * libregmap is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libregmap is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libregmap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "watch.hpp"
+
+namespace regmap {
+
+Watcher::Watcher(IRegBackend &backend, unsigned int maxGap)
+: m_oBackend(backend), m_uMaxGap(maxGap), m_uPoll(0), m_bDirty(true), m_bPolling(false) {}
+
+void Watcher::checkBackend(const IRegBackend &backend) const {
+
+	if (&backend != &m_oBackend)
+		throw std::runtime_error("Watcher: register belongs to another backend");
+}
+
+std::size_t Watcher::add(const std::string &name, unsigned int offset, unsigned int size, eEndian order, std::uint32_t mask,
+			eTrigger trigger, unsigned int debounce, const WatchCallback_t &callback) {
+
+	if (!mask)
+		throw std::runtime_error("Watcher: empty mask for " + name);
+
+	unsigned int shift = 0;
+	while (!((mask >> shift) & 1))
+		shift++;
+
+	Watch watch = { name, offset, size, size > 1 && HOST_ENDIAN != order, mask, shift, trigger, debounce, callback, true, false, 0, 0, 0, 0, 0 };
+
+	// callbacks hold references into the watches while a poll runs
+	if (m_bPolling) {
+		m_oAdded.push_back(watch);
+		return m_oWatches.size() + m_oAdded.size() - 1;
+	}
+
+	m_oWatches.push_back(watch);
+	m_bDirty = true;
+
+	return m_oWatches.size() - 1;
+}
+
+void Watcher::unwatch(std::size_t id) {
+
+	if (id >= m_oWatches.size() + m_oAdded.size())
+		throw std::out_of_range("Watcher: unknown watch " + std::to_string(id));
+
+	if (id >= m_oWatches.size())
+		m_oAdded[id - m_oWatches.size()].m_bActive = false;
+	else
+		m_oWatches[id].m_bActive = false;
+	m_bDirty = true;
+}
+
+std::size_t Watcher::transfers() {
+
+	// the layout is kept while a poll runs
+	if (m_bDirty && !m_bPolling)
+		this->build();
+
+	if (!m_oBackend.mapping(0, 0))
+		return m_oRanges.size();
+
+	return std::count_if(m_oWatches.begin(), m_oWatches.end(), [](const Watch &watch) { return watch.m_bActive; });
+}
+
+// lays out the watched registers in offset order, coalesces them into
+// ranges and assigns the watches to the blocks they occupy. The previous
+// values of watches with a baseline move along with them.
+void Watcher::build() {
+
+	std::vector<std::size_t> positions;
+	for (auto &watch : m_oWatches)
+		positions.push_back(watch.m_uPosition);
+	std::vector<unsigned char> previous;
+	previous.swap(m_oPrevious);
+
+	std::vector<std::size_t> order;
+	for (std::size_t i = 0; i < m_oWatches.size(); i++)
+		if (m_oWatches[i].m_bActive)
+			order.push_back(i);
+
+	std::sort(order.begin(), order.end(), [this](std::size_t a, std::size_t b) {
+		return m_oWatches[a].m_uOffset < m_oWatches[b].m_uOffset;
+	});
+
+	m_oRanges.clear();
+	std::size_t position = 0;
+	for (std::size_t i : order) {
+
+		Watch &watch = m_oWatches[i];
+		if (!m_oRanges.empty()) {
+			Range &last = m_oRanges.back();
+			unsigned int end = last.m_uOffset + last.m_uSize;
+			if (watch.m_uOffset <= end + m_uMaxGap) {
+				unsigned int next = std::max<unsigned int>(end, watch.m_uOffset + watch.m_uSize);
+				position += next - end;
+				last.m_uSize = next - last.m_uOffset;
+				watch.m_uPosition = last.m_uPosition + (watch.m_uOffset - last.m_uOffset);
+				continue;
+			}
+		}
+
+		m_oRanges.push_back(Range{watch.m_uOffset, watch.m_uSize, position});
+		watch.m_uPosition = position;
+		position += watch.m_uSize;
+	}
+
+	// whole blocks, the padding compares equal
+	std::size_t size = (position + BLOCK - 1) / BLOCK * BLOCK;
+	m_oPrevious.assign(size, 0);
+	m_oCurrent.assign(size, 0);
+	for (std::size_t i : order)
+		if (m_oWatches[i].m_bBaseline)
+			memcpy(&m_oPrevious[m_oWatches[i].m_uPosition], &previous[positions[i]], m_oWatches[i].m_uSize);
+
+	m_oBlocks.assign(size / BLOCK, std::vector<std::size_t>());
+	m_oAlways.clear();
+	for (std::size_t i : order) {
+		Watch &watch = m_oWatches[i];
+		std::size_t first = watch.m_uPosition / BLOCK, last = (watch.m_uPosition + watch.m_uSize - 1) / BLOCK;
+		for (std::size_t block = first; block <= last; block++)
+			m_oBlocks[block].push_back(i);
+
+		if (watch.m_uDebounce || LEVEL_HIGH == watch.m_eTrigger || LEVEL_LOW == watch.m_eTrigger)
+			m_oAlways.push_back(i);
+	}
+
+	m_bDirty = false;
+}
+
+void Watcher::read(std::vector<unsigned char> &buffer) {
+
+	if (!m_oBackend.mapping(0, 0)) {
+		for (auto &range : m_oRanges)
+			m_oBackend.copy_from_device(range.m_uOffset, &buffer[range.m_uPosition], range.m_uSize);
+		return;
+	}
+
+	// mapped device memory is read with loads of each register's width,
+	// like dump()
+	for (auto &watch : m_oWatches) {
+		if (!watch.m_bActive)
+			continue;
+
+		unsigned char *dst = &buffer[watch.m_uPosition];
+		switch (watch.m_uSize) {
+			case 1: { std::uint8_t v = m_oBackend.get<std::uint8_t>(watch.m_uOffset); memcpy(dst, &v, 1); break; }
+			case 2: { std::uint16_t v = m_oBackend.get<std::uint16_t>(watch.m_uOffset); memcpy(dst, &v, 2); break; }
+			default: { std::uint32_t v = m_oBackend.get<std::uint32_t>(watch.m_uOffset); memcpy(dst, &v, 4); break; }
+		}
+	}
+}
+
+std::uint32_t Watcher::load(const std::vector<unsigned char> &buffer, const Watch &watch) const {
+
+	std::uint32_t value = 0;
+	memcpy(&value, &buffer[watch.m_uPosition], watch.m_uSize);
+	if (watch.m_bSwap)
+		value = byteswap<std::uint32_t>(value) >> (8 * (sizeof(value) - watch.m_uSize));
+	return (value & watch.m_uMask) >> watch.m_uShift;
+}
+
+// returns true if the callback fired
+bool Watcher::evaluate(Watch &watch, std::uint32_t before, std::uint32_t after) {
+
+	// unwatched by a callback earlier in this poll
+	if (!watch.m_bActive)
+		return false;
+
+	// debounced watches report a value once it was seen on enough
+	// consecutive polls, compared against the last reported value
+	if (watch.m_uDebounce) {
+		if (after != watch.m_uCandidate) {
+			watch.m_uCandidate = after;
+			watch.m_uStable = 1;
+		} else if (watch.m_uStable < watch.m_uDebounce) {
+			watch.m_uStable++;
+		}
+
+		if (watch.m_uStable < watch.m_uDebounce)
+			return false;
+
+		before = watch.m_uReported;
+	}
+
+	bool fire = false;
+	switch (watch.m_eTrigger) {
+		case CHANGE:
+		fire = before != after;
+		break;
+
+		case RISING:
+		fire = (~before & after) != 0;
+		break;
+
+		case FALLING:
+		fire = (before & ~after) != 0;
+		break;
+
+		case LEVEL_HIGH:
+		fire = after != 0;
+		break;
+
+		case LEVEL_LOW:
+		fire = after == 0;
+		break;
+	}
+
+	watch.m_uReported = after;
+	if (fire)
+		watch.m_oCallback(WatchEvent{watch.m_sName, watch.m_uOffset, watch.m_uMask, before, after});
+
+	return fire;
+}
+
+std::size_t Watcher::poll() {
+
+	if (m_bPolling)
+		throw std::runtime_error("Watcher: poll() called from a callback");
+
+	m_bPolling = true;
+	std::size_t fired = 0;
+	try {
+		fired = this->scan();
+	} catch (...) {
+		this->settle();
+		throw;
+	}
+
+	this->settle();
+	return fired;
+}
+
+// ends a poll, watches added by its callbacks join the next one
+void Watcher::settle() {
+
+	m_bPolling = false;
+	if (m_oAdded.empty())
+		return;
+
+	m_oWatches.insert(m_oWatches.end(), m_oAdded.begin(), m_oAdded.end());
+	m_oAdded.clear();
+	m_bDirty = true;
+}
+
+std::size_t Watcher::scan() {
+
+	if (m_bDirty)
+		this->build();
+
+	if (m_oRanges.empty())
+		return 0;
+
+	this->read(m_oCurrent);
+
+	// new watches take their baseline and are not compared this time
+	std::size_t fired = 0;
+	m_uPoll++;
+	for (auto &watch : m_oWatches) {
+		if (!watch.m_bActive || watch.m_bBaseline)
+			continue;
+
+		watch.m_bBaseline = true;
+		watch.m_uPoll = m_uPoll;
+		watch.m_uReported = watch.m_uCandidate = this->load(m_oCurrent, watch);
+		watch.m_uStable = watch.m_uDebounce;
+		if (LEVEL_HIGH == watch.m_eTrigger || LEVEL_LOW == watch.m_eTrigger)
+			fired += this->evaluate(watch, watch.m_uReported, watch.m_uReported);
+	}
+
+	// watches evaluated regardless of changes
+	for (std::size_t i : m_oAlways) {
+		Watch &watch = m_oWatches[i];
+		if (watch.m_uPoll == m_uPoll)
+			continue;
+		watch.m_uPoll = m_uPoll;
+		fired += this->evaluate(watch, this->load(m_oPrevious, watch), this->load(m_oCurrent, watch));
+	}
+
+	const unsigned char *previous = m_oPrevious.data(), *current = m_oCurrent.data();
+	for (std::size_t block = 0; block < m_oBlocks.size(); block++) {
+
+		std::size_t at = block * BLOCK;
+#if defined(__SSE2__)
+		__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(previous + at));
+		__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(current + at));
+		if (0xFFFF == _mm_movemask_epi8(_mm_cmpeq_epi8(a, b)))
+			continue;
+#else
+		std::uint64_t a[2], b[2];
+		memcpy(a, previous + at, BLOCK);
+		memcpy(b, current + at, BLOCK);
+		if (a[0] == b[0] && a[1] == b[1])
+			continue;
+#endif
+
+		for (std::size_t i : m_oBlocks[block]) {
+			// registers spanning two blocks are evaluated once
+			Watch &watch = m_oWatches[i];
+			if (watch.m_uPoll == m_uPoll)
+				continue;
+			watch.m_uPoll = m_uPoll;
+
+			std::uint32_t before = this->load(m_oPrevious, watch), after = this->load(m_oCurrent, watch);
+			if (before != after)
+				fired += this->evaluate(watch, before, after);
+		}
+	}
+
+	m_oPrevious.swap(m_oCurrent);
+	return fired;
+}
+
+};
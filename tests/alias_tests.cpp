@@ -0,0 +1,69 @@
+#include <boost/test/unit_test.hpp>
+
+#include "sim.hpp"
+
+BOOST_AUTO_TEST_SUITE(alias_tests)
+
+
+BOOST_AUTO_TEST_CASE(helpers_write_to_aliases){
+
+	auto test = regmap::sim::Simulator("alias.json", 32, regmap::sim::LatencyModel(), false);
+	auto ctrl = test.get<regmap::Register32_t>("ctrl");
+	auto ctrl_set = test.get<regmap::Register32_t>("ctrl_set");
+	auto ctrl_clr = test.get<regmap::Register32_t>("ctrl_clr");
+	auto ctrl_tog = test.get<regmap::Register32_t>("ctrl_tog");
+	auto &backend = test.getBackend();
+
+	BOOST_CHECK(ctrl.has_aliases());
+	BOOST_CHECK(!ctrl_set.has_aliases());
+
+	ctrl = 0xAFFE;
+	backend.resetStatistics();
+
+	BOOST_CHECK_EQUAL(ctrl.apply(0x30), 0x30);
+	BOOST_CHECK_EQUAL(ctrl.start(), 0x1);
+	BOOST_CHECK_EQUAL(ctrl_set, 0x1);
+	BOOST_CHECK_EQUAL(ctrl.freeze(), 0x4);
+	BOOST_CHECK_EQUAL(ctrl.unfreeze(), 0x4);
+	BOOST_CHECK_EQUAL(ctrl_clr, 0x4);
+	BOOST_CHECK_EQUAL(ctrl.toggle(0xF0), 0xF0);
+	BOOST_CHECK_EQUAL(ctrl_tog, 0xF0);
+
+	// the helpers never read the register itself
+	BOOST_CHECK_EQUAL(backend.statistics().m_uWrites, 5u);
+	BOOST_CHECK_EQUAL(backend.statistics().m_uReads, 3u);
+	BOOST_CHECK_EQUAL(ctrl, 0xAFFE);
+}
+
+BOOST_AUTO_TEST_CASE(compound_assignments_use_aliases){
+
+	auto test = regmap::sim::Simulator("alias.json", 32, regmap::sim::LatencyModel(), false);
+	auto ctrl = test.get<regmap::Register32_t>("ctrl");
+	auto ctrl_set = test.get<regmap::Register32_t>("ctrl_set");
+	auto ctrl_clr = test.get<regmap::Register32_t>("ctrl_clr");
+	auto ctrl_tog = test.get<regmap::Register32_t>("ctrl_tog");
+
+	ctrl |= 0x11u;
+	BOOST_CHECK_EQUAL(ctrl_set, 0x11);
+	ctrl &= ~0x22u;
+	BOOST_CHECK_EQUAL(ctrl_clr, 0x22);
+	ctrl ^= 0x44u;
+	BOOST_CHECK_EQUAL(ctrl_tog, 0x44);
+}
+
+BOOST_AUTO_TEST_CASE(registers_override_map_aliases){
+
+	auto test = regmap::sim::Simulator("alias.json", 32, regmap::sim::LatencyModel(), false);
+	auto status = test.get<regmap::Register16_t>("status");
+
+	// only a set alias, clearing falls back to read-modify-write
+	status = 0x0F;
+	BOOST_CHECK_EQUAL(status.apply(0x1F0), 0xF0);
+	BOOST_CHECK_EQUAL(status, 0x0F);
+	BOOST_CHECK_EQUAL(status.clear(0x3), 0x0C);
+	BOOST_CHECK_EQUAL(status, 0x0C);
+	BOOST_CHECK_EQUAL(status.toggle(0x5), 0x09);
+	BOOST_CHECK_EQUAL(status, 0x09);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
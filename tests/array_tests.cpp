@@ -0,0 +1,56 @@
+#include <boost/test/unit_test.hpp>
+
+#include "RegMapMock.hpp"
+
+BOOST_AUTO_TEST_SUITE(array_tests)
+
+
+BOOST_AUTO_TEST_CASE(register_arrays){
+
+	auto test = regmap::RegMapMock("arrays.json", 0x200);
+
+	BOOST_CHECK_EQUAL(test.array("DOORBELL").size(), 16u);
+	BOOST_CHECK_EQUAL(test.array("DOORBELL").stride(), 2u);
+	BOOST_CHECK_EQUAL(test.get<regmap::Register16_t>("DOORBELL", 0).getOffset(), 0x10);
+	BOOST_CHECK_EQUAL(test.get<regmap::Register16_t>("DOORBELL", 15).getOffset(), 0x2E);
+	BOOST_CHECK_EQUAL(test.get<regmap::Register16_t>("DOORBELL", 3).getName(), "DOORBELL");
+
+	auto doorbell = test.get<regmap::Register16_t>("DOORBELL", 4);
+	doorbell = 0x1234;
+	test.get<regmap::Register16_t>("DOORBELL", 5) = 0xAFFE;
+	BOOST_CHECK_EQUAL(test.array("DOORBELL").get<regmap::Register16_t>(5), 0xAFFE);
+	BOOST_CHECK_EQUAL(test.get<regmap::Register16_t>("DOORBELL", 4), 0x1234);
+}
+
+BOOST_AUTO_TEST_CASE(nested_blocks){
+
+	auto test = regmap::RegMapMock("arrays.json", 0x200);
+	auto queues = test.array("QUEUE");
+
+	BOOST_CHECK_EQUAL(queues.size(), 4u);
+	BOOST_CHECK_EQUAL(queues[2].getOffset(), 0x180);
+	BOOST_CHECK_EQUAL(queues[2].get<regmap::Register32_t>("HEAD").getOffset(), 0x180);
+	BOOST_CHECK_EQUAL(queues[2].get<regmap::Register32_t>("TAIL").getOffset(), 0x184);
+	BOOST_CHECK_EQUAL(queues[3].array("VECTOR")[2].get<regmap::Register8_t>("VECTOR").getOffset(), 0x1C0 + 0x10 + 0x10);
+	BOOST_CHECK_EQUAL(queues[3].array("VECTOR").get<regmap::Register8_t>(3).getOffset(), 0x1C0 + 0x10 + 0x18);
+
+	queues[0].get<regmap::Register32_t>("HEAD") = 0;
+	auto head = queues[1].get<regmap::Register32_t>("HEAD");
+	head = head["WRAP"];
+	BOOST_CHECK(queues[1].get<regmap::Register32_t>("HEAD").is_set("WRAP"));
+	BOOST_CHECK(!queues[0].get<regmap::Register32_t>("HEAD").is_set("WRAP"));
+}
+
+BOOST_AUTO_TEST_CASE(it_throws_on_invalid_array_access){
+
+	auto test = regmap::RegMapMock("arrays.json", 0x200);
+
+	BOOST_CHECK_THROW(test.array("xXx"), std::runtime_error);
+	BOOST_CHECK_THROW(test.array("QUEUE")[4], std::out_of_range);
+	BOOST_CHECK_THROW(test.get<regmap::Register16_t>("DOORBELL", 16), std::out_of_range);
+	BOOST_CHECK_THROW(test.get<regmap::Register32_t>("DOORBELL", 0), std::runtime_error);
+	BOOST_CHECK_THROW(test.array("QUEUE")[0].get<regmap::Register32_t>("xXx"), std::runtime_error);
+	BOOST_CHECK_THROW(test.get<regmap::Register16_t>("DOORBELL"), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,88 @@
+#include <boost/test/unit_test.hpp>
+#include <vector>
+#include <algorithm>
+
+#include "RegMapMock.hpp"
+#include "sim.hpp"
+#include "bulk.hpp"
+
+BOOST_AUTO_TEST_SUITE(bulk_tests)
+
+
+BOOST_AUTO_TEST_CASE(copy_alignments_and_widths){
+
+	std::vector<unsigned char> src(300);
+	for (std::size_t i = 0; i < src.size(); i++)
+		src[i] = static_cast<unsigned char>(i * 13 + 1);
+
+	std::vector<unsigned int> widths = {1, 2, 4, 8};
+#if defined(__SSE2__)
+	widths.push_back(16);
+#endif
+
+	alignas(16) unsigned char device[320];
+	for (unsigned int width : widths)
+		for (std::size_t offset : {0, 1, 2, 3, 5, 8, 15})
+			for (std::size_t size : {0, 1, 3, 7, 16, 17, 31, 64, 255}) {
+				std::fill(device, device + sizeof(device), 0x55);
+				regmap::copyToDevice(device + offset, src.data() + 1, size, width);
+
+				BOOST_CHECK(std::equal(src.begin() + 1, src.begin() + 1 + size, device + offset));
+				BOOST_CHECK(std::all_of(device, device + offset, [](unsigned char c) { return c == 0x55; }));
+				BOOST_CHECK(std::all_of(device + offset + size, device + sizeof(device), [](unsigned char c) { return c == 0x55; }));
+
+				std::vector<unsigned char> back(size + 2, 0xAA);
+				regmap::copyFromDevice(back.data() + 1, device + offset, size, width);
+				BOOST_CHECK(std::equal(src.begin() + 1, src.begin() + 1 + size, back.begin() + 1));
+				BOOST_CHECK_EQUAL(back.front(), 0xAA);
+				BOOST_CHECK_EQUAL(back.back(), 0xAA);
+			}
+
+	BOOST_CHECK_THROW(regmap::copyToDevice(device, src.data(), 8, 3), std::runtime_error);
+	BOOST_CHECK_THROW(regmap::copyFromDevice(src.data(), device, 8, 64), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(memory_backend){
+
+	auto test = regmap::RegMapMock("simple.json", 256);
+	auto &backend = test.getBackend();
+
+	std::vector<std::uint32_t> table(32);
+	for (std::size_t i = 0; i < table.size(); i++)
+		table[i] = 0x10000 * i + i;
+
+	backend.copy_to_device(128, table.data(), table.size() * sizeof(std::uint32_t));
+	BOOST_CHECK_EQUAL(backend.get<std::uint32_t>(128 + 4 * 5), table[5]);
+
+	std::vector<std::uint32_t> readBack(table.size());
+	backend.copy_from_device(128, readBack.data(), readBack.size() * sizeof(std::uint32_t));
+	BOOST_CHECK(table == readBack);
+
+	backend.setAccessWidth(4);
+	BOOST_CHECK_EQUAL(backend.accessWidth(), 4);
+	BOOST_CHECK_THROW(backend.setAccessWidth(6), std::runtime_error);
+
+	BOOST_CHECK_THROW(backend.copy_to_device(200, table.data(), 64), std::out_of_range);
+	BOOST_CHECK_THROW(backend.copy_from_device(200, readBack.data(), 64), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE(unmapped_backend_single_access){
+
+	auto test = regmap::sim::Simulator("simulation.json", 64, regmap::sim::LatencyModel(), false);
+	auto &backend = test.getBackend();
+
+	unsigned char buffer[32] = {1, 2, 3, 4};
+	backend.copy_to_device(16, buffer, sizeof(buffer));
+	backend.copy_from_device(16, buffer, sizeof(buffer));
+
+	auto stats = backend.statistics();
+	BOOST_CHECK_EQUAL(stats.m_uWrites, 1);
+	BOOST_CHECK_EQUAL(stats.m_uReads, 1);
+	BOOST_CHECK_EQUAL(stats.m_uBytesRead, sizeof(buffer));
+	BOOST_CHECK_EQUAL(buffer[3], 4);
+
+	backend.setIndirection(0, 4);
+	BOOST_CHECK_THROW(backend.copy_to_device(16, buffer, sizeof(buffer)), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
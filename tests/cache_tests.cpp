@@ -0,0 +1,115 @@
+#include <thread>
+#include <chrono>
+#include <boost/test/unit_test.hpp>
+#include "sim.hpp"
+#include "cache.hpp"
+
+BOOST_AUTO_TEST_SUITE(cache_tests)
+
+
+BOOST_AUTO_TEST_CASE(read_ahead){
+
+	auto device = regmap::sim::Simulator("cache.json", 16, regmap::sim::LatencyModel::i2c(100000), false);
+	device.get<regmap::Register32_t>("id") = 0x1234;
+	device.get<regmap::Register32_t>("config") = 0x55;
+	device.get<regmap::Register16_t>("mode") = 0x3;
+	device.getBackend().resetStatistics();
+
+	auto test = regmap::cache::Cached(device, regmap::cache::Policy(16, std::chrono::seconds(60)));
+	BOOST_CHECK_EQUAL(test.get<regmap::Register32_t>("id"), 0x1234);
+	BOOST_CHECK_EQUAL(test.get<regmap::Register32_t>("config"), 0x55);
+	BOOST_CHECK_EQUAL(test.get<regmap::Register16_t>("mode"), 0x3);
+
+	// one transfer up to the volatile events register
+	auto bus = device.getBackend().statistics();
+	BOOST_CHECK_EQUAL(bus.m_uReads, 1u);
+	BOOST_CHECK_EQUAL(bus.m_uBytesRead, 10u);
+
+	auto stats = test.statistics();
+	BOOST_CHECK_EQUAL(stats.m_uMisses, 1u);
+	BOOST_CHECK_EQUAL(stats.m_uHits, 2u);
+	BOOST_CHECK_EQUAL(stats.m_uBusReads, 1u);
+	BOOST_CHECK_CLOSE(stats.hitRate(), 2.0 / 3.0, 0.001);
+	BOOST_CHECK(stats.savedTime() == stats.m_uBusTime * 2);
+
+	// the threshold register is read ahead on its own
+	BOOST_CHECK_EQUAL(test.get<regmap::Register32_t>("threshold"), 0u);
+	BOOST_CHECK_EQUAL(test.get<regmap::Register32_t>("threshold"), 0u);
+	BOOST_CHECK_EQUAL(device.getBackend().statistics().m_uReads, 2u);
+}
+
+BOOST_AUTO_TEST_CASE(volatile_bypass){
+
+	auto device = regmap::sim::Simulator("cache.json", 16, regmap::sim::LatencyModel::i2c(100000), false);
+	auto test = regmap::cache::Cached(device);
+	auto events = test.get<regmap::Register16_t>("events");
+
+	device.get<regmap::Register16_t>("events") = 0x7;
+	BOOST_CHECK_EQUAL(events, 0x7);
+	// cleared by the first read, a cache would still return 0x7
+	BOOST_CHECK_EQUAL(events, 0x0);
+
+	auto stats = test.statistics();
+	BOOST_CHECK_EQUAL(stats.m_uBypassed, 2u);
+	BOOST_CHECK_EQUAL(stats.m_uHits + stats.m_uMisses, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(time_to_live){
+
+	auto device = regmap::sim::Simulator("cache.json", 16, regmap::sim::LatencyModel::i2c(100000), false);
+	auto test = regmap::cache::Cached(device, regmap::cache::Policy(4, std::chrono::milliseconds(5)));
+	auto config = test.get<regmap::Register32_t>("config");
+	auto id = test.get<regmap::Register32_t>("id");
+
+	BOOST_CHECK_EQUAL(config, 0u);
+	BOOST_CHECK_EQUAL(id, 0u);
+	device.get<regmap::Register32_t>("config") = 0x10;
+	device.get<regmap::Register32_t>("id") = 0x20;
+	BOOST_CHECK_EQUAL(config, 0u);
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	BOOST_CHECK_EQUAL(config, 0x10);
+	// a register's "ttl_us" overrides the policy
+	BOOST_CHECK_EQUAL(id, 0u);
+
+	test.invalidate();
+	BOOST_CHECK_EQUAL(id, 0x20);
+
+	BOOST_CHECK_THROW(regmap::cache::Cached(device, regmap::cache::Policy(4, std::chrono::milliseconds(0))), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(write_invalidates){
+
+	auto device = regmap::sim::Simulator("cache.json", 16, regmap::sim::LatencyModel::i2c(100000), false);
+	auto test = regmap::cache::Cached(device, regmap::cache::Policy(16, std::chrono::seconds(60)));
+	auto config = test.get<regmap::Register32_t>("config");
+	auto mode = test.get<regmap::Register16_t>("mode");
+
+	BOOST_CHECK_EQUAL(mode, 0u);
+	config = 0xAB;
+	BOOST_CHECK_EQUAL(device.get<regmap::Register32_t>("config"), 0xAB);
+	BOOST_CHECK_EQUAL(config, 0xAB);
+	// neighbours stay cached
+	BOOST_CHECK_EQUAL(mode, 0u);
+	BOOST_CHECK_EQUAL(test.statistics().m_uHits, 1u);
+}
+
+BOOST_AUTO_TEST_CASE(beyond_the_definition){
+
+	// a large window with a few registers at its start, e.g. a PCIe BAR
+	auto device = regmap::sim::Simulator("cache.json", 1 << 20, regmap::sim::LatencyModel::i2c(100000), false);
+	auto test = regmap::cache::Cached(device, regmap::cache::Policy(16, std::chrono::seconds(60)));
+
+	device.getBackend().set<std::uint32_t>(0x80000, 0x1);
+	BOOST_CHECK_EQUAL(test.getBackend().get<std::uint32_t>(0x80000), 0x1u);
+	device.getBackend().set<std::uint32_t>(0x80000, 0x2);
+	BOOST_CHECK_EQUAL(test.getBackend().get<std::uint32_t>(0x80000), 0x2u);
+	// the register right behind the definition is not cached either
+	BOOST_CHECK_EQUAL(test.getBackend().get<std::uint16_t>(0x10), 0x0u);
+
+	auto stats = test.statistics();
+	BOOST_CHECK_EQUAL(stats.m_uBypassed, 3u);
+	BOOST_CHECK_EQUAL(stats.m_uHits + stats.m_uMisses, 0u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,112 @@
+#include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
+#include <fstream>
+
+#include "devmem.hpp"
+
+namespace fs = boost::filesystem;
+
+// a sparse regular file standing in for /dev/mem
+struct FakeDevMem {
+
+	FakeDevMem(std::uint64_t size)
+	: m_oPath(fs::temp_directory_path() / fs::unique_path("regmap-devmem-%%%%-%%%%")) {
+
+		std::ofstream(m_oPath.string());
+		fs::resize_file(m_oPath, size);
+	}
+
+	~FakeDevMem() {
+		fs::remove(m_oPath);
+	}
+
+	fs::path m_oPath;
+};
+
+BOOST_AUTO_TEST_SUITE(devmem_tests)
+
+
+BOOST_AUTO_TEST_CASE(unaligned_ranges){
+
+	const std::size_t page = regmap::devmem::MappingManager::pageSize();
+	FakeDevMem mem(8 * page);
+	regmap::devmem::MappingManager manager(mem.m_oPath.string());
+
+	auto regs = manager.map(page + 0x10, 0x20);
+	static_cast<std::uint32_t*>(regs.get())[1] = 0xAFFE;
+
+	// the file sees the write at the physical address
+	std::ifstream f(mem.m_oPath.string(), std::ios::binary);
+	std::uint32_t value = 0;
+	f.seekg(page + 0x14);
+	f.read(reinterpret_cast<char*>(&value), sizeof(value));
+	BOOST_CHECK_EQUAL(value, 0xAFFE);
+
+	// ranges crossing a page boundary
+	auto crossing = manager.map(3 * page - 8, 16);
+	static_cast<std::uint64_t*>(crossing.get())[1] = 0xDEADBEEF;
+	auto check = manager.map(3 * page, 8);
+	BOOST_CHECK_EQUAL(*static_cast<std::uint64_t*>(check.get()), 0xDEADBEEF);
+}
+
+BOOST_AUTO_TEST_CASE(shared_and_merged_mappings){
+
+	const std::size_t page = regmap::devmem::MappingManager::pageSize();
+	FakeDevMem mem(16 * page);
+	regmap::devmem::MappingManager manager(mem.m_oPath.string());
+
+	auto block1 = manager.map(2 * page + 0x100, 0x40);
+	auto block2 = manager.map(2 * page + 0x800, 0x40);
+	BOOST_CHECK_EQUAL(manager.mappings(), 1);
+	BOOST_CHECK_EQUAL(static_cast<unsigned char*>(block2.get()) - static_cast<unsigned char*>(block1.get()), 0x700);
+
+	// overlapping both the existing page and the next ones
+	auto block3 = manager.map(2 * page + 0x900, 2 * page);
+	BOOST_CHECK_EQUAL(manager.mappings(), 1);
+	static_cast<std::uint32_t*>(block2.get())[0] = 0x1234;
+	auto block4 = manager.map(2 * page + 0x800, 4);
+	BOOST_CHECK_EQUAL(*static_cast<std::uint32_t*>(block4.get()), 0x1234);
+	BOOST_CHECK_EQUAL(static_cast<unsigned char*>(block4.get()) - static_cast<unsigned char*>(block3.get()), -0x100);
+
+	auto separate = manager.map(10 * page, 4);
+	BOOST_CHECK_EQUAL(manager.mappings(), 2);
+
+	// unused mappings are released
+	separate.reset();
+	BOOST_CHECK_EQUAL(manager.mappings(), 1);
+	block1.reset(); block2.reset(); block3.reset(); block4.reset();
+	BOOST_CHECK_EQUAL(manager.mappings(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(above_4g){
+
+	const std::uint64_t base = 0x100000000ull;
+	const std::size_t page = regmap::devmem::MappingManager::pageSize();
+	FakeDevMem mem(base + 2 * page);
+	regmap::devmem::MappingManager manager(mem.m_oPath.string());
+
+	auto regs = manager.map(base + 0x20, 8);
+	*static_cast<std::uint64_t*>(regs.get()) = 0xC0FFEE;
+	auto again = manager.map(base, 0x28);
+	BOOST_CHECK_EQUAL(static_cast<std::uint64_t*>(again.get())[4], 0xC0FFEE);
+	BOOST_CHECK_EQUAL(manager.mappings(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(devmem_map){
+
+	const std::size_t page = regmap::devmem::MappingManager::pageSize();
+	FakeDevMem mem(4 * page);
+	regmap::devmem::MappingManager manager(mem.m_oPath.string());
+
+	regmap::devmem::DevMem map1(page + 0x40, page + 0x80, "simple.json", manager);
+	regmap::devmem::DevMem map2(page + 0x30, page + 0x80, "simple.json", manager);
+	BOOST_CHECK_EQUAL(manager.mappings(), 1);
+
+	auto reg = map1.get<regmap::Register32_t>("test3");
+	reg = 0xBEEF;
+	BOOST_CHECK_EQUAL(map2.getBackend().get<std::uint32_t>(reg.getOffset() + 0x10), 0xBEEF);
+
+	BOOST_CHECK_THROW(regmap::devmem::DevMem(page, page, "simple.json", manager), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,135 @@
+#include <boost/test/unit_test.hpp>
+#include <cstring>
+#include <vector>
+
+#include "RegMapMock.hpp"
+#include "fifo.hpp"
+#include "watch.hpp"
+#include "wait.hpp"
+
+BOOST_AUTO_TEST_SUITE(endian_tests)
+
+
+BOOST_AUTO_TEST_CASE(register_byte_order){
+
+	auto test = regmap::RegMapMock("endian.json", 0x20);
+	auto *memory = static_cast<unsigned char*>(test.getBackend().mapping(0, 0x20));
+	memset(memory, 0, 0x20);
+
+	BOOST_CHECK_EQUAL(test.definition()->endian(), regmap::BIG);
+	auto temperature = test.get<regmap::Register16_t>("temperature");
+	auto status = test.get<regmap::Register32_t>("status");
+	auto address = test.get<regmap::Register32_t>("dma_address");
+	BOOST_CHECK_EQUAL(temperature.getEndian(), regmap::BIG);
+	BOOST_CHECK_EQUAL(address.getEndian(), regmap::LITTLE);
+
+	temperature = 0x1234;
+	BOOST_CHECK_EQUAL(memory[2], 0x12);
+	BOOST_CHECK_EQUAL(memory[3], 0x34);
+	BOOST_CHECK_EQUAL(temperature.get(), 0x1234);
+	BOOST_CHECK_EQUAL(temperature.get() & temperature["FRACTION"], 0x4);
+
+	// the access mask applies to the host value
+	status = 0xAA010203;
+	BOOST_CHECK_EQUAL(memory[8], 0x00);
+	BOOST_CHECK_EQUAL(memory[9], 0x01);
+	BOOST_CHECK_EQUAL(memory[11], 0x03);
+	BOOST_CHECK_EQUAL(status.get(), 0x010203);
+	BOOST_CHECK(status.is_set("READY"));
+	BOOST_CHECK_EQUAL(status.try_get().value(), 0x010203);
+
+	status.clear(0x010000);
+	BOOST_CHECK_EQUAL(memory[9], 0x00);
+	BOOST_CHECK(!status.try_set(0x40));
+	BOOST_CHECK_EQUAL(memory[11], 0x40);
+
+	address = 0x11223344;
+	BOOST_CHECK_EQUAL(memory[0xC], 0x44);
+	BOOST_CHECK_EQUAL(memory[0xF], 0x11);
+
+	BOOST_CHECK_EQUAL(test.getBackend().get<std::uint16_t>(2, regmap::BIG), 0x1234);
+	test.getBackend().set<std::uint16_t>(4, 0xBEEF, regmap::BIG);
+	BOOST_CHECK_EQUAL(memory[4], 0xBE);
+}
+
+BOOST_AUTO_TEST_CASE(snapshot_swaps_in_bulk){
+
+	auto test = regmap::RegMapMock("endian.json", 0x20);
+	memset(test.getBackend().mapping(0, 0x20), 0, 0x20);
+
+	test.get<regmap::Register8_t>("id") = 0x5A;
+	test.get<regmap::Register16_t>("temperature") = 0x1234;
+	test.get<regmap::Register16_t>("humidity") = 0xABCD;
+	test.get<regmap::Register32_t>("status") = 0x00C0FFEE;
+	test.get<regmap::Register32_t>("dma_address") = 0x11223344;
+
+	for (unsigned int gap : {0u, 16u}) {
+		auto snapshot = test.dump(gap);
+		BOOST_CHECK_EQUAL(snapshot.value("id"), 0x5A);
+		BOOST_CHECK_EQUAL(snapshot.value("temperature"), 0x1234);
+		BOOST_CHECK_EQUAL(snapshot.value("humidity"), 0xABCD);
+		BOOST_CHECK_EQUAL(snapshot.value("status"), 0x00C0FFEE);
+		BOOST_CHECK_EQUAL(snapshot.value("dma_address"), 0x11223344);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(bulk_swap){
+
+	std::vector<std::uint16_t> words(37);
+	std::vector<std::uint32_t> dwords(37);
+	std::vector<std::uint64_t> qwords(37);
+	for (std::size_t i = 0; i < 37; i++) {
+		words[i] = static_cast<std::uint16_t>(0x0102 * (i + 1));
+		dwords[i] = static_cast<std::uint32_t>(0x01020304 * (i + 1));
+		qwords[i] = 0x0102030405060708ull * (i + 1);
+	}
+
+	auto w = words;
+	auto d = dwords;
+	auto q = qwords;
+	regmap::swapWords(w.data(), w.size(), 2);
+	regmap::swapWords(d.data(), d.size(), 4);
+	regmap::swapWords(q.data(), q.size(), 8);
+	for (std::size_t i = 0; i < 37; i++) {
+		BOOST_CHECK_EQUAL(w[i], __builtin_bswap16(words[i]));
+		BOOST_CHECK_EQUAL(d[i], __builtin_bswap32(dwords[i]));
+		BOOST_CHECK_EQUAL(q[i], __builtin_bswap64(qwords[i]));
+	}
+
+	BOOST_CHECK_THROW(regmap::swapWords(w.data(), 1, 3), std::runtime_error);
+	BOOST_CHECK_THROW(regmap::parseEndian("middle"), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(fifo_watch_and_wait){
+
+	auto test = regmap::RegMapMock("endian.json", 0x20);
+	auto *memory = static_cast<unsigned char*>(test.getBackend().mapping(0, 0x20));
+	memset(memory, 0, 0x20);
+
+	auto fifo = test.get<regmap::Register16_t>("fifo");
+	std::uint16_t out[3] = { 0x0102, 0x0304, 0x0506 }, in[3] = { 0, 0, 0 };
+	regmap::write_fifo(fifo, out, 3);
+	BOOST_CHECK_EQUAL(memory[0x10], 0x05);
+	BOOST_CHECK_EQUAL(memory[0x11], 0x06);
+	BOOST_CHECK_EQUAL(out[0], 0x0102);
+	regmap::read_fifo(fifo, in, 3);
+	BOOST_CHECK_EQUAL(in[2], 0x0506);
+
+	auto temperature = test.get<regmap::Register16_t>("temperature");
+	std::vector<regmap::WatchEvent> events;
+	regmap::Watcher watcher(test.getBackend());
+	watcher.watch(temperature, "FRACTION", [&events](const regmap::WatchEvent &event) { events.push_back(event); });
+	watcher.poll();
+
+	temperature = 0x0105;
+	BOOST_CHECK_EQUAL(watcher.poll(), 1);
+	BOOST_CHECK_EQUAL(events.back().m_uAfter, 5);
+
+	auto status = test.get<regmap::Register32_t>("status");
+	status = 0x010000;
+	regmap::Waiter waiter;
+	waiter.add(status, "READY", regmap::EQUAL, 1);
+	BOOST_CHECK_EQUAL(waiter.any(std::chrono::milliseconds(5)), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
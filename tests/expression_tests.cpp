@@ -0,0 +1,101 @@
+#include <boost/test/unit_test.hpp>
+
+#include "sim.hpp"
+#include "regmap_conversions.hpp"
+
+BOOST_AUTO_TEST_SUITE(expression_tests)
+
+
+BOOST_AUTO_TEST_CASE(reads_each_register_once){
+
+	auto test = regmap::sim::Simulator("simple.json", 100, regmap::sim::LatencyModel(), false);
+	auto testreg = test.get<regmap::Register32_t>("test3");
+	auto testreg2 = test.get<regmap::Register32_t>("bitmask_test");
+	auto &backend = test.getBackend();
+
+	testreg = 0xAFFE;
+	testreg2 = 0xAFFE;
+	backend.resetStatistics();
+
+	BOOST_CHECK_EQUAL((testreg & 0xF000) | (testreg & 0x000F), 0xA00E);
+	BOOST_CHECK_EQUAL(backend.statistics().m_uReads, 1u);
+
+	backend.resetStatistics();
+	BOOST_CHECK(testreg.is_set(0x2) && testreg.is_set(0x8000) && !testreg.is_set(0x1));
+	BOOST_CHECK_EQUAL(backend.statistics().m_uReads, 1u);
+
+	backend.resetStatistics();
+	BOOST_CHECK(testreg.is_set(0x1) || testreg.is_set(0x2));
+	BOOST_CHECK_EQUAL(backend.statistics().m_uReads, 1u);
+
+	backend.resetStatistics();
+	BOOST_CHECK(testreg == testreg2);
+	BOOST_CHECK(((testreg ^ testreg2) | ~testreg) == (~testreg2 & 0xFFFFFFFF));
+	BOOST_CHECK_EQUAL(backend.statistics().m_uReads, 4u);
+}
+
+BOOST_AUTO_TEST_CASE(expressions_of_temporary_registers){
+
+	auto test = regmap::sim::Simulator("simple.json", 100, regmap::sim::LatencyModel(), false);
+	test.get<regmap::Register32_t>("test3") = 0xAFFE;
+
+	// the registers are destroyed at the end of each statement
+	auto set = test.get<regmap::Register32_t>("test3").is_set(0x2);
+	auto masked = test.get<regmap::Register32_t>("test3") & 0xFF00;
+	auto both = test.get<regmap::Register32_t>("test3") & test.get<regmap::Register32_t>("bitmask_test");
+	test.get<regmap::Register32_t>("bitmask_test") = 0xFFFF;
+
+	BOOST_CHECK(set);
+	BOOST_CHECK_EQUAL(masked, 0xAF00);
+	BOOST_CHECK_EQUAL(both, 0xAFFE);
+
+	// evaluated again on every use
+	test.get<regmap::Register32_t>("test3") = 0x1200;
+	BOOST_CHECK(!set);
+	BOOST_CHECK_EQUAL(masked, 0x1200);
+}
+
+BOOST_AUTO_TEST_CASE(compound_assignment_writes_once){
+
+	auto test = regmap::sim::Simulator("simple.json", 100, regmap::sim::LatencyModel(), false);
+	auto testreg = test.get<regmap::Register32_t>("test3");
+	auto &backend = test.getBackend();
+
+	testreg = 0xAFFE;
+	backend.resetStatistics();
+
+	testreg |= (testreg & 0xF000) >> 12;
+	BOOST_CHECK_EQUAL(backend.statistics().m_uReads, 1u);
+	BOOST_CHECK_EQUAL(backend.statistics().m_uWrites, 1u);
+	BOOST_CHECK_EQUAL(testreg, 0xAFFE);
+
+	backend.resetStatistics();
+	testreg = (testreg & ~0xF000u) | 0x5000;
+	BOOST_CHECK_EQUAL(backend.statistics().m_uReads, 1u);
+	BOOST_CHECK_EQUAL(backend.statistics().m_uWrites, 1u);
+	BOOST_CHECK_EQUAL(testreg, 0x5FFE);
+
+	backend.resetStatistics();
+	BOOST_CHECK_EQUAL(testreg.apply(0x1), 0x5FFF);
+	BOOST_CHECK_EQUAL(backend.statistics().m_uReads, 1u);
+	BOOST_CHECK_EQUAL(backend.statistics().m_uWrites, 1u);
+
+	backend.resetStatistics();
+	(testreg ^= 0xF) &= 0xFF;
+	BOOST_CHECK_EQUAL(backend.statistics().m_uReads, 2u);
+	BOOST_CHECK_EQUAL(backend.statistics().m_uWrites, 2u);
+	BOOST_CHECK_EQUAL(testreg, 0xF0);
+}
+
+BOOST_AUTO_TEST_CASE(expressions_on_small_registers){
+
+	auto test = regmap::sim::Simulator("simple.json", 100, regmap::sim::LatencyModel(), false);
+	auto testreg = test.get<regmap::Register8_t>("test1");
+
+	testreg = 0x59;
+	BOOST_CHECK_EQUAL(regmap::bcd::to_dec(testreg & std::uint8_t(0x7F)), 59);
+	BOOST_CHECK_EQUAL(static_cast<std::uint8_t>(~testreg), 0xA6);
+	BOOST_CHECK_EQUAL(static_cast<std::uint8_t>(testreg << std::uint8_t(4)), 0x90);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
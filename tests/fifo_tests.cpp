@@ -0,0 +1,74 @@
+#include <boost/test/unit_test.hpp>
+#include <vector>
+#include <algorithm>
+
+#include "RegMapMock.hpp"
+#include "sim.hpp"
+#include "fifo.hpp"
+
+BOOST_AUTO_TEST_SUITE(fifo_tests)
+
+
+BOOST_AUTO_TEST_CASE(memory_fifo){
+
+	auto test = regmap::RegMapMock("fifo.json", 64);
+	auto rx = test.get<regmap::Register32_t>("rx_data");
+	auto tx = test.get<regmap::Register16_t>("tx_data");
+
+	rx = 0xAFFE;
+	std::vector<std::uint32_t> buf(16, 0);
+	regmap::read_fifo(rx, buf.data(), buf.size());
+	BOOST_CHECK(std::all_of(buf.begin(), buf.end(), [](std::uint32_t w) { return w == 0xAFFE; }));
+
+	// every word hits the same register, the access mask applies to each
+	std::vector<std::uint16_t> out = {0x101, 0x202, 0xFFFF};
+	regmap::write_fifo(tx, out.data(), out.size());
+	BOOST_CHECK_EQUAL(test.getBackend().get<std::uint16_t>(0x8), 0x1FF);
+	BOOST_CHECK_EQUAL(out[2], 0xFFFF);
+}
+
+BOOST_AUTO_TEST_CASE(level_guarded_drain){
+
+	auto test = regmap::RegMapMock("fifo.json", 64);
+	auto rx = test.get<regmap::Register32_t>("rx_data");
+	auto level = test.get<regmap::Register32_t>("rx_level");
+	rx = 0x55;
+
+	std::vector<std::uint32_t> buf(16, 0);
+	level = 5 << 8;
+	BOOST_CHECK_EQUAL(regmap::read_fifo(rx, level, buf.data(), buf.size(), 0xFF00), 5);
+	BOOST_CHECK_EQUAL(buf[4], 0x55);
+	BOOST_CHECK_EQUAL(buf[5], 0);
+
+	// never more than the buffer holds
+	level = 0xFF << 8;
+	BOOST_CHECK_EQUAL(regmap::read_fifo(rx, level, buf.data(), buf.size(), 0xFF00), 16);
+
+	level = 0;
+	BOOST_CHECK_EQUAL(regmap::read_fifo(rx, level, buf.data(), buf.size()), 0);
+}
+
+BOOST_AUTO_TEST_CASE(bus_accesses){
+
+	auto test = regmap::sim::Simulator("fifo.json", 64, regmap::sim::LatencyModel(), false);
+	auto rx = test.get<regmap::Register32_t>("rx_data");
+	auto level = test.get<regmap::Register32_t>("rx_level");
+	auto &backend = test.getBackend();
+
+	level = 12;
+	backend.resetStatistics();
+
+	std::vector<std::uint32_t> buf(32);
+	BOOST_CHECK_EQUAL(regmap::read_fifo(rx, level, buf.data(), buf.size()), 12);
+	BOOST_CHECK_EQUAL(backend.statistics().m_uReads, 13);
+	BOOST_CHECK_EQUAL(backend.statistics().m_uBytesRead, 13 * 4);
+
+	// indirect registers are addressed once for the whole burst
+	backend.setIndirection(0x10, 0x14);
+	backend.resetStatistics();
+	regmap::read_fifo(rx, buf.data(), 8);
+	BOOST_CHECK_EQUAL(backend.statistics().m_uWrites, 1);
+	BOOST_CHECK_EQUAL(backend.statistics().m_uReads, 8);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,175 @@
+#include <boost/test/unit_test.hpp>
+#include <vector>
+
+#include "indirect.hpp"
+
+BOOST_AUTO_TEST_SUITE(indirect_tests)
+
+// A MAC with two ways to reach registers behind it. PHYAR works like the
+// RTL8168's: bit 31 set starts a write, clear starts a read, the bit flips
+// once the PHY answered. The mailbox has separate command and data
+// registers and a busy bit. Both take a number of polls to complete.
+class FakeMAC : public regmap::IRegBackend {
+
+public:
+	struct State {
+		std::vector<std::uint16_t>	m_oPHY = std::vector<std::uint16_t>(32, 0);
+		std::vector<std::uint32_t>	m_oMailbox = std::vector<std::uint32_t>(256, 0);
+		unsigned int			m_uLatency = 0;
+		unsigned int			m_uPending = 0;
+		std::uint32_t			m_uPHYAR = 0;
+		std::uint32_t			m_uCommand = 0;
+		std::uint32_t			m_uData = 0;
+	};
+
+	FakeMAC() {}
+	FakeMAC(unsigned int latency) : m_pState(std::make_shared<State>()) {
+		m_pState->m_uLatency = latency;
+	}
+
+	size_t size() const {
+		return 0x100;
+	}
+
+	State& state() {
+		return *m_pState;
+	}
+
+protected:
+	void write(unsigned int offset, void* value, size_t size) {
+
+		State &s = *m_pState;
+		std::uint32_t v = 0;
+		memcpy(&v, value, size);
+
+		if (offset == 0x60) {
+			s.m_uPHYAR = v;
+			s.m_uPending = s.m_uLatency;
+			this->complete();
+		} else if (offset == 0x70) {
+			s.m_uCommand = v | 0x80000000;
+			s.m_uPending = s.m_uLatency;
+			this->complete();
+		} else if (offset == 0x74) {
+			s.m_uData = v;
+		}
+	}
+
+	void read(unsigned int offset, void* value, size_t size) {
+
+		State &s = *m_pState;
+		if (s.m_uPending && !--s.m_uPending)
+			this->complete();
+
+		std::uint32_t words[2] = {0, 0};
+		if (offset == 0x60) {
+			words[0] = s.m_uPHYAR;
+		} else if (offset == 0x70) {
+			words[0] = s.m_uCommand;
+			words[1] = s.m_uData;
+		} else if (offset == 0x74) {
+			words[0] = s.m_uData;
+		}
+		memcpy(value, words, size);
+	}
+
+	void complete() {
+
+		State &s = *m_pState;
+		if (s.m_uPending)
+			return;
+
+		unsigned int phy = (s.m_uPHYAR >> 16) & 0x1F;
+		if (s.m_uPHYAR & 0x80000000) {
+			s.m_oPHY[phy] = s.m_uPHYAR & 0xFFFF;
+			s.m_uPHYAR &= ~0x80000000u;
+		} else {
+			s.m_uPHYAR = (s.m_uPHYAR & 0xFFFF0000) | s.m_oPHY[phy] | 0x80000000;
+		}
+
+		if (s.m_uCommand & 0x80000000) {
+			unsigned int reg = s.m_uCommand & 0xFF;
+			if (s.m_uCommand & 0x40000000)
+				s.m_oMailbox[reg] = s.m_uData;
+			else
+				s.m_uData = s.m_oMailbox[reg];
+			s.m_uCommand &= ~0x80000000u;
+		}
+	}
+
+	std::shared_ptr<State> m_pState;
+};
+
+class MAC : public regmap::RegMapBase<FakeMAC> {
+
+public:
+	MAC(unsigned int latency)
+	: RegMapBase("indirect_mac.json") {
+		this->setBackend(FakeMAC(latency));
+	}
+};
+
+
+BOOST_AUTO_TEST_CASE(combined_command_and_data){
+
+	MAC mac(3);
+	mac.getBackend().state().m_oPHY[1] = 0x796D;
+	mac.getBackend().state().m_oPHY[2] = 0x001C;
+
+	regmap::indirect::Indirect phy(mac, "indirect_phy.json");
+	auto bmsr = phy.get<regmap::Register16_t>("BMSR");
+	BOOST_CHECK(bmsr.is_set("LINK_STATUS"));
+	BOOST_CHECK_EQUAL(phy.get<regmap::Register16_t>("PHYID1").get(), 0x001C);
+
+	// one command write, the polls return the data
+	auto &backend = phy.getBackend();
+	auto before = backend.statistics();
+	bmsr.get();
+	BOOST_CHECK_EQUAL(backend.statistics().m_uParentAccesses - before.m_uParentAccesses, 1 + 3);
+
+	auto bmcr = phy.get<regmap::Register16_t>("BMCR");
+	bmcr.apply(bmcr["AUTONEG_ENABLE"]);
+	BOOST_CHECK_EQUAL(mac.getBackend().state().m_oPHY[0], 0x1000);
+
+	std::vector<unsigned int> addresses = {0, 1, 2, 3};
+	std::vector<std::uint32_t> values(4);
+	backend.read_many(addresses.data(), values.data(), values.size());
+	BOOST_CHECK_EQUAL(values[1], 0x796D);
+	BOOST_CHECK_EQUAL(backend.statistics().m_uHandshakes - before.m_uHandshakes, 1 + 2 + 4);
+
+	// 5 address bits
+	BOOST_CHECK_THROW(backend.get<std::uint16_t>(32), std::out_of_range);
+	BOOST_CHECK_EQUAL(backend.size(), 31 + 2);
+	BOOST_CHECK_THROW(regmap::indirect::Indirect(mac, "indirect_phy_overflow.json"), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE(mailbox){
+
+	MAC mac(2);
+	mac.getBackend().state().m_oMailbox[0] = 0x01020304;
+	regmap::indirect::Indirect mailbox(mac, "indirect_mailbox.json");
+
+	auto &backend = mailbox.getBackend();
+	BOOST_CHECK_EQUAL(mailbox.get<regmap::Register32_t>("VERSION").get(), 0x01020304);
+	// command and data are adjacent, every poll reads both at once
+	BOOST_CHECK_EQUAL(backend.statistics().m_uParentAccesses, 1 + 2);
+
+	mailbox.get<regmap::Register32_t>("SCRATCH") = 0xAFFEAFFE;
+	BOOST_CHECK_EQUAL(mac.getBackend().state().m_oMailbox[1], 0xAFFEAFFE);
+	BOOST_CHECK_EQUAL(backend.statistics().m_uParentAccesses, 3 + 2 + 2);
+}
+
+BOOST_AUTO_TEST_CASE(timeouts){
+
+	MAC mac(1000000);
+	regmap::indirect::Indirect phy(mac, "indirect_phy.json");
+
+	auto start = std::chrono::steady_clock::now();
+	BOOST_CHECK(phy.getBackend().try_get<std::uint16_t>(1).error() == std::errc::timed_out);
+	BOOST_CHECK(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(2));
+	BOOST_CHECK_THROW(phy.get<regmap::Register16_t>("BMSR").get(), std::system_error);
+
+	BOOST_CHECK_THROW(regmap::indirect::Indirect(mac, "simple.json"), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,104 @@
+#include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
+#include <fstream>
+
+#include "pci.hpp"
+
+namespace fs = boost::filesystem;
+
+// a minimal /sys/bus/pci/devices tree in a temporary directory
+struct FakeSysFS {
+
+	FakeSysFS()
+	: m_oRoot(fs::temp_directory_path() / fs::unique_path("regmap-pci-%%%%-%%%%")) {
+
+		fs::create_directories(m_oRoot);
+		this->addDevice("0000:03:00.0", "0x8086", "0x1533", "0x020000");
+		this->addDevice("0000:01:00.0", "0x8086", "0x1533", "0x020000");
+		this->addDevice("0000:1a:00.1", "0x10ee", "0x7021", "0x058000");
+	}
+
+	~FakeSysFS() {
+		fs::remove_all(m_oRoot);
+	}
+
+	void addDevice(const std::string &name, const std::string &vendor, const std::string &device, const std::string &cls) {
+
+		fs::path dir = m_oRoot / name;
+		fs::create_directories(dir);
+		std::ofstream((dir / "vendor").string()) << vendor << "\n";
+		std::ofstream((dir / "device").string()) << device << "\n";
+		std::ofstream((dir / "class").string()) << cls << "\n";
+	}
+
+	fs::path m_oRoot;
+};
+
+BOOST_AUTO_TEST_SUITE(pci_enumeration_tests)
+
+
+BOOST_AUTO_TEST_CASE(find_by_id_and_instance){
+
+	FakeSysFS sysfs;
+	regmap::pci::PCIEnumerator enumerator(sysfs.m_oRoot.string());
+	regmap::pci::PCIDevice device;
+
+	// instances are counted in bdf order
+	BOOST_CHECK(enumerator.find(regmap::pci::PCI_ID(0x8086, 0x1533), 1, device));
+	BOOST_CHECK_EQUAL(device.m_oBDF.m_uBus, 0x01);
+	BOOST_CHECK_EQUAL(device.m_uInstance, 1);
+	BOOST_CHECK_EQUAL(device.m_sSysFSPath, sysfs.m_oRoot.string() + "/0000:01:00.0/");
+
+	BOOST_CHECK(enumerator.find(regmap::pci::PCI_ID(0x8086, 0x1533), 2, device));
+	BOOST_CHECK_EQUAL(device.m_oBDF.m_uBus, 0x03);
+	BOOST_CHECK_EQUAL(device.m_uInstance, 2);
+
+	BOOST_CHECK(!enumerator.find(regmap::pci::PCI_ID(0x8086, 0x1533), 3, device));
+	BOOST_CHECK(!enumerator.find(regmap::pci::PCI_ID(0x8086, 0x1533), 0, device));
+	BOOST_CHECK(!enumerator.find(regmap::pci::PCI_ID(0x1234, 0x5678), 1, device));
+}
+
+BOOST_AUTO_TEST_CASE(find_by_bdf_and_class){
+
+	FakeSysFS sysfs;
+	regmap::pci::PCIEnumerator enumerator(sysfs.m_oRoot.string());
+	regmap::pci::PCIDevice device;
+
+	BOOST_CHECK(enumerator.find(regmap::pci::BDF(0x1a, 0, 1), device));
+	BOOST_CHECK_EQUAL(device.m_uVendor, 0x10ee);
+	BOOST_CHECK_EQUAL(device.m_uDevice, 0x7021);
+	BOOST_CHECK_EQUAL(device.m_uClass, 0x058000);
+	BOOST_CHECK(!enumerator.find(regmap::pci::BDF(0x1a, 0, 0), device));
+
+	BOOST_CHECK_EQUAL(enumerator.findByClass(0x020000).size(), 2);
+	BOOST_CHECK_EQUAL(enumerator.findByClass(0x050000, 0xFF0000).size(), 1);
+	BOOST_CHECK_EQUAL(enumerator.devices().size(), 3);
+}
+
+BOOST_AUTO_TEST_CASE(refresh_picks_up_changes){
+
+	FakeSysFS sysfs;
+	regmap::pci::PCIEnumerator enumerator(sysfs.m_oRoot.string());
+	regmap::pci::PCIDevice device;
+
+	BOOST_CHECK_EQUAL(enumerator.devices().size(), 3);
+
+	// the index is kept until refreshed
+	sysfs.addDevice("0000:00:1f.0", "0x8086", "0x1533", "0x020000");
+	BOOST_CHECK_EQUAL(enumerator.devices().size(), 3);
+
+	enumerator.refresh();
+	BOOST_CHECK_EQUAL(enumerator.devices().size(), 4);
+	BOOST_CHECK(enumerator.find(regmap::pci::PCI_ID(0x8086, 0x1533), 1, device));
+	BOOST_CHECK_EQUAL(device.m_oBDF.m_uDevice, 0x1f);
+	BOOST_CHECK(enumerator.find(regmap::pci::PCI_ID(0x8086, 0x1533), 3, device));
+	BOOST_CHECK_EQUAL(device.m_oBDF.m_uBus, 0x03);
+}
+
+BOOST_AUTO_TEST_CASE(missing_root){
+
+	regmap::pci::PCIEnumerator enumerator("/nonexistent/regmap/sysfs");
+	BOOST_CHECK(enumerator.devices().empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
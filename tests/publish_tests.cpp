@@ -0,0 +1,154 @@
+#include <boost/test/unit_test.hpp>
+#include <cstring>
+#include <thread>
+#include <unistd.h>
+
+#include "RegMapMock.hpp"
+#include "publish.hpp"
+
+BOOST_AUTO_TEST_SUITE(publish_tests)
+
+static std::string segmentPath() {
+	return "/tmp/regmap_publish_test_" + std::to_string(getpid());
+}
+
+
+BOOST_AUTO_TEST_CASE(publish_and_read){
+
+	auto device = regmap::RegMapMock("simple.json", 100);
+	auto layout = regmap::select(device.definition()->layout(), {"test3", "test1"});
+	BOOST_CHECK_THROW(regmap::select(device.definition()->layout(), {"missing"}), std::runtime_error);
+
+	regmap::Publisher publisher(segmentPath(), layout, device.getBackend());
+	regmap::Subscriber subscriber(segmentPath());
+	BOOST_REQUIRE_EQUAL(subscriber.layout()->size(), 2);
+	BOOST_CHECK_EQUAL(subscriber.layout()->at(0).m_sName, "test1");
+
+	regmap::Sample sample;
+	BOOST_CHECK(!subscriber.read(sample));
+
+	device.get<regmap::Register8_t>("test1") = 0x11;
+	device.get<regmap::Register32_t>("test3") = 0xAFFE;
+	publisher.publish();
+
+	BOOST_CHECK(subscriber.read(sample));
+	BOOST_CHECK_EQUAL(sample.m_uGeneration, 1);
+	BOOST_CHECK_EQUAL(sample.m_oValues[subscriber.index("test1")], 0x11);
+	BOOST_CHECK_EQUAL(sample.m_oValues[subscriber.index("test3")], 0xAFFE);
+	BOOST_CHECK(sample.age() < std::chrono::seconds(1));
+	BOOST_CHECK_EQUAL(subscriber.snapshot(sample).value("test3"), 0xAFFE);
+
+	// readers see the device state of the last publication only
+	device.get<regmap::Register32_t>("test3") = 0xBEEF;
+	BOOST_CHECK(subscriber.read(sample));
+	BOOST_CHECK_EQUAL(sample.m_oValues[1], 0xAFFE);
+	publisher.publish();
+	BOOST_CHECK(subscriber.read(sample));
+	BOOST_CHECK_EQUAL(sample.m_oValues[1], 0xBEEF);
+	BOOST_CHECK_EQUAL(sample.m_uGeneration, 2);
+}
+
+BOOST_AUTO_TEST_CASE(periodic_publications){
+
+	auto device = regmap::RegMapMock("simple.json", 100);
+	auto layout = regmap::select(device.definition()->layout(), {"test1"});
+	regmap::Publisher publisher(segmentPath(), layout, device.getBackend());
+	regmap::Subscriber subscriber(segmentPath());
+
+	publisher.start(std::chrono::milliseconds(1));
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	publisher.stop();
+
+	regmap::Sample sample;
+	BOOST_CHECK(subscriber.read(sample));
+	BOOST_CHECK(sample.m_uGeneration > 5);
+	BOOST_CHECK_EQUAL(publisher.errors(), 0);
+}
+
+// counts the reads of the publications
+class CountingBackend : public regmap::IRegBackend {
+
+public:
+	CountingBackend() : m_uReads(0) { memset(m_aMemory, 0, sizeof(m_aMemory)); }
+
+	size_t size() const {
+		return sizeof(m_aMemory);
+	}
+
+	unsigned char			m_aMemory[100];
+	std::atomic<std::uint64_t>	m_uReads;
+
+protected:
+	void write(unsigned int offset, void* value, size_t size) {
+		memcpy(m_aMemory + offset, value, size);
+	}
+
+	void read(unsigned int offset, void* value, size_t size) {
+		m_uReads++;
+		memcpy(value, m_aMemory + offset, size);
+	}
+};
+
+BOOST_AUTO_TEST_CASE(manual_and_periodic_publications){
+
+	auto definition = regmap::RegMapDefinition::load("simple.json");
+	CountingBackend backend;
+	regmap::Publisher publisher(segmentPath(), regmap::select(definition->layout(), {"test1"}), backend);
+	regmap::Subscriber subscriber(segmentPath());
+
+	// both writers count every publication
+	publisher.start(std::chrono::microseconds(10));
+	for (int i = 0; i < 5000; i++)
+		publisher.publish();
+	publisher.stop();
+
+	regmap::Sample sample;
+	BOOST_CHECK(subscriber.read(sample));
+	BOOST_CHECK(sample.m_uGeneration > 5000);
+	BOOST_CHECK_EQUAL(sample.m_uGeneration, backend.m_uReads);
+}
+
+BOOST_AUTO_TEST_CASE(consistent_snapshots){
+
+	auto device = regmap::RegMapMock("simple.json", 100);
+	auto &backend = device.getBackend();
+	auto layout = regmap::select(device.definition()->layout(), {"test1", "test2", "test3"});
+	regmap::Publisher publisher(segmentPath(), layout, backend);
+	regmap::Subscriber subscriber(segmentPath());
+
+	// every publication fills all registers with the same byte, torn reads
+	// would mix bytes of different publications
+	std::atomic<bool> done(false);
+	std::thread writer([&]() {
+		for (unsigned int i = 0; i < 20000; i++) {
+			std::uint8_t byte = i;
+			backend.set<std::uint8_t>(0, byte);
+			backend.set<std::uint16_t>(1, byte * 0x101);
+			backend.set<std::uint32_t>(3, byte * 0x01010101u);
+			publisher.publish();
+		}
+		done = true;
+	});
+
+	std::atomic<unsigned int> torn(0);
+	std::vector<std::thread> readers;
+	for (int r = 0; r < 4; r++) {
+		readers.emplace_back([&]() {
+			regmap::Sample sample;
+			while (!done) {
+				if (!subscriber.read(sample))
+					continue;
+				std::uint32_t byte = sample.m_oValues[0];
+				if (sample.m_oValues[1] != byte * 0x101 || sample.m_oValues[2] != byte * 0x01010101u)
+					torn++;
+			}
+		});
+	}
+
+	writer.join();
+	for (auto &reader : readers)
+		reader.join();
+	BOOST_CHECK_EQUAL(torn, 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
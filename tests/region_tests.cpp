@@ -0,0 +1,84 @@
+#include <boost/test/unit_test.hpp>
+#include <vector>
+
+#include "RegMapMock.hpp"
+#include "sim.hpp"
+
+BOOST_AUTO_TEST_SUITE(region_tests)
+
+
+BOOST_AUTO_TEST_CASE(region_definitions){
+
+	auto definition = regmap::RegMapDefinition::load("regions.json");
+	BOOST_CHECK_EQUAL(definition->regions().size(), 3);
+
+	auto &lut = definition->regions().at("lut");
+	BOOST_CHECK_EQUAL(lut.m_uOffset, 0x80);
+	BOOST_CHECK_EQUAL(lut.m_uSize, 0x80);
+	BOOST_CHECK_EQUAL(lut.m_uWidth, 4);
+	BOOST_CHECK_EQUAL(definition->regions().at("packet_buffer").m_uWidth, 1);
+
+	auto test = regmap::RegMapMock(definition, 0x200);
+	BOOST_CHECK_THROW(test.region("fifo"), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(mapped_span){
+
+	auto test = regmap::RegMapMock("regions.json", 0x200);
+	auto lut = test.region("lut");
+	BOOST_CHECK(lut.mapped());
+
+	auto span = lut.span<std::uint32_t>();
+	BOOST_CHECK_EQUAL(span.size(), 0x20);
+	for (std::size_t i = 0; i < span.size(); i++)
+		span[i] = 0x1000 + i;
+
+	// the span is the device memory itself
+	BOOST_CHECK_EQUAL(test.getBackend().get<std::uint32_t>(0x80 + 4 * 7), 0x1007);
+	BOOST_CHECK_EQUAL(lut.get<std::uint32_t>(31), 0x101F);
+	BOOST_CHECK_THROW(span[0x20], std::out_of_range);
+	BOOST_CHECK_THROW(lut.get<std::uint32_t>(0x20), std::out_of_range);
+	BOOST_CHECK_THROW(lut.span<std::uint16_t>(), std::runtime_error);
+
+	std::vector<std::uint32_t> copy = lut.buffer<std::uint32_t>();
+	BOOST_CHECK_EQUAL(copy.size(), 0x20);
+	BOOST_CHECK_EQUAL(copy[12], 0x100C);
+}
+
+BOOST_AUTO_TEST_CASE(mapped_bulk){
+
+	auto test = regmap::RegMapMock("regions.json", 0x200);
+	auto buffer = test.region("packet_buffer");
+
+	const char packet[] = "libregmap packet";
+	buffer.write(3, packet, sizeof(packet));
+
+	char readBack[sizeof(packet)];
+	buffer.read(3, readBack, sizeof(readBack));
+	BOOST_CHECK_EQUAL(std::string(readBack), std::string(packet));
+	BOOST_CHECK_EQUAL(buffer.get<std::uint8_t>(3), 'l');
+
+	BOOST_CHECK_THROW(buffer.write(0x30, packet, sizeof(packet)), std::out_of_range);
+	BOOST_CHECK_THROW(buffer.read(0x41, readBack, 1), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE(unmapped_fallback){
+
+	auto test = regmap::sim::Simulator("regions.json", 0x200, regmap::sim::LatencyModel(), false);
+	auto mailbox = test.region("mailbox");
+	BOOST_CHECK(!mailbox.mapped());
+	BOOST_CHECK_THROW(mailbox.span<std::uint64_t>(), std::runtime_error);
+
+	mailbox.set<std::uint64_t>(2, 0xDEADBEEFAFFE0000ull);
+	BOOST_CHECK_EQUAL(test.getBackend().get<std::uint64_t>(0x110), 0xDEADBEEFAFFE0000ull);
+	BOOST_CHECK_EQUAL(mailbox.get<std::uint64_t>(2), 0xDEADBEEFAFFE0000ull);
+
+	// buffered reads of the whole region in one transfer
+	test.getBackend().resetStatistics();
+	std::vector<std::uint64_t> content = mailbox.buffer<std::uint64_t>();
+	BOOST_CHECK_EQUAL(content.size(), 4);
+	BOOST_CHECK_EQUAL(content[2], 0xDEADBEEFAFFE0000ull);
+	BOOST_CHECK_EQUAL(test.getBackend().statistics().m_uReads, 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
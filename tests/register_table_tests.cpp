@@ -0,0 +1,114 @@
+#include <boost/test/unit_test.hpp>
+#include <algorithm>
+
+#include "RegMapMock.hpp"
+
+BOOST_AUTO_TEST_SUITE(register_table_tests)
+
+
+BOOST_AUTO_TEST_CASE(offset_order){
+
+	auto definition = regmap::RegMapDefinition::load("simple.json");
+	auto &table = definition->registers().m_oRegisters;
+
+	BOOST_CHECK(!table.empty());
+	BOOST_CHECK(std::is_sorted(table.begin(), table.end(), [](const regmap::RegisterEntry &a, const regmap::RegisterEntry &b) {
+		return a.m_uOffset < b.m_uOffset;
+	}));
+
+	// the index points to the right entries after sorting
+	for (auto &entry : table)
+		BOOST_CHECK_EQUAL(definition->registers().find(entry.m_pName), &entry);
+	BOOST_CHECK(definition->registers().find("nonexistent") == NULL);
+}
+
+BOOST_AUTO_TEST_CASE(range_queries){
+
+	regmap::RegisterBlock block;
+	block.insert("c", 0x8, 4);
+	block.insert("a", 0x0, 4);
+	block.insert("d", 0xC, 2);
+	block.insert("b", 0x4, 4);
+	block.insert("a", 0x2, 2);
+	block.seal();
+
+	// duplicates replace the earlier register
+	BOOST_CHECK_EQUAL(block.m_oRegisters.size(), 4);
+	BOOST_CHECK_EQUAL(block.find("a")->m_uOffset, 0x2);
+
+	auto range = block.range(0x4, 0xC);
+	BOOST_CHECK_EQUAL(std::distance(range.first, range.second), 2);
+	BOOST_CHECK_EQUAL(range.first->m_pName, "b");
+	BOOST_CHECK_EQUAL((range.first + 1)->m_pName, "c");
+
+	range = block.range(0x0, 0x100);
+	BOOST_CHECK_EQUAL(std::distance(range.first, range.second), 4);
+	range = block.range(0xD, 0x100);
+	BOOST_CHECK(range.first == range.second);
+	range = block.range(0x8, 0x4);
+	BOOST_CHECK(range.first == range.second);
+}
+
+BOOST_AUTO_TEST_CASE(map_ranges){
+
+	auto test = regmap::RegMapMock("arrays.json", 0x200);
+	// the iterators point into the definition, keep it while using them
+	auto definition = test.definition();
+	auto range = definition->registers().range(0, 0x100);
+
+	// arrays are not part of the top level table
+	BOOST_CHECK_EQUAL(std::distance(range.first, range.second), 1);
+	BOOST_CHECK_EQUAL(range.first->m_pName, "ctrl");
+	auto ctrl = test.get<regmap::Register32_t>(range.first->m_pName);
+	BOOST_CHECK_EQUAL(ctrl.getOffset(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(shared_descriptors){
+
+	auto test = regmap::RegMapMock("descriptors.json", 0x10);
+
+	// registers with the same bitmasks share one table, in any order
+	auto ch0 = test.get<regmap::Register32_t>("CH0_STATUS");
+	auto ch1 = test.get<regmap::Register32_t>("CH1_STATUS");
+	BOOST_CHECK_EQUAL(&ch0.getBitmasks(), &ch1.getBitmasks());
+	BOOST_CHECK_EQUAL(&ch0.getBitmasks(), &test.get<regmap::Register32_t>("CH0_STATUS").getBitmasks());
+	BOOST_CHECK_EQUAL(ch1["ERROR"], 0x2);
+
+	// masks are cut to the register width
+	auto config = test.get<regmap::Register16_t>("CH1_CONFIG");
+	BOOST_CHECK(&config.getBitmasks() != &ch0.getBitmasks());
+	BOOST_CHECK_EQUAL(config["DONE"], 0x1);
+
+	// changes copy the table, other registers keep the shared one
+	const regmap::BitmaskTable *shared = &ch0.getBitmasks();
+	ch1.addBitmask("BUSY", 0x4);
+	BOOST_CHECK_EQUAL(ch1.getBitmasks().size(), 3);
+	BOOST_CHECK_EQUAL(ch1["BUSY"], 0x4);
+	BOOST_CHECK_EQUAL(&ch0.getBitmasks(), shared);
+	BOOST_CHECK_EQUAL(shared->size(), 2);
+	BOOST_CHECK_THROW(ch1.addBitmask("DONE", 0x8), std::runtime_error);
+
+	// registers without bitmasks have an empty table
+	auto ctrl = test.get<regmap::Register32_t>("ctrl");
+	BOOST_CHECK(ctrl.getBitmasks().empty());
+	BOOST_CHECK_THROW(ctrl["DONE"], std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(string_pool){
+
+	regmap::StringPool pool;
+	const char *a = pool.intern("HW_PINCTRL_CTRL");
+	BOOST_CHECK_EQUAL(a, pool.intern(std::string("HW_PINCTRL_CTRL")));
+	BOOST_CHECK(a != pool.intern("HW_PINCTRL_DEBUG"));
+	BOOST_CHECK_EQUAL(std::string(a), "HW_PINCTRL_CTRL");
+
+	// names larger than a block get one of their own
+	std::string large(100000, 'x');
+	const char *b = pool.intern(large);
+	BOOST_CHECK_EQUAL(std::string(b), large);
+	pool.seal();
+	BOOST_CHECK_EQUAL(std::string(a), "HW_PINCTRL_CTRL");
+	BOOST_CHECK(pool.capacity() >= large.size());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
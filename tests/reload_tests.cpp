@@ -0,0 +1,167 @@
+#include <boost/test/unit_test.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <unistd.h>
+
+#include "RegMapMock.hpp"
+
+BOOST_AUTO_TEST_SUITE(reload_tests)
+
+static std::string definitionPath() {
+	return "/tmp/regmap_reload_test_" + std::to_string(getpid()) + ".json";
+}
+
+// replaces the file like an editor does, through a rename
+static void writeDefinition(const std::string &path, const std::string &content) {
+
+	std::string temporary = path + ".tmp";
+	{
+		std::ofstream file(temporary);
+		file << content;
+	}
+	std::rename(temporary.c_str(), path.c_str());
+}
+
+static const char *VERSION1 =
+	"{ \"registers\": {"
+	"  \"control\": { \"offset\": \"0x0\", \"size\": \"4\", \"bitmasks\": { \"ENABLE\": \"0x1\" } },"
+	"  \"QUEUE[4]\": { \"offset\": \"0x10\", \"stride\": \"0x8\", \"registers\": {"
+	"    \"HEAD\": { \"offset\": \"0x0\", \"size\": \"4\" } } }"
+	"} }";
+
+static const char *VERSION2 =
+	"{ \"registers\": {"
+	"  \"control\": { \"offset\": \"0x0\", \"size\": \"4\", \"bitmasks\": { \"ENABLE\": \"0x1\", \"RESET\": \"0x80000000\" } },"
+	"  \"status\": { \"offset\": \"0x4\", \"size\": \"4\" },"
+	"  \"QUEUE[4]\": { \"offset\": \"0x10\", \"stride\": \"0x8\", \"registers\": {"
+	"    \"HEAD\": { \"offset\": \"0x0\", \"size\": \"4\" },"
+	"    \"TAIL\": { \"offset\": \"0x4\", \"size\": \"4\" } } }"
+	"} }";
+
+
+BOOST_AUTO_TEST_CASE(reload_swaps_the_definition){
+
+	std::string path = definitionPath();
+	writeDefinition(path, VERSION1);
+
+	auto test = regmap::RegMapMock(path, 0x40);
+	auto before = test.definition();
+	std::weak_ptr<const regmap::RegMapDefinition> weak = before;
+	{
+		auto control = test.get<regmap::Register32_t>("control");
+		auto queues = test.array("QUEUE");
+		BOOST_CHECK_THROW(test.get<regmap::Register32_t>("status"), std::runtime_error);
+		BOOST_CHECK_THROW(control["RESET"], std::runtime_error);
+
+		writeDefinition(path, VERSION2);
+		auto after = test.reload();
+		BOOST_CHECK(after != before);
+		BOOST_CHECK(test.definition() == after);
+		BOOST_CHECK_EQUAL(test.reloads(), 1);
+
+		// new registers and bitmasks are there, handles taken before still work
+		test.get<regmap::Register32_t>("status") = 0x55;
+		BOOST_CHECK_EQUAL(test.get<regmap::Register32_t>("status").get(), 0x55);
+		BOOST_CHECK_EQUAL(test.get<regmap::Register32_t>("control")["RESET"], 0x80000000);
+		test.array("QUEUE")[3].get<regmap::Register32_t>("TAIL") = 0x77;
+
+		control = 0x1;
+		BOOST_CHECK_EQUAL(test.get<regmap::Register32_t>("control").get(), 0x1);
+		queues[2].get<regmap::Register32_t>("HEAD") = 0x12;
+		BOOST_CHECK_EQUAL(test.array("QUEUE")[2].get<regmap::Register32_t>("HEAD").get(), 0x12);
+		BOOST_CHECK_THROW(queues[3].get<regmap::Register32_t>("TAIL"), std::runtime_error);
+
+		// the replaced definition lives on while it is referenced, the
+		// handles taken from it share its names
+		before.reset();
+		queues = test.array("QUEUE");
+		BOOST_CHECK(!weak.expired());
+		BOOST_CHECK_EQUAL(control.getName(), "control");
+	}
+	BOOST_CHECK(weak.expired());
+
+	unlink(path.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(rejected_definitions_are_not_swapped_in){
+
+	std::string path = definitionPath();
+	writeDefinition(path, VERSION1);
+	auto test = regmap::RegMapMock(path, 0x30);
+	auto current = test.definition();
+
+	writeDefinition(path, "{ \"registers\": { ");
+	BOOST_CHECK_THROW(test.reload(), std::runtime_error);
+
+	// the queue block grows beyond the backend
+	writeDefinition(path, std::string(VERSION2).replace(std::string(VERSION2).find("QUEUE[4]"), 8, "QUEUE[8]"));
+	BOOST_CHECK_THROW(test.reload(), std::out_of_range);
+
+	BOOST_CHECK(test.definition() == current);
+	BOOST_CHECK_EQUAL(test.reloads(), 0);
+	unlink(path.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(auto_reload_while_reading){
+
+	std::string path = definitionPath();
+	writeDefinition(path, VERSION1);
+	auto test = regmap::RegMapMock(path, 0x40);
+
+	std::mutex mutex;
+	std::condition_variable cv;
+	std::vector<bool> results;
+	test.autoReload([&](const regmap::Definition_t &definition, std::exception_ptr error) {
+		std::lock_guard<std::mutex> lock(mutex);
+		results.push_back(definition && !error);
+		cv.notify_all();
+	});
+
+	// readers look up registers all the time, reloads never stop them
+	std::atomic<bool> stop(false);
+	std::atomic<std::uint64_t> lookups(0);
+	std::vector<std::thread> readers;
+	for (int i = 0; i < 4; i++) {
+		readers.emplace_back([&]() {
+			while (!stop) {
+				test.get<regmap::Register32_t>("control").get();
+				test.array("QUEUE")[1].get<regmap::Register32_t>("HEAD").get();
+				lookups++;
+			}
+		});
+	}
+
+	auto waitFor = [&](std::size_t count) {
+		std::unique_lock<std::mutex> lock(mutex);
+		return cv.wait_for(lock, std::chrono::seconds(5), [&]() { return results.size() >= count; });
+	};
+
+	writeDefinition(path, VERSION2);
+	BOOST_REQUIRE(waitFor(1));
+	BOOST_CHECK(results[0]);
+	BOOST_CHECK_NO_THROW(test.get<regmap::Register32_t>("status"));
+
+	writeDefinition(path, "not json");
+	BOOST_REQUIRE(waitFor(2));
+	BOOST_CHECK(!results[1]);
+	BOOST_CHECK_NO_THROW(test.get<regmap::Register32_t>("status"));
+
+	writeDefinition(path, VERSION1);
+	BOOST_REQUIRE(waitFor(3));
+	BOOST_CHECK_THROW(test.get<regmap::Register32_t>("status"), std::runtime_error);
+
+	stop = true;
+	for (auto &reader : readers)
+		reader.join();
+	BOOST_CHECK(lookups > 0);
+	BOOST_CHECK_EQUAL(test.reloads(), 2);
+
+	test.stopReload();
+	unlink(path.c_str());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
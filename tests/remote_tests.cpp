@@ -0,0 +1,183 @@
+#include <boost/test/unit_test.hpp>
+#include <unistd.h>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "RegMapMock.hpp"
+#include "remote.hpp"
+
+BOOST_AUTO_TEST_SUITE(remote_tests)
+
+static std::string socketPath() {
+	return "/tmp/regmapd_test_" + std::to_string(getpid()) + ".sock";
+}
+
+
+BOOST_AUTO_TEST_CASE(register_accesses){
+
+	auto device = regmap::RegMapMock("simple.json", 100);
+	regmap::remote::Server server(socketPath());
+	server.add("mock", device.getBackend());
+	server.start();
+
+	regmap::remote::Remote client(socketPath(), "mock", "simple.json");
+	BOOST_CHECK_EQUAL(client.getBackend().size(), 100);
+
+	auto test3 = client.get<regmap::Register32_t>("test3");
+	test3 = 0xDEADAFFE;
+	BOOST_CHECK_EQUAL(device.get<regmap::Register32_t>("test3").get(), 0xDEADAFFE);
+
+	device.get<regmap::Register16_t>("test2") = 0x1234;
+	BOOST_CHECK_EQUAL(client.get<regmap::Register16_t>("test2").get(), 0x1234);
+
+	// snapshots of the whole map are transferred in a single round trip
+	auto before = client.getBackend().roundTrips();
+	auto snapshot = client.dump(16);
+	BOOST_CHECK_EQUAL(client.getBackend().roundTrips() - before, 1);
+	BOOST_CHECK(regmap::diff(snapshot, device.dump()).empty());
+}
+
+BOOST_AUTO_TEST_CASE(stalled_handshake){
+
+	auto device = regmap::RegMapMock("simple.json", 100);
+	regmap::remote::Server server(socketPath());
+	server.add("mock", device.getBackend());
+	server.start();
+
+	// connects and never sends the name of a map
+	int stalled = socket(AF_UNIX, SOCK_STREAM, 0);
+	sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, socketPath().c_str(), sizeof(addr.sun_path) - 1);
+	BOOST_REQUIRE_EQUAL(connect(stalled, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+	usleep(10000);
+
+	auto start = std::chrono::steady_clock::now();
+	regmap::remote::Remote client(socketPath(), "mock", "simple.json");
+	for (int i = 0; i < 10; i++)
+		client.get<regmap::Register32_t>("test3") = i;
+	BOOST_CHECK(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(500));
+
+	// dropped once the handshake timed out
+	char byte;
+	timeval timeout = {5, 0};
+	setsockopt(stalled, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	BOOST_CHECK_EQUAL(recv(stalled, &byte, 1, 0), 0);
+	close(stalled);
+}
+
+BOOST_AUTO_TEST_CASE(client_not_reading_answers){
+
+	auto device = regmap::RegMapMock("simple.json", 100);
+	regmap::remote::Server server(socketPath());
+	server.add("mock", device.getBackend());
+	server.start();
+
+	int greedy = socket(AF_UNIX, SOCK_STREAM, 0);
+	sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, socketPath().c_str(), sizeof(addr.sun_path) - 1);
+	BOOST_REQUIRE_EQUAL(connect(greedy, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+
+	// the answer carries the ring, it is dropped along with the answer
+	const char hello[] = "\x04mock";
+	BOOST_REQUIRE_EQUAL(send(greedy, hello, 5, 0), 5);
+	char answer[16];
+	BOOST_REQUIRE_EQUAL(recv(greedy, answer, sizeof(answer), MSG_WAITALL), 16);
+
+	// rings until the daemon drops it
+	bool dropped = false;
+	char doorbell = 0;
+	auto start = std::chrono::steady_clock::now();
+	while (!dropped && std::chrono::steady_clock::now() - start < std::chrono::seconds(5)) {
+		if (0 > send(greedy, &doorbell, 1, MSG_DONTWAIT | MSG_NOSIGNAL))
+			dropped = errno != EAGAIN && errno != EWOULDBLOCK;
+	}
+	BOOST_CHECK(dropped);
+	close(greedy);
+
+	regmap::remote::Remote client(socketPath(), "mock", "simple.json");
+	client.get<regmap::Register32_t>("test3") = 0x1234;
+	BOOST_CHECK_EQUAL(device.get<regmap::Register32_t>("test3").get(), 0x1234);
+}
+
+BOOST_AUTO_TEST_CASE(socket_permissions){
+
+	struct stat info;
+	{
+		regmap::remote::Server server(socketPath());
+		BOOST_REQUIRE_EQUAL(stat(socketPath().c_str(), &info), 0);
+		BOOST_CHECK_EQUAL(info.st_mode & 0777, 0600);
+	}
+
+	regmap::remote::Server server(socketPath(), 0660, getgid());
+	BOOST_REQUIRE_EQUAL(stat(socketPath().c_str(), &info), 0);
+	BOOST_CHECK_EQUAL(info.st_mode & 0777, 0660);
+	BOOST_CHECK_EQUAL(info.st_gid, getgid());
+}
+
+BOOST_AUTO_TEST_CASE(batches){
+
+	auto device = regmap::RegMapMock("simple.json", 100);
+	regmap::remote::Server server(socketPath());
+	server.add("mock", device.getBackend());
+	server.start();
+
+	regmap::remote::Remote client(socketPath(), "mock", "simple.json");
+	auto test2 = client.get<regmap::Register16_t>("test2");
+	auto access = client.get<regmap::Register16_t>("access_mask_test");
+
+	auto batch = client.batch();
+	batch.write(test2, 0xBEEF);
+	batch.write(access, 0xFFFF);
+	std::size_t a = batch.read(test2);
+	std::size_t b = batch.read(access);
+	batch.submit();
+
+	BOOST_CHECK_EQUAL(batch.value(test2, a), 0xBEEF);
+	BOOST_CHECK_EQUAL(batch.value(access, b), 0xFF);
+	BOOST_CHECK_EQUAL(client.getBackend().roundTrips(), 1);
+
+	// batches larger than the ring take several round trips
+	regmap::remote::Batch large(client.getBackend());
+	for (unsigned int i = 0; i < regmap::remote::RING_SIZE + 10; i++)
+		large.read(0, 4);
+	large.submit();
+	BOOST_CHECK_EQUAL(client.getBackend().roundTrips(), 3);
+	BOOST_CHECK_EQUAL(server.accesses(), 4 + regmap::remote::RING_SIZE + 10);
+}
+
+BOOST_AUTO_TEST_CASE(errors){
+
+	auto device = regmap::RegMapMock("simple.json", 100);
+	regmap::remote::Server server(socketPath());
+	server.add("mock", device.getBackend());
+	server.start();
+
+	BOOST_CHECK_THROW(regmap::remote::Remote(socketPath(), "unknown", "simple.json"), std::runtime_error);
+	// the definition has to fit the served backend
+	regmap::remote::Server other(socketPath() + "2");
+	regmap::RegBackendMemory tiny(std::shared_ptr<void>(malloc(4), free), 4);
+	other.add("tiny", tiny);
+	other.start();
+	BOOST_CHECK_THROW(regmap::remote::Remote(socketPath() + "2", "tiny", "simple.json"), std::out_of_range);
+
+	regmap::remote::Remote client(socketPath(), "mock", "simple.json");
+	auto batch = client.batch();
+	batch.write(0, 1, 1);
+	std::size_t bad = batch.read(98, 4);
+	std::size_t good = batch.read(0, 1);
+	BOOST_CHECK_THROW(batch.submit(), std::system_error);
+	BOOST_CHECK(batch.error(bad) == std::errc::result_out_of_range);
+	BOOST_CHECK(!batch.error(good));
+	BOOST_CHECK_EQUAL(batch.value(good), 1);
+
+	BOOST_CHECK_THROW(client.getBackend().get<std::uint32_t>(98), std::system_error);
+	BOOST_CHECK(client.getBackend().try_get<std::uint32_t>(98).error() == std::errc::result_out_of_range);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
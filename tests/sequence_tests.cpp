@@ -0,0 +1,179 @@
+#include <chrono>
+#include <cstring>
+#include <sstream>
+#include <boost/test/unit_test.hpp>
+#include "sim.hpp"
+#include "sequence.hpp"
+
+BOOST_AUTO_TEST_SUITE(sequence_tests)
+
+// memory mapped backend recording the width of every access
+class RecordingMap : public regmap::IRegBackend {
+
+public:
+	RecordingMap() { memset(m_aMemory, 0, sizeof(m_aMemory)); }
+
+	void* mapping(unsigned int offset, size_t size) {
+		return m_aMemory + offset;
+	}
+
+	unsigned char			m_aMemory[32];
+	std::vector<std::size_t>	m_oWidths;
+
+protected:
+	void write(unsigned int offset, void* value, size_t size) {
+		m_oWidths.push_back(size);
+		memcpy(m_aMemory + offset, value, size);
+	}
+
+	void read(unsigned int offset, void* value, size_t size) {
+		memcpy(value, m_aMemory + offset, size);
+	}
+};
+
+
+BOOST_AUTO_TEST_CASE(coalesced_writes){
+
+	auto device = regmap::sim::Simulator("sequence.json", 32, regmap::sim::LatencyModel::i2c(400000), false);
+	auto init = regmap::sequence::Sequence::parse(*device.definition(), "init");
+	BOOST_CHECK_EQUAL(init.steps().size(), 9u);
+
+	auto report = regmap::sequence::run(device.getBackend(), init);
+	BOOST_CHECK(report.ok());
+	BOOST_CHECK_EQUAL(report.m_oSteps.size(), 9u);
+
+	BOOST_CHECK_EQUAL(device.get<regmap::Register32_t>("config"), 0x501);
+	BOOST_CHECK_EQUAL(device.get<regmap::Register16_t>("gain"), 0x1234);
+	BOOST_CHECK_EQUAL(device.getBackend().get<std::uint16_t>(0xC), 0x3412);
+	BOOST_CHECK_EQUAL(device.get<regmap::Register16_t>("offset"), 0x20);
+	BOOST_CHECK_EQUAL(device.get<regmap::Register32_t>("threshold"), 0x100);
+
+	// four adjacent registers in one transfer, the read-modify-write and
+	// the two single writes before the waits
+	auto stats = device.getBackend().statistics();
+	BOOST_CHECK_EQUAL(stats.m_uWrites, 4u);
+	BOOST_CHECK_EQUAL(stats.m_uBytesWritten, 12u + 4u + 4u + 4u);
+
+	for (std::size_t i = 1; i < 4; i++) {
+		BOOST_CHECK_EQUAL(report.m_oSteps[i].m_uTransfer, report.m_oSteps[0].m_uTransfer);
+		BOOST_CHECK(report.m_oSteps[i].m_uStart == report.m_oSteps[0].m_uStart);
+	}
+	BOOST_CHECK_EQUAL(report.m_oSteps[4].m_sName, "config.MODE");
+
+	// both waits take the simulated 2ms
+	BOOST_CHECK_EQUAL(report.m_oSteps[6].m_eType, regmap::sequence::WAIT_BUSY_CLEAR);
+	BOOST_CHECK(report.m_oSteps[6].m_uDuration >= std::chrono::milliseconds(1));
+	BOOST_CHECK_EQUAL(report.m_oSteps[8].m_eType, regmap::sequence::WAIT_READY);
+	BOOST_CHECK(report.m_oSteps[8].m_uDuration >= std::chrono::milliseconds(1));
+}
+
+BOOST_AUTO_TEST_CASE(burst_limit){
+
+	auto device = regmap::sim::Simulator("sequence.json", 32, regmap::sim::LatencyModel(), false);
+	auto report = regmap::sequence::run(device.getBackend(), regmap::sequence::Sequence::parse(*device.definition(), "init"),
+		regmap::sequence::Options(4));
+	BOOST_CHECK(report.ok());
+
+	// config, gain and offset, threshold
+	BOOST_CHECK_EQUAL(device.getBackend().statistics().m_uWrites, 3u + 3u);
+	BOOST_CHECK_EQUAL(device.get<regmap::Register16_t>("gain"), 0x1234);
+}
+
+BOOST_AUTO_TEST_CASE(mapped_writes){
+
+	auto device = regmap::sim::Simulator("sequence.json", 32, regmap::sim::LatencyModel(), false);
+	RecordingMap map;
+	auto report = regmap::sequence::run(map, regmap::sequence::Sequence::parse(*device.definition(), "setup"));
+	BOOST_CHECK(report.ok());
+	BOOST_CHECK_EQUAL(report.m_uTransfers, 4u);
+
+	// adjacent registers, still one access per register at its width
+	std::vector<std::size_t> widths = {4, 2, 2, 4};
+	BOOST_CHECK_EQUAL_COLLECTIONS(map.m_oWidths.begin(), map.m_oWidths.end(), widths.begin(), widths.end());
+	BOOST_CHECK_EQUAL(map.get<std::uint16_t>(0xC, regmap::BIG), 0x1234);
+	BOOST_CHECK_EQUAL(map.get<std::uint32_t>(0x10), 0x100u);
+}
+
+BOOST_AUTO_TEST_CASE(parallel_devices){
+
+	std::vector<regmap::sim::Simulator> devices;
+	for (int i = 0; i < 4; i++)
+		devices.push_back(regmap::sim::Simulator("sequence.json", 32, regmap::sim::LatencyModel(), false));
+
+	regmap::sequence::Engine engine;
+	for (std::size_t i = 0; i < devices.size(); i++)
+		engine.add("dev" + std::to_string(i), devices[i], "slow");
+
+	auto start = std::chrono::steady_clock::now();
+	auto reports = engine.run();
+	auto elapsed = std::chrono::steady_clock::now() - start;
+
+	BOOST_CHECK_EQUAL(reports.size(), 4u);
+	for (auto &report : reports) {
+		BOOST_CHECK(report.ok());
+		BOOST_CHECK(report.m_uDuration >= std::chrono::milliseconds(50));
+	}
+	BOOST_CHECK(elapsed < std::chrono::milliseconds(150));
+	BOOST_CHECK_EQUAL(reports[2].m_sDevice, "dev2");
+	BOOST_CHECK_EQUAL(devices[3].get<regmap::Register32_t>("threshold"), 0x1);
+
+	std::ostringstream os;
+	os << reports[0];
+	BOOST_CHECK_EQUAL(os.str().find("dev0 slow: done"), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(ordered_jobs){
+
+	auto first = regmap::sim::Simulator("sequence.json", 32, regmap::sim::LatencyModel(), false);
+	auto second = regmap::sim::Simulator("sequence.json", 32, regmap::sim::LatencyModel(), false);
+
+	regmap::sequence::Engine engine;
+	engine.add("first", first, "slow");
+	engine.add("second", second, "init");
+	// the same device, runs after the first job
+	engine.add("first", first, "init");
+	engine.after(1, 0);
+	BOOST_CHECK_THROW(engine.after(0, 1), std::out_of_range);
+
+	auto reports = engine.run();
+	for (auto &report : reports)
+		BOOST_CHECK(report.ok());
+
+	BOOST_CHECK(reports[1].m_uStart >= reports[0].m_uStart + reports[0].m_uDuration);
+	BOOST_CHECK(reports[2].m_uStart >= reports[0].m_uStart + reports[0].m_uDuration);
+	BOOST_CHECK_EQUAL(first.get<regmap::Register32_t>("threshold"), 0x100);
+}
+
+BOOST_AUTO_TEST_CASE(failed_step){
+
+	auto device = regmap::sim::Simulator("sequence.json", 32, regmap::sim::LatencyModel(), false);
+	auto other = regmap::sim::Simulator("sequence.json", 32, regmap::sim::LatencyModel(), false);
+
+	regmap::sequence::Engine engine;
+	engine.add("device", device, "stuck");
+	engine.add("device", device, "init");
+	engine.add("other", other, "slow");
+	auto reports = engine.run();
+
+	// the ready bit is never set, the step after it is not run
+	BOOST_CHECK(!reports[0].ok());
+	BOOST_CHECK_EQUAL(reports[0].m_oSteps.size(), 2u);
+	BOOST_CHECK(reports[0].m_oSteps[1].m_uDuration >= std::chrono::milliseconds(5));
+	BOOST_CHECK_EQUAL(device.get<regmap::Register32_t>("threshold"), 0x2);
+	BOOST_CHECK_THROW(std::rethrow_exception(reports[0].m_pError), std::runtime_error);
+
+	BOOST_CHECK(!reports[1].ok());
+	BOOST_CHECK(reports[1].m_oSteps.empty());
+	BOOST_CHECK(reports[2].ok());
+}
+
+BOOST_AUTO_TEST_CASE(invalid_sequences){
+
+	auto device = regmap::sim::Simulator("sequence.json", 32, regmap::sim::LatencyModel(), false);
+	BOOST_CHECK_THROW(regmap::sequence::Sequence::parse(*device.definition(), "missing"), std::runtime_error);
+	BOOST_CHECK_THROW(regmap::sequence::Sequence::parse(*device.definition(), "overflow"), std::runtime_error);
+	// threshold has no bitmasks at all
+	BOOST_CHECK_THROW(regmap::sequence::Sequence::parse(*device.definition(), "no_bitmasks"), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
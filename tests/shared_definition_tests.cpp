@@ -0,0 +1,54 @@
+#include <boost/test/unit_test.hpp>
+
+#include "RegMapMock.hpp"
+
+BOOST_AUTO_TEST_SUITE(shared_definition_tests)
+
+
+BOOST_AUTO_TEST_CASE(maps_share_their_definition){
+
+	auto test1 = regmap::RegMapMock("simple.json", 100);
+	auto test2 = regmap::RegMapMock("simple.json", 100);
+
+	BOOST_CHECK(test1.definition() == test2.definition());
+	BOOST_CHECK(regmap::RegMapDefinition::load("simple.json") == test1.definition());
+	BOOST_CHECK_EQUAL(test1.defFile(), "simple.json");
+}
+
+BOOST_AUTO_TEST_CASE(maps_from_loaded_definition){
+
+	regmap::Definition_t definition = std::make_shared<regmap::RegMapDefinition>("simple.json");
+
+	auto test1 = regmap::RegMapMock(definition, 100);
+	auto test2 = regmap::RegMapMock(definition, 100);
+	BOOST_CHECK(test1.definition() == definition);
+	BOOST_CHECK(test2.definition() == definition);
+
+	// registers are bound to the backend of their map
+	auto testreg1 = test1.get<regmap::Register32_t>("test3");
+	auto testreg2 = test2.get<regmap::Register32_t>("test3");
+	testreg1 = 0xAFFE;
+	testreg2 = 0xDEAD;
+	BOOST_CHECK_EQUAL(testreg1, 0xAFFE);
+	BOOST_CHECK_EQUAL(testreg2, 0xDEAD);
+	BOOST_CHECK_EQUAL(test1.get<regmap::Register32_t>("bitmask_test")["124"], 0x7);
+}
+
+BOOST_AUTO_TEST_CASE(definitions_are_released){
+
+	std::weak_ptr<const regmap::RegMapDefinition> weak;
+	{
+		auto test = regmap::RegMapMock("busy_ready_mask.json", 100);
+		weak = test.definition();
+		BOOST_CHECK(!weak.expired());
+	}
+	BOOST_CHECK(weak.expired());
+}
+
+BOOST_AUTO_TEST_CASE(it_throws_on_missing_definition){
+
+	BOOST_CHECK_THROW(regmap::RegMapMock(regmap::Definition_t(), 100), std::runtime_error);
+	BOOST_CHECK_THROW(regmap::RegMapDefinition::load("xXx.json"), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,96 @@
+#include <thread>
+#include <chrono>
+#include <boost/test/unit_test.hpp>
+#include "sim.hpp"
+
+BOOST_AUTO_TEST_SUITE(simulation_tests)
+
+
+BOOST_AUTO_TEST_CASE(latency_statistics){
+
+	auto test = regmap::sim::Simulator("simulation.json", 16, regmap::sim::LatencyModel::i2c(100000), false);
+	auto testreg = test.get<regmap::Register32_t>("control");
+
+	testreg = 0x10;
+	BOOST_CHECK_EQUAL(testreg, 0x10);
+
+	auto stats = test.getBackend().statistics();
+	BOOST_CHECK_EQUAL(stats.m_uWrites, 1u);
+	BOOST_CHECK_EQUAL(stats.m_uReads, 1u);
+	BOOST_CHECK_EQUAL(stats.m_uBytesWritten, 4u);
+	BOOST_CHECK_EQUAL(stats.m_uBytesRead, 4u);
+
+	// 10us per bit: 20 bits of addressing and 36 data bits for the write,
+	// 10 more bits for the repeated start of the read
+	BOOST_CHECK_EQUAL(stats.m_uMinLatency.count(), 560000);
+	BOOST_CHECK_EQUAL(stats.m_uMaxLatency.count(), 660000);
+	BOOST_CHECK_EQUAL(stats.m_uBusTime.count(), 1220000);
+	BOOST_CHECK_CLOSE(stats.throughput(), 8 * 1e9 / 1220000, 0.001);
+
+	test.getBackend().resetStatistics();
+	BOOST_CHECK_EQUAL(test.getBackend().statistics().m_uReads, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(realtime_latency){
+
+	auto test = regmap::sim::Simulator("simulation.json", 16, regmap::sim::LatencyModel(std::chrono::microseconds(500)));
+	auto testreg = test.get<regmap::Register32_t>("counter");
+
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < 4; i++)
+		testreg.get();
+	BOOST_CHECK(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(2));
+}
+
+BOOST_AUTO_TEST_CASE(self_clearing_busy_bit){
+
+	auto test = regmap::sim::Simulator("simulation.json", 16);
+	auto testreg = test.get<regmap::Register32_t>("control");
+
+	testreg = 0x11;
+	BOOST_CHECK_EQUAL(testreg, 0x11);
+	BOOST_CHECK_EQUAL(testreg.work(std::chrono::milliseconds(100)), true);
+	BOOST_CHECK_EQUAL(testreg, 0x10);
+}
+
+BOOST_AUTO_TEST_CASE(delayed_ready_bit){
+
+	auto test = regmap::sim::Simulator("simulation.json", 16);
+	auto testreg = test.get<regmap::Register32_t>("status");
+
+	testreg = 0x80010000;
+	// the write itself clears the ready bit
+	BOOST_CHECK_EQUAL(testreg, 0x00010000);
+	BOOST_CHECK_EQUAL(testreg.wait(std::chrono::milliseconds(100)), true);
+	BOOST_CHECK_EQUAL(testreg, 0x80010000);
+}
+
+BOOST_AUTO_TEST_CASE(clear_on_read_counter){
+
+	auto test = regmap::sim::Simulator("simulation.json", 16);
+	auto testreg = test.get<regmap::Register16_t>("events");
+
+	testreg = 0x1234;
+	BOOST_CHECK_EQUAL(testreg.get(), 0x1234);
+	BOOST_CHECK_EQUAL(testreg.get(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(free_running_counter){
+
+	auto test = regmap::sim::Simulator("simulation.json", 16);
+	auto testreg = test.get<regmap::Register32_t>("counter");
+
+	std::uint32_t first = testreg.get();
+	std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	BOOST_CHECK_GE(testreg.get() - first, 40u);
+}
+
+BOOST_AUTO_TEST_CASE(programmatic_behaviour){
+
+	auto test = regmap::sim::Simulator("simulation.json", 16);
+
+	BOOST_CHECK_THROW(test.getBackend().addBehaviour(regmap::sim::Behaviour(regmap::sim::CLEAR_ON_READ, 14, 4, 0xFF)), std::out_of_range);
+	BOOST_CHECK_THROW(test.getBackend().addBehaviour(regmap::sim::Behaviour(regmap::sim::FREE_RUNNING, 0, 4, 1)), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
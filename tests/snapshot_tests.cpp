@@ -0,0 +1,124 @@
+#include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+#include "RegMapMock.hpp"
+#include "sim.hpp"
+
+BOOST_AUTO_TEST_SUITE(snapshot_tests)
+
+
+BOOST_AUTO_TEST_CASE(layout_in_offset_order){
+
+	auto layout = regmap::RegMapDefinition::load("arrays.json")->layout();
+
+	// ctrl, 16 doorbells and 4 queues with HEAD, TAIL and 4 vectors
+	BOOST_CHECK_EQUAL(layout->size(), 41);
+	BOOST_CHECK(std::is_sorted(layout->begin(), layout->end(), [](const regmap::RegisterInfo &a, const regmap::RegisterInfo &b) {
+		return a.m_uOffset < b.m_uOffset;
+	}));
+
+	BOOST_CHECK_EQUAL((*layout)[0].m_sName, "ctrl");
+	BOOST_CHECK_EQUAL((*layout)[3].m_sName, "DOORBELL[2]");
+	BOOST_CHECK_EQUAL((*layout)[3].m_uOffset, 0x14);
+	BOOST_CHECK_EQUAL((*layout)[17].m_sName, "QUEUE[0].HEAD");
+	BOOST_CHECK_EQUAL((*layout)[40].m_sName, "QUEUE[3].VECTOR[3]");
+	BOOST_CHECK_EQUAL((*layout)[40].m_uOffset, 0x100 + 3 * 0x40 + 0x10 + 3 * 8);
+}
+
+BOOST_AUTO_TEST_CASE(coalesced_dump){
+
+	auto test = regmap::sim::Simulator("arrays.json", 0x200, regmap::sim::LatencyModel::i2c(400000), false);
+	test.get<regmap::Register16_t>("DOORBELL", 7) = 0x77;
+	test.array("QUEUE")[2].get<regmap::Register32_t>("TAIL") = 0xAFFE;
+
+	test.getBackend().resetStatistics();
+	auto snapshot = test.dump();
+	BOOST_CHECK_EQUAL(snapshot.value("DOORBELL[7]"), 0x77);
+	BOOST_CHECK_EQUAL(snapshot.value("QUEUE[2].TAIL"), 0xAFFE);
+	BOOST_CHECK_THROW(snapshot.value("QUEUE[4].TAIL"), std::runtime_error);
+
+	// ctrl, the doorbells, HEAD and TAIL of each queue and the vectors
+	BOOST_CHECK_EQUAL(test.getBackend().statistics().m_uReads, 2 + 4 * 5);
+
+	// gaps up to 16 bytes are read along: ctrl and the doorbells, then each queue
+	test.getBackend().resetStatistics();
+	auto gaps = test.dump(16);
+	BOOST_CHECK_EQUAL(test.getBackend().statistics().m_uReads, 1 + 4);
+	BOOST_CHECK_EQUAL(gaps.value("QUEUE[2].TAIL"), 0xAFFE);
+
+	test.getBackend().resetStatistics();
+	test.dump(0x1000, 0x40);
+	BOOST_CHECK_EQUAL(test.getBackend().statistics().m_uReads, 5);
+	BOOST_CHECK(test.getBackend().statistics().m_uBytesRead <= 5 * 0x40);
+}
+
+BOOST_AUTO_TEST_CASE(snapshot_diff){
+
+	auto test = regmap::RegMapMock("arrays.json", 0x200);
+	memset(test.getBackend().mapping(0, 0x200), 0, 0x200);
+	auto known = test.dump();
+
+	auto head = test.array("QUEUE")[1].get<regmap::Register32_t>("HEAD");
+	head = 0x80000010;
+	test.get<regmap::Register32_t>("ctrl") = 1;
+
+	auto changes = regmap::diff(known, test.dump());
+	BOOST_CHECK_EQUAL(changes.size(), 2);
+	BOOST_CHECK_EQUAL(changes[0].m_sName, "ctrl");
+	BOOST_CHECK_EQUAL(changes[1].m_sName, "QUEUE[1].HEAD");
+	BOOST_CHECK_EQUAL(changes[1].m_uAfter, 0x80000010);
+	BOOST_CHECK_EQUAL(changes[1].m_oFields.size(), 1);
+	BOOST_CHECK_EQUAL(changes[1].m_oFields[0].m_sName, "WRAP");
+	BOOST_CHECK_EQUAL(changes[1].m_oFields[0].m_uBefore, 0);
+	BOOST_CHECK_EQUAL(changes[1].m_oFields[0].m_uAfter, 1);
+
+	std::ostringstream report;
+	report << changes[1];
+	BOOST_CHECK_EQUAL(report.str(), "QUEUE[1].HEAD @0x140: 0x0 -> 0x80000010, WRAP: 0x0 -> 0x1");
+
+	auto other = regmap::RegMapMock("simple.json", 0x200);
+	BOOST_CHECK_THROW(regmap::diff(known, other.dump()), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(save_and_load){
+
+	auto test = regmap::RegMapMock("arrays.json", 0x200);
+	memset(test.getBackend().mapping(0, 0x200), 0, 0x200);
+	test.get<regmap::Register16_t>("DOORBELL", 3) = 0x1234;
+	auto snapshot = test.dump();
+
+	std::string file = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("regmap-snapshot-%%%%.json")).string();
+	snapshot.save(file);
+	auto loaded = regmap::Snapshot::load(file, test.definition()->layout());
+	boost::filesystem::remove(file);
+
+	BOOST_CHECK_EQUAL(loaded.value("DOORBELL[3]"), 0x1234);
+	BOOST_CHECK(regmap::diff(snapshot, loaded).empty());
+}
+
+BOOST_AUTO_TEST_CASE(large_map){
+
+	// 2000 registers over i2c in a single transaction
+	std::string file = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("regmap-large-%%%%.json")).string();
+	{
+		std::ofstream f(file);
+		f << "{ \"registers\": {";
+		for (int i = 0; i < 2000; i++)
+			f << (i ? "," : "") << "\"reg" << i << "\": { \"offset\": \"" << i * 4 << "\", \"size\": \"4\" }";
+		f << "} }";
+	}
+
+	auto test = regmap::sim::Simulator(file, 8000, regmap::sim::LatencyModel::i2c(400000), false);
+	boost::filesystem::remove(file);
+
+	test.getBackend().resetStatistics();
+	auto snapshot = test.dump();
+	BOOST_CHECK_EQUAL(snapshot.size(), 2000);
+	BOOST_CHECK_EQUAL(test.getBackend().statistics().m_uReads, 1);
+	BOOST_CHECK(test.getBackend().statistics().m_uBusTime < std::chrono::milliseconds(200));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
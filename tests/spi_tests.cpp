@@ -0,0 +1,199 @@
+#include <boost/test/unit_test.hpp>
+#include <cerrno>
+#include <vector>
+
+#include "spi.hpp"
+
+BOOST_AUTO_TEST_SUITE(spi_tests)
+
+// Register file behind spidev: decodes the command at the start of every
+// chip select frame and serves the following bytes, auto incrementing
+struct SimulatedSlave {
+
+	SimulatedSlave(const regmap::spi::Protocol &protocol)
+	: m_oProtocol(protocol), m_oMemory(0x10000, 0), m_uMessages(0), m_uFrames(0), m_iError(0) {}
+
+	int operator()(int, unsigned long request, void *arg) {
+
+		if (_IOC_TYPE(request) != SPI_IOC_MAGIC || _IOC_NR(request) != 0) {
+			errno = ENOTTY;
+			return -1;
+		}
+		if (m_iError) {
+			errno = m_iError;
+			return -1;
+		}
+
+		m_uMessages++;
+		std::size_t count = _IOC_SIZE(request) / sizeof(spi_ioc_transfer);
+		spi_ioc_transfer *transfers = static_cast<spi_ioc_transfer*>(arg);
+
+		this->select();
+		for (std::size_t t = 0; t < count; t++) {
+			auto tx = reinterpret_cast<const unsigned char*>(transfers[t].tx_buf);
+			auto rx = reinterpret_cast<unsigned char*>(transfers[t].rx_buf);
+			for (std::size_t i = 0; i < transfers[t].len; i++) {
+				unsigned char in = this->shift(tx ? tx[i] : 0);
+				if (rx)
+					rx[i] = in;
+			}
+			if (transfers[t].cs_change && t + 1 < count)
+				this->select();
+		}
+		return count;
+	}
+
+	void select() {
+		m_uFrames++;
+		m_uPosition = 0;
+		m_uCommand = 0;
+	}
+
+	unsigned char shift(unsigned char out) {
+
+		unsigned int header = m_oProtocol.m_uAddressBytes;
+		std::size_t position = m_uPosition++;
+		if (position < header) {
+			m_uCommand = (m_uCommand << 8) | out;
+			return 0;
+		}
+
+		std::uint32_t flags = m_oProtocol.m_uReadFlag | m_oProtocol.m_uWriteFlag;
+		bool read = m_oProtocol.m_uReadFlag ? (m_uCommand & m_oProtocol.m_uReadFlag) : !(m_uCommand & m_oProtocol.m_uWriteFlag);
+		unsigned int address = (m_uCommand & ~flags) >> m_oProtocol.m_uAddressShift;
+
+		std::size_t data = position - header;
+		if (read && data < m_oProtocol.m_uDummyBytes)
+			return 0;
+		if (read)
+			data -= m_oProtocol.m_uDummyBytes;
+
+		unsigned int reg = address + (m_oProtocol.m_bAutoIncrement ? data : 0);
+		if (read)
+			return m_oMemory[reg];
+		m_oMemory[reg] = out;
+		return 0;
+	}
+
+	regmap::spi::Protocol		m_oProtocol;
+	std::vector<unsigned char>	m_oMemory;
+	std::size_t			m_uMessages;
+	std::size_t			m_uFrames;
+	int				m_iError;
+	std::size_t			m_uPosition;
+	std::uint32_t			m_uCommand;
+};
+
+static regmap::spi::RegBackendSPIDev backend(SimulatedSlave &slave) {
+	return regmap::spi::RegBackendSPIDev(regmap::BackendFile_t(new int(-1)), slave.m_oProtocol, 20000000,
+		[&slave](int fd, unsigned long request, void *arg) { return slave(fd, request, arg); });
+}
+
+
+BOOST_AUTO_TEST_CASE(address_space){
+
+	BOOST_CHECK_EQUAL(regmap::spi::Protocol().registers(), 128);
+	BOOST_CHECK_EQUAL(regmap::spi::Protocol(1, 1, 0, 1).registers(), 128);
+	BOOST_CHECK_EQUAL(regmap::spi::Protocol(1, 0, 0).registers(), 256);
+	BOOST_CHECK_EQUAL(regmap::spi::Protocol(2, 0x8000).registers(), 0x8000);
+}
+
+BOOST_AUTO_TEST_CASE(register_accesses){
+
+	SimulatedSlave slave((regmap::spi::Protocol()));
+	regmap::spi::SPI test(backend(slave), "simple.json");
+
+	auto test3 = test.get<regmap::Register32_t>("test3");
+	test3 = 0xDEADAFFE;
+	BOOST_CHECK_EQUAL(slave.m_oMemory[3], 0xFE);
+	BOOST_CHECK_EQUAL(slave.m_oMemory[6], 0xDE);
+	BOOST_CHECK_EQUAL(test3.get(), 0xDEADAFFE);
+	BOOST_CHECK_EQUAL(slave.m_uMessages, 2);
+
+	// read flag and address share the command byte
+	slave.m_oMemory[0x7F] = 0x42;
+	BOOST_CHECK_EQUAL(test.getBackend().get<std::uint8_t>(0x7F), 0x42);
+	BOOST_CHECK_THROW(test.getBackend().get<std::uint8_t>(0x80), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE(batched_accesses){
+
+	SimulatedSlave slave((regmap::spi::Protocol()));
+	regmap::spi::SPI test(backend(slave), "simple.json");
+	auto test1 = test.get<regmap::Register8_t>("test1");
+	auto test2 = test.get<regmap::Register16_t>("test2");
+	auto access = test.get<regmap::Register16_t>("access_mask_test");
+
+	std::uint8_t a = 0;
+	std::uint16_t b = 0, c = 0;
+	regmap::spi::Batch batch(test.getBackend());
+	batch.write(test1, 0x11);
+	batch.write(test2, 0x2233);
+	batch.write(access, 0xFFFF);
+	batch.read(test1, a);
+	batch.read(test2, b);
+	batch.read(access, c);
+	batch.submit();
+
+	BOOST_CHECK_EQUAL(slave.m_uMessages, 1);
+	BOOST_CHECK_EQUAL(slave.m_uFrames, 6);
+	BOOST_CHECK_EQUAL(a, 0x11);
+	BOOST_CHECK_EQUAL(b, 0x2233);
+	BOOST_CHECK_EQUAL(c, 0xFF);
+
+	// whole map snapshots in one message as well
+	slave.m_uMessages = 0;
+	auto snapshot = test.dump(16);
+	BOOST_CHECK_EQUAL(slave.m_uMessages, 1);
+	BOOST_CHECK_EQUAL(snapshot.value("test2"), 0x2233);
+
+	// spidev limits the transfers per message
+	std::vector<std::uint8_t> values(300);
+	std::vector<regmap::spi::RegBackendSPIDev::Access> accesses;
+	for (auto &value : values)
+		accesses.push_back(regmap::spi::RegBackendSPIDev::Access{0, &value, 1, false});
+	slave.m_uMessages = 0;
+	test.getBackend().submit(accesses.data(), accesses.size());
+	BOOST_CHECK_EQUAL(slave.m_uMessages, 2);
+	BOOST_CHECK_EQUAL(values[299], 0x11);
+}
+
+BOOST_AUTO_TEST_CASE(wide_addresses_and_fifos){
+
+	// 15 bit addresses, read flag in the MSB, one turnaround byte
+	SimulatedSlave slave(regmap::spi::Protocol(2, 0x8000, 0, 0, 1));
+	auto spi = backend(slave);
+	BOOST_CHECK_EQUAL(spi.size(), 0x8000);
+
+	spi.set<std::uint16_t>(0x1234, 0xBEEF);
+	BOOST_CHECK_EQUAL(slave.m_oMemory[0x1234], 0xEF);
+	BOOST_CHECK_EQUAL(spi.get<std::uint16_t>(0x1234), 0xBEEF);
+
+	std::vector<std::uint8_t> block = {1, 2, 3, 4, 5, 6, 7, 8};
+	spi.copy_to_device(0x100, block.data(), block.size());
+	std::vector<std::uint8_t> back(block.size());
+	spi.copy_from_device(0x100, back.data(), back.size());
+	BOOST_CHECK(block == back);
+
+	// FIFOs of slaves without auto increment: every word at the same address
+	SimulatedSlave fifo(regmap::spi::Protocol(1, 0x80, 0, 0, 0, false));
+	auto rx = backend(fifo);
+	fifo.m_oMemory[0x10] = 0x5A;
+	std::vector<std::uint8_t> words(16);
+	rx.read_repeated(0x10, words.data(), 1, words.size());
+	BOOST_CHECK_EQUAL(fifo.m_uMessages, 1);
+	BOOST_CHECK_EQUAL(words[15], 0x5A);
+}
+
+BOOST_AUTO_TEST_CASE(bus_errors){
+
+	SimulatedSlave slave((regmap::spi::Protocol()));
+	auto spi = backend(slave);
+	slave.m_iError = EIO;
+
+	BOOST_CHECK(spi.try_get<std::uint8_t>(0).error() == std::errc::io_error);
+	BOOST_CHECK(spi.try_set<std::uint8_t>(0, 1) == std::errc::io_error);
+	BOOST_CHECK_THROW(spi.get<std::uint8_t>(0), std::system_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,46 @@
+#include <boost/test/unit_test.hpp>
+#include <vector>
+#include <algorithm>
+
+#include "IRegBackend.hpp"
+#include "streaming.hpp"
+
+BOOST_AUTO_TEST_SUITE(streaming_tests)
+
+
+BOOST_AUTO_TEST_CASE(stream_copy_alignments){
+
+	std::vector<unsigned char> src(512);
+	for (std::size_t i = 0; i < src.size(); i++)
+		src[i] = static_cast<unsigned char>(i * 7 + 3);
+
+	// unaligned heads and tails around the 16 and 64 byte blocks
+	for (std::size_t dstOffset : {0, 1, 8, 15})
+		for (std::size_t srcOffset : {0, 3})
+			for (std::size_t size : {0, 1, 15, 16, 17, 63, 64, 65, 200, 400}) {
+				std::vector<unsigned char> dst(512 + 32, 0xAA);
+				regmap::streamCopy(&dst[dstOffset], &src[srcOffset], size);
+
+				BOOST_CHECK(std::equal(src.begin() + srcOffset, src.begin() + srcOffset + size, dst.begin() + dstOffset));
+				BOOST_CHECK(std::all_of(dst.begin(), dst.begin() + dstOffset, [](unsigned char c) { return c == 0xAA; }));
+				BOOST_CHECK(std::all_of(dst.begin() + dstOffset + size, dst.end(), [](unsigned char c) { return c == 0xAA; }));
+			}
+}
+
+BOOST_AUTO_TEST_CASE(stream_to_memory_backend){
+
+	regmap::BackendMemory_t mem(malloc(256), free);
+	regmap::RegBackendMemory backend(mem, 256);
+
+	std::vector<std::uint32_t> commands(32);
+	for (std::size_t i = 0; i < commands.size(); i++)
+		commands[i] = 0xC0DE0000 + i;
+
+	backend.stream(64, commands.data(), commands.size() * sizeof(std::uint32_t));
+	for (std::size_t i = 0; i < commands.size(); i++)
+		BOOST_CHECK_EQUAL(backend.get<std::uint32_t>(64 + i * 4), commands[i]);
+
+	BOOST_CHECK_THROW(backend.stream(200, commands.data(), 64), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,157 @@
+#include <boost/test/unit_test.hpp>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+#include "RegMapMock.hpp"
+
+BOOST_AUTO_TEST_SUITE(validation_tests)
+
+// memory mapped backend on a caller owned buffer, bytes beyond size stay
+// visible to the test
+class GuardedMap : public regmap::RegMapBase<regmap::RegBackendMemory> {
+
+public:
+	GuardedMap(const regmap::DefinitionRef &definition, unsigned char *memory, std::size_t size)
+	: RegMapBase(definition) {
+		this->setBackend(regmap::RegBackendMemory(regmap::BackendMemory_t(memory, [](void*) {}), size));
+	}
+};
+
+
+BOOST_AUTO_TEST_CASE(registers_exceeding_the_backend){
+
+	// test3 spans bytes 3 to 6
+	BOOST_CHECK_THROW(regmap::RegMapMock("simple.json", 4), std::out_of_range);
+	BOOST_CHECK_NO_THROW(regmap::RegMapMock("simple.json", 100));
+}
+
+BOOST_AUTO_TEST_CASE(arrays_exceeding_the_backend){
+
+	// the last element of the last array ends the definition
+	auto definition = regmap::RegMapDefinition::load("arrays.json");
+	std::size_t end = 0;
+	for (auto &info : *definition->layout())
+		end = std::max<std::size_t>(end, info.m_uOffset + info.m_uSize);
+
+	BOOST_CHECK_THROW(regmap::RegMapMock(definition, end - 1), std::out_of_range);
+	BOOST_CHECK_NO_THROW(regmap::RegMapMock(definition, end));
+}
+
+BOOST_AUTO_TEST_CASE(regions_exceeding_the_backend){
+
+	auto definition = regmap::RegMapDefinition::load("regions.json");
+	std::size_t end = 0;
+	for (auto &region : definition->regions())
+		end = std::max<std::size_t>(end, region.second.m_uOffset + region.second.m_uSize);
+
+	BOOST_CHECK_THROW(regmap::RegMapMock(definition, end - 1), std::out_of_range);
+	BOOST_CHECK_NO_THROW(regmap::RegMapMock(definition, end));
+}
+
+BOOST_AUTO_TEST_CASE(validated_registers){
+
+	auto test = regmap::RegMapMock("simple.json", 100);
+	auto test2 = test.get<regmap::Register16_t>("test2");
+	auto test3 = test.get<regmap::Register32_t>("test3");
+
+	test2 = 0xBEEF;
+	test3 = 0xDEADAFFE;
+	BOOST_CHECK_EQUAL(test2.get(), 0xBEEF);
+	BOOST_CHECK_EQUAL(test3.get(), 0xDEADAFFE);
+	BOOST_CHECK_EQUAL(test.getBackend().get<std::uint32_t>(3), 0xDEADAFFE);
+
+	// raw backend accesses are still checked
+	BOOST_CHECK_THROW(test.getBackend().get<std::uint32_t>(98), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE(narrow_registers_write_their_width){
+
+	unsigned char memory[8];
+	memset(memory, 0xA5, sizeof(memory));
+	auto test = GuardedMap("byte_registers.json", memory, 4);
+
+	test.get<regmap::Register16_t>("second") = 0x1234;
+	test.get<regmap::Register8_t>("first") = 0x11;
+	BOOST_CHECK_EQUAL(test.get<regmap::Register16_t>("second").get(), 0x1234);
+
+	// the last byte of the mapping
+	test.get<regmap::Register8_t>("last") = 0x22;
+	BOOST_CHECK_EQUAL(test.get<regmap::Register8_t>("last").get(), 0x22);
+	for (std::size_t i = 4; i < sizeof(memory); i++)
+		BOOST_CHECK_EQUAL(memory[i], 0xA5);
+}
+
+BOOST_AUTO_TEST_CASE(no_throw_accessors){
+
+	auto test = regmap::RegMapMock("simple.json", 100);
+	auto access = test.get<regmap::Register16_t>("access_mask_test");
+
+	BOOST_CHECK(!access.try_set(0xFFFF));
+	auto value = access.try_get();
+	BOOST_CHECK(value);
+	BOOST_CHECK_EQUAL(value.value(), access.getAccessMask());
+
+	auto &backend = test.getBackend();
+	BOOST_CHECK(!backend.try_set<std::uint16_t>(98, 0x1234));
+	BOOST_CHECK_EQUAL(backend.try_get<std::uint16_t>(98).value(), 0x1234);
+
+	auto outside = backend.try_get<std::uint32_t>(98);
+	BOOST_CHECK(!outside);
+	BOOST_CHECK(outside.error() == std::errc::result_out_of_range);
+	BOOST_CHECK_EQUAL(outside.value_or(7), 7);
+	BOOST_CHECK_THROW(outside.value(), std::system_error);
+	BOOST_CHECK(backend.try_set<std::uint32_t>(98, 0) == std::errc::result_out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE(registers_outside_the_definition_stay_checked){
+
+	auto test = regmap::RegMapMock("simple.json", 100);
+	auto known = test.get<regmap::Register16_t>("access_mask_test");
+	BOOST_CHECK(known.isValidated());
+
+	// registers placed at any other offset were not validated
+	auto moved = regmap::Register16_t(known, 200);
+	BOOST_CHECK(!moved.isValidated());
+	BOOST_CHECK_THROW(moved = 0xDEAD, std::out_of_range);
+	BOOST_CHECK_THROW(moved.get(), std::out_of_range);
+	BOOST_CHECK(moved.try_set(0xDEAD) == std::errc::result_out_of_range);
+	BOOST_CHECK_THROW(static_cast<bool>(moved == 0), std::out_of_range);
+
+	auto far = regmap::Register32_t("far", test.getBackend(), 1000000, 0, 0, 0xFFFFFFFF, 0, 0, 0);
+	BOOST_CHECK_THROW(far = 1, std::out_of_range);
+	BOOST_CHECK_THROW(far.get(), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE(indirect_accesses_stay_checked){
+
+	auto test = regmap::RegMapMock("simple.json", 100);
+	auto &backend = test.getBackend();
+	backend.setIndirection(0, 4);
+
+	BOOST_CHECK(!backend.try_set<std::uint32_t>(0x3, 0xAFFE));
+	BOOST_CHECK_EQUAL(*static_cast<std::uint32_t*>(backend.mapping(0, 4)), 0x3);
+	BOOST_CHECK_EQUAL(backend.try_get<std::uint32_t>(0x3).value(), 0xAFFE);
+}
+
+BOOST_AUTO_TEST_CASE(file_backend_errors){
+
+	char path[] = "/tmp/regmap_validationXXXXXX";
+	int fd = mkstemp(path);
+	BOOST_REQUIRE(fd >= 0);
+	unlink(path);
+	BOOST_REQUIRE(0 == ftruncate(fd, 16));
+
+	regmap::RegBackendFile backend(regmap::BackendFile_t(new int(fd), [](int *fd) { close(*fd); delete fd; }), 16);
+	BOOST_CHECK(!backend.try_set<std::uint32_t>(4, 0x12345678));
+	BOOST_CHECK_EQUAL(backend.try_get<std::uint32_t>(4).value(), 0x12345678);
+	BOOST_CHECK_EQUAL(backend.get<std::uint32_t>(4), 0x12345678);
+	BOOST_CHECK(backend.try_get<std::uint32_t>(14).error() == std::errc::result_out_of_range);
+
+	// a closed descriptor surfaces the errno instead of throwing
+	regmap::RegBackendFile closed(regmap::BackendFile_t(new int(-1)), 16);
+	BOOST_CHECK(closed.try_get<std::uint8_t>(0).error() == std::errc::bad_file_descriptor);
+	BOOST_CHECK_THROW(closed.get<std::uint8_t>(0), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,114 @@
+#include <boost/test/unit_test.hpp>
+
+#include "RegMapMock.hpp"
+#include "sim.hpp"
+#include "wait.hpp"
+
+BOOST_AUTO_TEST_SUITE(wait_tests)
+
+
+BOOST_AUTO_TEST_CASE(counter_threshold){
+
+	auto test = regmap::sim::Simulator("simulation.json", 16, regmap::sim::LatencyModel(), false);
+	auto counter = test.get<regmap::Register32_t>("counter");
+
+	regmap::Waiter waiter(std::chrono::microseconds(50));
+	waiter.add(counter, regmap::GREATER_EQUAL, std::uint32_t(counter.get() + 10));
+	BOOST_CHECK_EQUAL(waiter.any(std::chrono::milliseconds(500)), 0);
+	BOOST_CHECK(waiter.iterations() > 1);
+
+	regmap::Waiter never;
+	never.add(counter, regmap::EQUAL, std::uint32_t(0));
+	BOOST_CHECK_EQUAL(never.any(std::chrono::milliseconds(5)), regmap::Waiter::TIMEOUT);
+}
+
+BOOST_AUTO_TEST_CASE(any_of_several){
+
+	auto test = regmap::sim::Simulator("simulation.json", 16, regmap::sim::LatencyModel(), false);
+	auto control = test.get<regmap::Register32_t>("control");
+	auto status = test.get<regmap::Register32_t>("status");
+
+	status = 0x80000000;
+	control = 0x1;
+
+	// the busy bit clears after 2ms, the ready bit is back after 2ms
+	regmap::Waiter waiter;
+	waiter.add(control, regmap::ALL_SET, std::uint32_t(0x2));
+	waiter.add(status, regmap::ANY_SET, std::uint32_t(0x80000000));
+	waiter.add(control, regmap::NONE_SET, std::uint32_t(0x1));
+
+	int fired = waiter.any(std::chrono::milliseconds(500));
+	BOOST_CHECK(fired == 1 || fired == 2);
+	BOOST_CHECK(!waiter.satisfied()[0]);
+	BOOST_CHECK(waiter.all(std::chrono::milliseconds(5)) == false);
+}
+
+BOOST_AUTO_TEST_CASE(all_with_single_reads){
+
+	auto test = regmap::sim::Simulator("simulation.json", 16, regmap::sim::LatencyModel(), false);
+	auto control = test.get<regmap::Register32_t>("control");
+	auto status = test.get<regmap::Register32_t>("status");
+
+	status = 0x80000000;
+	control = 0x31;
+
+	regmap::Waiter waiter(std::chrono::nanoseconds(0));
+	waiter.add(control, regmap::EQUAL, std::uint32_t(0x3), std::uint32_t(0xF0));
+	waiter.add(control, regmap::NONE_SET, std::uint32_t(0x1));
+	waiter.add(status, regmap::ALL_SET, std::uint32_t(0x1), std::uint32_t(0x80000000));
+
+	test.getBackend().resetStatistics();
+	BOOST_CHECK(waiter.all(std::chrono::milliseconds(500)));
+	BOOST_CHECK(waiter.satisfied()[0] && waiter.satisfied()[1] && waiter.satisfied()[2]);
+
+	// two registers, each read once per iteration
+	BOOST_CHECK_EQUAL(test.getBackend().statistics().m_uReads, 2 * waiter.iterations());
+}
+
+BOOST_AUTO_TEST_CASE(fields_predicates_and_expressions){
+
+	auto test = regmap::RegMapMock("arrays.json", 0x200);
+	auto head = test.array("QUEUE")[0].get<regmap::Register32_t>("HEAD");
+	auto tail = test.array("QUEUE")[0].get<regmap::Register32_t>("TAIL");
+	head = 0x80000000;
+	tail = 0x5;
+
+	regmap::Waiter waiter;
+	waiter.add(head, "WRAP", regmap::EQUAL, 0);
+	waiter.add((tail & 0xFu) == 0x5u);
+	BOOST_CHECK_EQUAL(waiter.any(std::chrono::milliseconds(5)), 1);
+
+	bool ready = false;
+	regmap::Waiter predicate;
+	predicate.add([&ready]() { return ready; });
+	predicate.add(head, "WRAP", regmap::EQUAL, 1);
+	BOOST_CHECK_EQUAL(predicate.any(std::chrono::milliseconds(5)), 1);
+	ready = true;
+	BOOST_CHECK(predicate.all(std::chrono::milliseconds(5)));
+
+	BOOST_CHECK_THROW(waiter.add(head, "NOFIELD", regmap::EQUAL, 0), std::runtime_error);
+	BOOST_CHECK_THROW(regmap::Waiter().any(), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(hidden_bits){
+
+	auto test = regmap::RegMapMock("simple.json", 100);
+	auto access = test.get<regmap::Register16_t>("access_mask_test");
+
+	// bits outside the access mask of 0x00FF are set on the device only
+	test.getBackend().set<std::uint16_t>(access.getOffset(), 0xFF00);
+	BOOST_CHECK_EQUAL(access.get(), 0);
+
+	regmap::Waiter hidden(std::chrono::nanoseconds(0));
+	hidden.add(access, regmap::ANY_SET, std::uint16_t(0xFF00));
+	BOOST_CHECK_EQUAL(hidden.any(std::chrono::milliseconds(2)), regmap::Waiter::TIMEOUT);
+
+	regmap::Waiter visible(std::chrono::nanoseconds(0));
+	visible.add(access, regmap::EQUAL, std::uint16_t(0));
+	visible.add(access, regmap::EQUAL, std::uint16_t(0x1), std::uint16_t(0xFFF0));
+	test.getBackend().set<std::uint16_t>(access.getOffset(), 0xFF10);
+	BOOST_CHECK(!visible.all(std::chrono::milliseconds(2)));
+	BOOST_CHECK(visible.satisfied()[1]);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
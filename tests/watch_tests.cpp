@@ -0,0 +1,234 @@
+#include <boost/test/unit_test.hpp>
+#include <vector>
+
+#include "RegMapMock.hpp"
+#include "sim.hpp"
+#include "watch.hpp"
+
+BOOST_AUTO_TEST_SUITE(watch_tests)
+
+
+BOOST_AUTO_TEST_CASE(register_and_field_changes){
+
+	auto test = regmap::RegMapMock("watch.json", 0x400);
+	memset(test.getBackend().mapping(0, 0x400), 0, 0x400);
+	auto status = test.get<regmap::Register32_t>("status");
+
+	std::vector<regmap::WatchEvent> events;
+	auto record = [&events](const regmap::WatchEvent &event) { events.push_back(event); };
+
+	regmap::Watcher watcher(test.getBackend());
+	watcher.watch(status, record);
+	watcher.watch(status, "SPEED", record);
+
+	// the first poll takes the baseline
+	BOOST_CHECK_EQUAL(watcher.poll(), 0);
+	BOOST_CHECK_EQUAL(watcher.poll(), 0);
+
+	status = 0x1;
+	BOOST_CHECK_EQUAL(watcher.poll(), 1);
+	BOOST_CHECK_EQUAL(events.back().m_sName, "status");
+	BOOST_CHECK_EQUAL(events.back().m_uBefore, 0);
+	BOOST_CHECK_EQUAL(events.back().m_uAfter, 1);
+
+	status = 0x21;
+	BOOST_CHECK_EQUAL(watcher.poll(), 2);
+	BOOST_CHECK_EQUAL(events.back().m_sName, "status.SPEED");
+	BOOST_CHECK_EQUAL(events.back().m_uAfter, 2);
+
+	BOOST_CHECK_EQUAL(watcher.poll(), 0);
+	BOOST_CHECK_THROW(watcher.watch(status, "DUPLEX", record), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(edges_and_levels){
+
+	auto test = regmap::RegMapMock("watch.json", 0x400);
+	memset(test.getBackend().mapping(0, 0x400), 0, 0x400);
+	auto irq = test.get<regmap::Register16_t>("irq");
+
+	int rising = 0, falling = 0, high = 0, low = 0;
+	regmap::Watcher watcher(test.getBackend());
+	watcher.watch(irq, [&rising](const regmap::WatchEvent&) { rising++; }, regmap::RISING, std::uint16_t(0x8));
+	watcher.watch(irq, [&falling](const regmap::WatchEvent&) { falling++; }, regmap::FALLING, std::uint16_t(0x8));
+	watcher.watch(irq, [&high](const regmap::WatchEvent&) { high++; }, regmap::LEVEL_HIGH, std::uint16_t(0x8));
+	watcher.watch(irq, [&low](const regmap::WatchEvent&) { low++; }, regmap::LEVEL_LOW, std::uint16_t(0x8));
+
+	watcher.poll();
+	BOOST_CHECK_EQUAL(low, 1);
+
+	irq = std::uint16_t(0x8);
+	watcher.poll();
+	watcher.poll();
+	irq = std::uint16_t(0x0);
+	watcher.poll();
+
+	BOOST_CHECK_EQUAL(rising, 1);
+	BOOST_CHECK_EQUAL(falling, 1);
+	BOOST_CHECK_EQUAL(high, 2);
+	BOOST_CHECK_EQUAL(low, 2);
+}
+
+BOOST_AUTO_TEST_CASE(debouncing){
+
+	auto test = regmap::RegMapMock("watch.json", 0x400);
+	memset(test.getBackend().mapping(0, 0x400), 0, 0x400);
+	auto status = test.get<regmap::Register32_t>("status");
+
+	std::vector<std::uint32_t> reported;
+	regmap::Watcher watcher(test.getBackend());
+	watcher.watch(status, "LINK", [&reported](const regmap::WatchEvent &event) { reported.push_back(event.m_uAfter); },
+			regmap::CHANGE, 3);
+	watcher.poll();
+
+	// a glitch shorter than three polls is not reported
+	status = 1;
+	watcher.poll();
+	status = 0;
+	watcher.poll();
+	watcher.poll();
+	BOOST_CHECK(reported.empty());
+
+	status = 1;
+	watcher.poll();
+	watcher.poll();
+	BOOST_CHECK(reported.empty());
+	watcher.poll();
+	BOOST_CHECK_EQUAL(reported.size(), 1);
+	watcher.poll();
+	BOOST_CHECK_EQUAL(reported.size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(coalesced_polls){
+
+	auto test = regmap::sim::Simulator("watch.json", 0x400, regmap::sim::LatencyModel(), false);
+	auto array = test.array("STATUS");
+
+	std::vector<unsigned int> changed;
+	regmap::Watcher watcher(test.getBackend());
+	for (unsigned int i = 0; i < array.size(); i++)
+		watcher.watch(array.get<regmap::Register32_t>(i), [&changed, i](const regmap::WatchEvent&) { changed.push_back(i); });
+	watcher.watch(test.get<regmap::Register8_t>("remote"), [](const regmap::WatchEvent&) {});
+
+	// the status array in one transfer, the remote register in another
+	BOOST_CHECK_EQUAL(watcher.transfers(), 2);
+	watcher.poll();
+
+	test.getBackend().resetStatistics();
+	array.get<regmap::Register32_t>(5) = 0xAFFE;
+	array.get<regmap::Register32_t>(63) = 0xBEEF;
+	BOOST_CHECK_EQUAL(watcher.poll(), 2);
+	BOOST_CHECK_EQUAL(changed.size(), 2);
+	BOOST_CHECK_EQUAL(changed[0], 5);
+	BOOST_CHECK_EQUAL(changed[1], 63);
+	BOOST_CHECK_EQUAL(test.getBackend().statistics().m_uReads, 2);
+
+	// other backends are refused
+	auto other = regmap::RegMapMock("watch.json", 0x400);
+	BOOST_CHECK_THROW(watcher.watch(other.get<regmap::Register16_t>("irq"), [](const regmap::WatchEvent&) {}), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(unwatch){
+
+	auto test = regmap::RegMapMock("watch.json", 0x400);
+	memset(test.getBackend().mapping(0, 0x400), 0, 0x400);
+	auto irq = test.get<regmap::Register16_t>("irq");
+
+	auto status = test.get<regmap::Register32_t>("status");
+
+	int count = 0, statuses = 0;
+	regmap::Watcher watcher(test.getBackend());
+	watcher.watch(status, [&statuses](const regmap::WatchEvent&) { statuses++; });
+	auto id = watcher.watch(irq, [&count](const regmap::WatchEvent&) { count++; });
+	watcher.poll();
+	watcher.unwatch(id);
+
+	// the remaining watch still sees the change
+	irq = std::uint16_t(1);
+	status = 0x1;
+	BOOST_CHECK_EQUAL(watcher.poll(), 1);
+	BOOST_CHECK_EQUAL(statuses, 1);
+	BOOST_CHECK_EQUAL(count, 0);
+	BOOST_CHECK_EQUAL(watcher.transfers(), 1);
+	BOOST_CHECK_THROW(watcher.unwatch(5), std::out_of_range);
+
+	// mapped registers are read one by one
+	watcher.watch(irq, [](const regmap::WatchEvent&) {});
+	watcher.watch(status, [](const regmap::WatchEvent&) {});
+	BOOST_CHECK_EQUAL(watcher.transfers(), 3);
+}
+
+BOOST_AUTO_TEST_CASE(watches_added_between_polls){
+
+	auto test = regmap::RegMapMock("watch.json", 0x400);
+	memset(test.getBackend().mapping(0, 0x400), 0, 0x400);
+	auto status = test.get<regmap::Register32_t>("status");
+	auto irq = test.get<regmap::Register16_t>("irq");
+
+	std::vector<regmap::WatchEvent> events;
+	int links = 0, irqs = 0;
+	regmap::Watcher watcher(test.getBackend());
+	watcher.watch(status, [&events](const regmap::WatchEvent &event) { events.push_back(event); });
+	watcher.watch(status, "LINK", [&links](const regmap::WatchEvent&) { links++; }, regmap::CHANGE, 2);
+	watcher.poll();
+	watcher.poll();
+
+	// a change and an unrelated watch in the same poll interval
+	status = 0x1;
+	watcher.watch(irq, [&irqs](const regmap::WatchEvent&) { irqs++; });
+	BOOST_CHECK_EQUAL(watcher.poll(), 1);
+	BOOST_REQUIRE_EQUAL(events.size(), 1);
+	BOOST_CHECK_EQUAL(events.back().m_uBefore, 0);
+	BOOST_CHECK_EQUAL(events.back().m_uAfter, 1);
+
+	// the debounce count goes on across the rebuild
+	watcher.watch(test.get<regmap::Register8_t>("remote"), [](const regmap::WatchEvent&) {});
+	BOOST_CHECK_EQUAL(watcher.poll(), 1);
+	BOOST_CHECK_EQUAL(links, 1);
+
+	// the new watch reports changes after its baseline
+	irq = std::uint16_t(1);
+	BOOST_CHECK_EQUAL(watcher.poll(), 1);
+	BOOST_CHECK_EQUAL(irqs, 1);
+	BOOST_CHECK_EQUAL(events.size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(callbacks_changing_watches){
+
+	auto test = regmap::RegMapMock("watch.json", 0x400);
+	memset(test.getBackend().mapping(0, 0x400), 0, 0x400);
+	auto status = test.get<regmap::Register32_t>("status");
+	auto irq = test.get<regmap::Register16_t>("irq");
+
+	regmap::Watcher watcher(test.getBackend());
+	int irqs = 0, added = 0;
+	auto irqId = watcher.watch(irq, [&irqs](const regmap::WatchEvent&) { irqs++; });
+
+	// the callback adds enough watches to move the watch table, and drops
+	// the irq watch evaluated after it
+	bool once = true;
+	watcher.watch(status, [&](const regmap::WatchEvent&) {
+		if (!once)
+			return;
+		once = false;
+		for (int i = 0; i < 64; i++)
+			watcher.watch(irq, [&added](const regmap::WatchEvent&) { added++; });
+		watcher.unwatch(irqId);
+		BOOST_CHECK_THROW(watcher.poll(), std::runtime_error);
+	}, regmap::LEVEL_HIGH);
+
+	watcher.poll();
+	status = 0x1;
+	irq = std::uint16_t(1);
+	BOOST_CHECK_EQUAL(watcher.poll(), 1);
+	BOOST_CHECK_EQUAL(irqs, 0);
+
+	// the added watches take their baseline on the next poll
+	BOOST_CHECK_EQUAL(watcher.poll(), 1);
+	BOOST_CHECK_EQUAL(added, 0);
+	irq = std::uint16_t(2);
+	BOOST_CHECK_EQUAL(watcher.poll(), 1 + 64);
+	BOOST_CHECK_EQUAL(added, 64);
+	BOOST_CHECK_EQUAL(irqs, 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()